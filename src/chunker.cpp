@@ -1,5 +1,9 @@
 #include <iostream>
 #include <unordered_set>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <omp.h>
 #include "stream.hpp"
 #include "chunker.hpp"
 
@@ -209,4 +213,112 @@ int64_t PathChunker::extract_gam_for_ids(const vector<vg::id_t>& graph_ids,
 
 }
 
+int64_t PathChunker::route_gam_to_chunks(istream& gam_stream, const vector<vector<vg::id_t>>& chunk_ids,
+                                         const vector<string>& out_names, bool only_fully_contained) {
+
+    assert(chunk_ids.size() == out_names.size());
+    size_t num_chunks = chunk_ids.size();
+
+    // one sorted table of (node, chunk) for the whole plan, so that looking up a node
+    // gives all the chunks that share it at once
+    vector<pair<vg::id_t, size_t>> node_to_chunk;
+    for (size_t i = 0; i < num_chunks; ++i) {
+        for (vg::id_t id : chunk_ids[i]) {
+            node_to_chunk.push_back(make_pair(id, i));
+        }
+    }
+    sort(node_to_chunk.begin(), node_to_chunk.end());
+    node_to_chunk.erase(unique(node_to_chunk.begin(), node_to_chunk.end()), node_to_chunk.end());
+
+    // open (and truncate) every chunk file once, and write to it as its buffer fills
+    vector<unique_ptr<ofstream>> out_files(num_chunks);
+    for (size_t i = 0; i < num_chunks; ++i) {
+        out_files[i].reset(new ofstream(out_names[i]));
+        if (!*out_files[i]) {
+            cerr << "error[vg chunk]: can't open output gam file " << out_names[i] << endl;
+            exit(1);
+        }
+    }
+
+    // each chunk's buffer and file are guarded by its own lock
+    vector<vector<Alignment>> gam_buffers(num_chunks);
+    vector<omp_lock_t> chunk_locks(num_chunks);
+    for (auto& lock : chunk_locks) {
+        omp_init_lock(&lock);
+    }
+    int64_t gam_count = 0;
+
+    // write out a chunk's buffer.  must hold the chunk's lock
+    function<void(size_t)> flush_chunk = [&](size_t i) {
+        vector<Alignment>& gam_buffer = gam_buffers[i];
+        function<Alignment&(uint64_t)> write_buffer_elem = [&gam_buffer](uint64_t j) -> Alignment& {
+            return gam_buffer[j];
+        };
+        stream::write(*out_files[i], gam_buffer.size(), write_buffer_elem);
+#pragma omp atomic
+        gam_count += gam_buffer.size();
+        gam_buffer.clear();
+    };
+
+    function<void(Alignment&)> route_alignment = [&](Alignment& alignment) {
+        if (!alignment.has_path() || alignment.path().mapping_size() == 0) {
+            return;
+        }
+
+        // the chunks containing the first node, narrowed down (for fully contained)
+        // or widened (otherwise) by every following node
+        vector<size_t> targets;
+        vector<size_t> node_chunks;
+        vector<size_t> merged;
+        for (size_t i = 0; i < alignment.path().mapping_size(); ++i) {
+            vg::id_t node_id = alignment.path().mapping(i).position().node_id();
+            auto range = equal_range(node_to_chunk.begin(), node_to_chunk.end(), make_pair(node_id, (size_t)0),
+                                     [](const pair<vg::id_t, size_t>& a, const pair<vg::id_t, size_t>& b) {
+                                         return a.first < b.first;
+                                     });
+            node_chunks.clear();
+            for (auto it = range.first; it != range.second; ++it) {
+                node_chunks.push_back(it->second);
+            }
+            if (i == 0) {
+                targets = node_chunks;
+            } else if (only_fully_contained) {
+                merged.clear();
+                set_intersection(targets.begin(), targets.end(), node_chunks.begin(), node_chunks.end(),
+                                 back_inserter(merged));
+                swap(targets, merged);
+            } else {
+                merged.clear();
+                set_union(targets.begin(), targets.end(), node_chunks.begin(), node_chunks.end(),
+                          back_inserter(merged));
+                swap(targets, merged);
+            }
+            if (only_fully_contained && targets.empty()) {
+                return;
+            }
+        }
+
+        for (size_t i : targets) {
+            omp_set_lock(&chunk_locks[i]);
+            gam_buffers[i].push_back(alignment);
+            if (gam_buffers[i].size() > gam_buffer_size) {
+                flush_chunk(i);
+            }
+            omp_unset_lock(&chunk_locks[i]);
+        }
+    };
+
+    stream::for_each_parallel(gam_stream, route_alignment);
+
+    // flush buffers
+    for (size_t i = 0; i < num_chunks; ++i) {
+        if (!gam_buffers[i].empty()) {
+            flush_chunk(i);
+        }
+        omp_destroy_lock(&chunk_locks[i]);
+    }
+
+    return gam_count;
+}
+
 }
@@ -65,6 +65,15 @@ public:
     int64_t extract_gam_for_ids(const vector<vg::id_t>& graph_ids, Index& index, ostream* out_stream,
                                 bool contiguous = false, bool only_fully_contained = false);
     
+    /** Read every alignment in a GAM stream exactly once and append it to the
+     * GAM file of every chunk it touches (or, if only_fully_contained is set,
+     * of every chunk that contains all of it).  chunk_ids[i] holds the node
+     * ids of chunk i and out_names[i] its output file, which is truncated
+     * first.  Reads are routed in parallel, and no gam index is needed.
+     * Returns the total number of alignments written. */
+    int64_t route_gam_to_chunks(istream& gam_stream, const vector<vector<vg::id_t>>& chunk_ids,
+                                const vector<string>& out_names, bool only_fully_contained = false);
+    
 };
 
 
@@ -13,6 +13,8 @@
 #include <list>
 #include <algorithm>
 #include <memory>
+#include <deque>
+#include <omp.h>
 
 
 namespace vg {
@@ -402,6 +404,7 @@ namespace vg {
                         // Some VCFs may include multiple variants at the same
                         // position with the same ref and alt. We will only take the
                         // first one.
+#pragma omp critical (cerr)
                         cerr << "warning:[vg::Constructor] Skipping duplicate variant with hash " << variant_name
                             << " at " << variant->sequenceName << ":" << variant->position << endl;
                         duplicates.insert(variant);
@@ -1177,134 +1180,193 @@ namespace vg {
 
         }
 
-        while (variant_source.get() && variant_source.get()->sequenceName == vcf_contig &&
-                variant_source.get()->position >= leading_offset &&
-                variant_source.get()->position + variant_source.get()->ref.size() <= reference_end) {
+        // Chunks are constructed in parallel, in tasks, while this thread keeps
+        // reading variants and cutting chunks. They come back to this thread
+        // to be wired up and emitted in reference order. Each chunk handed off
+        // gets a slot here, which its task fills in and then marks done.
+        struct chunk_slot_t {
+            ConstructedChunk chunk;
+            // Where does the chunk end in the reference?
+            size_t end;
+            int done = 0;
+        };
+        deque<chunk_slot_t> in_flight;
+
+        // Hand off a chunk running from chunk_start to the given end, with the
+        // current chunk_variants, to be constructed. Clears chunk_variants.
+        auto dispatch_chunk = [&](size_t end) {
+            in_flight.emplace_back();
+            chunk_slot_t* slot = &in_flight.back();
+            slot->end = end;
+
+            // Get the ref sequence we need. We do all the reading from the
+            // FASTA on this thread.
+            string* chunk_ref = new string(reference.getSubSequence(reference_contig, chunk_start, end - chunk_start));
+            vector<vcflib::Variant>* variants = new vector<vcflib::Variant>();
+            variants->swap(chunk_variants);
+            size_t offset = chunk_start;
+            const string* path_name = &reference_contig;
+
+#pragma omp task firstprivate(slot, chunk_ref, variants, offset, path_name)
+            {
+                // Call the construction
+                slot->chunk = construct_chunk(*chunk_ref, *path_name, *variants, offset);
+                delete chunk_ref;
+                delete variants;
 
-            // While we have variants we want to include
+#pragma omp flush
+#pragma omp atomic write
+                slot->done = 1;
+            }
+        };
 
-            bool variant_acceptable = true;
+        // Wire up and emit all the chunks at the front of the queue that are
+        // done. If wait is set, first wait for all chunks to be done.
+        auto emit_finished_chunks = [&](bool wait) {
+            if (wait) {
+#pragma omp taskwait
+            }
+            while (!in_flight.empty()) {
+                int done;
+#pragma omp atomic read
+                done = in_flight.front().done;
+                if (!done) {
+                    // We need to keep the chunks in order
+                    break;
+                }
+#pragma omp flush
 
+                // Wire up and emit the chunk graph
+                wire_and_emit(in_flight.front().chunk);
 
-            auto vvar = variant_source.get();
+                // Say we've completed the chunk
+                update_progress(in_flight.front().end - leading_offset);
 
-            if (do_svs) {
-                variant_acceptable = vvar->canonicalize_sv(reference, insertions, -1);
+                in_flight.pop_front();
             }
+        };
 
-            for (string& alt : vvar->alt) {
-                // Validate each alt of the variant
-
-                if(!allATGC(alt)) {
-                    // It may be a symbolic allele or something. Skip this variant.
-                    variant_acceptable = false;
-                    #pragma omp critical (cerr)
-                    {
-                        bool warn = true;
-                        if (!alt.empty() && alt[0] == '<' && alt[alt.size()-1] == '>') {
-                            if (symbolic_allele_warnings.find(alt) != symbolic_allele_warnings.end()) {
-                                warn = false;
-                            } else {
-                                symbolic_allele_warnings.insert(alt);
+#pragma omp parallel
+#pragma omp single
+        {
+            // Don't let the reader get too far ahead of the emitted graph.
+            size_t max_chunks_in_flight = omp_get_num_threads() * 4;
+
+            while (variant_source.get() && variant_source.get()->sequenceName == vcf_contig &&
+                    variant_source.get()->position >= leading_offset &&
+                    variant_source.get()->position + variant_source.get()->ref.size() <= reference_end) {
+
+                // While we have variants we want to include
+
+                bool variant_acceptable = true;
+
+
+                auto vvar = variant_source.get();
+
+                if (do_svs) {
+                    variant_acceptable = vvar->canonicalize_sv(reference, insertions, -1);
+                }
+
+                for (string& alt : vvar->alt) {
+                    // Validate each alt of the variant
+
+                    if(!allATGC(alt)) {
+                        // It may be a symbolic allele or something. Skip this variant.
+                        variant_acceptable = false;
+                        #pragma omp critical (cerr)
+                        {
+                            bool warn = true;
+                            if (!alt.empty() && alt[0] == '<' && alt[alt.size()-1] == '>') {
+                                if (symbolic_allele_warnings.find(alt) != symbolic_allele_warnings.end()) {
+                                    warn = false;
+                                } else {
+                                    symbolic_allele_warnings.insert(alt);
+                                }
+                            }
+                            if (warn) {
+                                cerr << "warning:[vg::Constructor] Unsupported variant allele \"" << alt << "\"; Skipping variant(s)!" << endl;
                             }
                         }
-                        if (warn) {
-                            cerr << "warning:[vg::Constructor] Unsupported variant allele \"" << alt << "\"; Skipping variant(s)!" << endl;
-                        }
+                        break;
                     }
-                    break;
                 }
-            }
-            if (!variant_acceptable) {
-                // Skip variants that have symbolic alleles or other nonsense we can't parse.
-                variant_source.handle_buffer();
-                variant_source.fill_buffer();
-            } else if (!chunk_variants.empty() && chunk_end > vvar->position) {
-                // If the chunk is nonempty and this variant overlaps what's in there, put it in too and try the next.
-                // TODO: this is a lot like the clumping code...
+                if (!variant_acceptable) {
+                    // Skip variants that have symbolic alleles or other nonsense we can't parse.
+                    variant_source.handle_buffer();
+                    variant_source.fill_buffer();
+                } else if (!chunk_variants.empty() && chunk_end > vvar->position) {
+                    // If the chunk is nonempty and this variant overlaps what's in there, put it in too and try the next.
+                    // TODO: this is a lot like the clumping code...
 
-                // Add it in
-                chunk_variants.push_back(*(vvar));
-                // Expand out how big the chunk needs to be, so we can get other overlapping variants.
-                chunk_end = max(chunk_end, chunk_variants.back().position + chunk_variants.back().ref.size());
+                    // Add it in
+                    chunk_variants.push_back(*(vvar));
+                    // Expand out how big the chunk needs to be, so we can get other overlapping variants.
+                    chunk_end = max(chunk_end, chunk_variants.back().position + chunk_variants.back().ref.size());
 
-                // Try the next variant
-                variant_source.handle_buffer();
-                variant_source.fill_buffer();
+                    // Try the next variant
+                    variant_source.handle_buffer();
+                    variant_source.fill_buffer();
 
-            } else if(chunk_variants.size() < vars_per_chunk && variant_source.get()->position < chunk_start + bases_per_chunk) {
-                // Otherwise if this variant is close enough and the chunk isn't too big yet, put it in and try the next.
+                } else if(chunk_variants.size() < vars_per_chunk && variant_source.get()->position < chunk_start + bases_per_chunk) {
+                    // Otherwise if this variant is close enough and the chunk isn't too big yet, put it in and try the next.
 
-                // TODO: unify with above code?
+                    // TODO: unify with above code?
 
-                // Add it in
-                chunk_variants.push_back(*(vvar));
-                // Expand out how big the chunk needs to be, so we can get other overlapping variants.
-                chunk_end = max(chunk_end, chunk_variants.back().position + chunk_variants.back().ref.size());
+                    // Add it in
+                    chunk_variants.push_back(*(vvar));
+                    // Expand out how big the chunk needs to be, so we can get other overlapping variants.
+                    chunk_end = max(chunk_end, chunk_variants.back().position + chunk_variants.back().ref.size());
 
-                // Try the next variant
-                variant_source.handle_buffer();
-                variant_source.fill_buffer();
+                    // Try the next variant
+                    variant_source.handle_buffer();
+                    variant_source.fill_buffer();
 
-            } else {
-                // This variant shouldn't go in this chunk.
+                } else {
+                    // This variant shouldn't go in this chunk.
 
-                // Finish the chunk to a point before the next variant, before the
-                // end of the reference, before the max chunk size, and after the
-                // last variant the chunk contains.
-                chunk_end = max(chunk_end,
-                        min((size_t ) vvar->position,
-                            min((size_t) reference_end,
-                                (size_t) (chunk_start + bases_per_chunk))));
+                    // Finish the chunk to a point before the next variant, before the
+                    // end of the reference, before the max chunk size, and after the
+                    // last variant the chunk contains.
+                    chunk_end = max(chunk_end,
+                            min((size_t ) vvar->position,
+                                min((size_t) reference_end,
+                                    (size_t) (chunk_start + bases_per_chunk))));
 
-                // Get the ref sequence we need
-                auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
+                    // Have the chunk constructed
+                    dispatch_chunk(chunk_end);
+                    emit_finished_chunks(in_flight.size() >= max_chunks_in_flight);
 
-                // Call the construction
-                auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
+                    // Set up a new chunk
+                    chunk_start = chunk_end;
+                    chunk_end = 0;
 
-                // Wire up and emit the chunk graph
-                wire_and_emit(result);
+                    // Loop again on the same variant.
+                }
+            }
 
-                // Say we've completed the chunk
-                update_progress(chunk_end - leading_offset);
+            // We ran out of variants, so finish this chunk and all the others after it
+            // without looking for variants.
+            // TODO: unify with above loop?
+            while (chunk_start < reference_end) {
+                // We haven't finished the whole reference
+
+                // Make the chunk as long as it can be
+                chunk_end = max(chunk_end,
+                        min((size_t) reference_end,
+                            (size_t) (chunk_start + bases_per_chunk)));
+
+                // Have the chunk constructed
+                dispatch_chunk(chunk_end);
+                emit_finished_chunks(in_flight.size() >= max_chunks_in_flight);
 
                 // Set up a new chunk
                 chunk_start = chunk_end;
                 chunk_end = 0;
-                chunk_variants.clear();
-
-                // Loop again on the same variant.
             }
-        }
-
-        // We ran out of variants, so finish this chunk and all the others after it
-        // without looking for variants.
-        // TODO: unify with above loop?
-        while (chunk_start < reference_end) {
-            // We haven't finished the whole reference
-
-            // Make the chunk as long as it can be
-            chunk_end = max(chunk_end,
-                    min((size_t) reference_end,
-                        (size_t) (chunk_start + bases_per_chunk)));
-
-            // Get the ref sequence we need
-            auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
-
-            // Call the construction
-            auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
-
-            // Wire up and emit the chunk graph
-            wire_and_emit(result);
 
-            // Say we've completed the chunk
-            update_progress(chunk_end - leading_offset);
+            // Wait for and emit everything that's left
+            emit_finished_chunks(true);
 
-            // Set up a new chunk
-            chunk_start = chunk_end;
-            chunk_end = 0;
-            chunk_variants.clear();
         }
 
         // All the chunks have been wired and emitted. Now emit the very last node, if any
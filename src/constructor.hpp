@@ -155,6 +155,11 @@ public:
      * Doesn't handle any of the setup for VCF indexing. Just scans all the
      * variants that can come out of the buffer, so make sure indexing is set on
      * the file first before passing it in.
+     *
+     * Chunks are constructed in parallel by OpenMP tasks while one thread of
+     * the parallel team reads ahead in the VCF. The callback is only ever
+     * called by that thread, with chunks in order, but it need not be the
+     * thread that called this function.
      */
     void construct_graph(string vcf_contig, FastaReference& reference, VcfBuffer& variant_source,
          const vector<FastaReference*>& insertion, function<void(Graph&)> callback);
@@ -153,5 +153,10 @@ const vector<FeatureSet::Feature>& FeatureSet::get_features(const string& path)
     return features.at(path);
 }
 
+bool FeatureSet::has_features(const string& path) const {
+    auto found = features.find(path);
+    return found != features.end() && !found->second.empty();
+}
+
 }
 
@@ -37,79 +37,185 @@ std::unique_ptr< list<NodeTraversal> >  FlowSort::max_flow_sort(const string& re
 void FlowSort::fast_linear_sort(const string& ref_name, bool isGrooming)
 {
     if (vg.size() <= 1) return;
-    // Topologically sort, which orders and orients all the nodes.
-    list<NodeTraversal> sorted_nodes;
     vg.paths.sort_by_mapping_rank();
     
     //get weighted graph
     WeightedGraph w_graph;
     w_graph.construct(*this,ref_name, isGrooming);
 
-    //all nodes size
-    id_t nodes_size =vg.node_by_id.size();
-
-    //create set of sinks and sources
-    std::set<id_t> sources;
-    //index - degree of nodes
-    std::vector<std::set<id_t>> nodes_degree;
-    int cur_node_degree;
-    //find sources
+    // Rank the nodes in ID order, so that comparing ranks breaks ties the
+    // same way as comparing IDs, and lay the weighted graph out in flat
+    // arrays indexed by rank.
+    vector<id_t> rank_to_id;
+    rank_to_id.reserve(vg.node_by_id.size());
     for (auto const &entry : vg.node_by_id)
     {
-        if(!w_graph.edges_in_nodes.count(entry.first) || 
-                w_graph.edges_in_nodes[entry.first].size() == 0)
+        rank_to_id.push_back(entry.first);
+    }
+    sort(rank_to_id.begin(), rank_to_id.end());
+    hash_map<id_t, size_t> id_to_rank;
+    for (size_t i = 0; i < rank_to_id.size(); i++)
+    {
+        id_to_rank[rank_to_id[i]] = i;
+    }
+    size_t nodes_size = rank_to_id.size();
+
+    // Each weighted edge gets a number, with its ends and weight
+    unordered_map<Edge*, size_t> edge_number;
+    vector<size_t> edge_from;
+    vector<size_t> edge_to;
+    vector<int64_t> edge_weight;
+    auto number_edge = [&](Edge* edge) {
+        auto found = edge_number.find(edge);
+        if (found != edge_number.end()) {
+            return found->second;
+        }
+        size_t number = edge_from.size();
+        edge_number[edge] = number;
+        edge_from.push_back(id_to_rank.at(edge->from()));
+        edge_to.push_back(id_to_rank.at(edge->to()));
+        edge_weight.push_back(w_graph.edge_weight[edge]);
+        return number;
+    };
+
+    // Edges out of and into each node, in CSR form, keeping the order of the
+    // weighted graph's lists since it decides which new source comes next.
+    auto flatten = [&](EdgeMapping& edges, vector<size_t>& starts, vector<size_t>& numbers) {
+        starts.assign(nodes_size + 1, 0);
+        for (size_t i = 0; i < nodes_size; i++)
         {
-            sources.insert(entry.first);
-            continue;
+            auto found = edges.find(rank_to_id[i]);
+            if (found != edges.end())
+            {
+                for (Edge* edge : found->second)
+                {
+                    numbers.push_back(number_edge(edge));
+                }
+            }
+            starts[i + 1] = numbers.size();
         }
-        cur_node_degree = get_node_degree(w_graph, entry.first);
-        if (cur_node_degree < 0)
-            continue;
-
-        if (cur_node_degree + 1 > nodes_degree.size())
-            nodes_degree.resize(cur_node_degree + 1);
-        nodes_degree[cur_node_degree].insert(entry.first);
-        //if(edges_out_nodes.find(entry.first) != edges_out_nodes.end() )
-        //   sinks.insert(entry.first);
+    };
+    vector<size_t> out_starts, out_edges, in_starts, in_edges;
+    flatten(w_graph.edges_out_nodes, out_starts, out_edges);
+    flatten(w_graph.edges_in_nodes, in_starts, in_edges);
+
+    // Only the flat arrays are used from here on, so free the maps
+    w_graph = WeightedGraph();
+    unordered_map<Edge*, size_t>().swap(edge_number);
+    hash_map<id_t, size_t>().swap(id_to_rank);
+
+    // Edges leave the graph as the nodes at their ends are sorted
+    vector<bool> edge_removed(edge_from.size(), false);
+    // Live edges into each node
+    vector<size_t> in_count(nodes_size);
+    // Weight out minus weight in of each node's live edges
+    vector<int64_t> degree(nodes_size, 0);
+    for (size_t i = 0; i < nodes_size; i++)
+    {
+        in_count[i] = in_starts[i + 1] - in_starts[i];
+        for (size_t j = in_starts[i]; j < in_starts[i + 1]; j++)
+            degree[i] -= edge_weight[in_edges[j]];
+        for (size_t j = out_starts[i]; j < out_starts[i + 1]; j++)
+            degree[i] += edge_weight[out_edges[j]];
     }
 
-    id_t next = -1;
-    //std::vector<id_t> sorted;
+    // Nodes with no live incoming edges, taken highest rank first
+    set<size_t> sources;
+    // Other nodes with nonnegative degree, taken highest degree and then
+    // highest rank first
+    set<pair<int64_t, size_t>> frontier;
+    vector<bool> in_frontier(nodes_size, false);
+    auto frontier_erase = [&](size_t node) {
+        if (in_frontier[node])
+        {
+            frontier.erase(make_pair(degree[node], node));
+            in_frontier[node] = false;
+        }
+    };
+    auto frontier_insert = [&](size_t node) {
+        frontier.insert(make_pair(degree[node], node));
+        in_frontier[node] = true;
+    };
 
+    for (size_t i = 0; i < nodes_size; i++)
+    {
+        if (in_count[i] == 0)
+            sources.insert(i);
+        else if (degree[i] >= 0)
+            frontier_insert(i);
+    }
 
-    int remaining_nodes_size = nodes_size;
-    set<id_t>::iterator i_last_el;
+    // Nodes placed so far, and the highest rank that might not be
+    vector<bool> placed(nodes_size, false);
+    size_t unplaced_cursor = nodes_size;
 
-    while (remaining_nodes_size > 0)
+    list<NodeTraversal> sorted_nodes;
+    // The next node to place, if removing the last one made a new source
+    size_t next = nodes_size;
+    for (size_t remaining = nodes_size; remaining > 0; remaining--)
     {   //Get next vertex to delete
-        if (next == -1)
+        if (next == nodes_size)
         {
-            if (sources.size() > 0) //|| sinks.size() > 0)
+            if (!sources.empty())
             {
-                i_last_el = sources.end();
-                --i_last_el;
-                next = *i_last_el;
-                sources.erase(i_last_el);
+                next = *sources.rbegin();
+                sources.erase(next);
             }
+            else if (!frontier.empty())
+                next = frontier.rbegin()->second;
             else
-                next = find_max_node(nodes_degree);
+            {
+                // Everything left is in a cycle with negative degree, so
+                // take the highest node not yet placed
+                while (placed[unplaced_cursor - 1])
+                    unplaced_cursor--;
+                next = unplaced_cursor - 1;
+            }
         }
         else
-        {
-            i_last_el = sources.find(next);
-            if(i_last_el != sources.end())
-                sources.erase(i_last_el);
-        }
+            sources.erase(next);
 
-        //add next node
-        //sorted.push_back(next);
-        NodeTraversal node = NodeTraversal(vg.node_by_id[next], false);
-        sorted_nodes.push_back(node);
+        sorted_nodes.push_back(NodeTraversal(vg.node_by_id[rank_to_id[next]], false));
+        placed[next] = true;
+        size_t node = next;
+        next = nodes_size;
+        frontier_erase(node);
 
-        //remove edges related with node
-        next = get_next_node_recalc_degrees(w_graph, nodes_degree,sources,
-                                            next);
-        remaining_nodes_size--;
+        //remove edges related with node, and recalc degrees of the nodes
+        //at their other ends
+        for (size_t j = in_starts[node]; j < in_starts[node + 1]; j++)
+        {
+            size_t edge = in_edges[j];
+            if (edge_removed[edge])
+                continue;
+            size_t cur_node = edge_from[edge];
+            edge_removed[edge] = true;
+            if (placed[cur_node])
+                continue;
+            frontier_erase(cur_node);
+            degree[cur_node] -= edge_weight[edge];
+            if (degree[cur_node] >= 0)
+                frontier_insert(cur_node);
+        }
+        for (size_t j = out_starts[node]; j < out_starts[node + 1]; j++)
+        {
+            size_t edge = out_edges[j];
+            if (edge_removed[edge])
+                continue;
+            size_t cur_node = edge_to[edge];
+            frontier_erase(cur_node);
+            degree[cur_node] += edge_weight[edge];
+            if (in_count[cur_node] == 1)
+            {
+                //it is a new source
+                sources.insert(cur_node);
+                next = cur_node;
+            }
+            else if (degree[cur_node] >= 0)
+                frontier_insert(cur_node);
+            in_count[cur_node]--;
+            edge_removed[edge] = true;
+        }
     }
 
     //output
@@ -267,7 +373,7 @@ FlowSort::WeightedGraph::construct(FlowSort& fs, const string& ref_name, bool is
         nodes.insert(edge.first->to());
 
         //assign weight to the minimum number of paths of the adjacent nodes
-        auto from_node_mapping = fs.vg.paths.get_node_mapping(from);
+        auto& from_node_mapping = fs.vg.paths.get_node_mapping(from);
 //        NodeMapping to_node_mapping = paths.get_node_mapping(to);
         int weight = 1;
 
@@ -534,97 +640,6 @@ vector<set<id_t>> FlowSort::get_cc_in_wg(EdgeMapping& edges_in,EdgeMapping& edge
     return result;
 }
 
-/* Iterate all edges adjacent to node, recalc degrees of related nodes.
- * If node has no incoming edges we add it to the sources and return as next node.
- * */
-id_t FlowSort::get_next_node_recalc_degrees(WeightedGraph& wg, std::vector<std::set<id_t>>& degrees,std::set<id_t> &sources,
-                                     id_t node)
-{
-    id_t result = -1;
-    //recalc degrees
-    id_t cur_node;
-    int new_degree;
-    int cur_degree;
-    //remove from degrees (if node is not source)
-    int node_degree = get_node_degree(wg, node);
-    if(node_degree >= 0 && (node_degree < degrees.size()))
-    {
-        set<id_t>::iterator i_el = degrees[node_degree].find(node);
-        if(i_el != degrees[node_degree].end())
-            degrees[node_degree].erase(i_el);
-    }
-
-
-    //decrease number of in_edges from current node
-    for(const auto& edge: wg.edges_in_nodes[node])
-    {
-        cur_node = edge->from();
-        cur_degree = get_node_degree(wg, cur_node);
-        new_degree = cur_degree - wg.edge_weight[edge];
-
-        //decrease out_edges from current node
-        if(cur_degree >= 0)
-            degrees[cur_degree].erase(cur_node);
-        //add node to new_degree set
-        if(new_degree >= 0)
-        {
-            if (new_degree + 1> degrees.size())
-                degrees.resize(new_degree + 1);
-            degrees[new_degree].insert(cur_node);
-        }
-
-
-        //remove current edge from wg
-        std::vector<Edge*>& related_edges = wg.edges_out_nodes[cur_node];
-        related_edges.erase(std::remove(related_edges.begin(), related_edges.end(), edge), related_edges.end());
-    }
-    for(const auto& edge: wg.edges_out_nodes[node])
-    {
-        cur_node = edge->to();
-        //check if node is new source
-        std::vector<Edge*>& related_edges = wg.edges_in_nodes[cur_node];
-        //add related node to sources
-        if(related_edges.size() == 1)
-        {
-            sources.insert(cur_node);
-            result = cur_node;
-        }
-
-        cur_degree = get_node_degree(wg, cur_node);
-        new_degree = cur_degree + wg.edge_weight[edge];
-
-        //decrease in_edges from current node
-        if(cur_degree >= 0)
-            degrees[cur_degree].erase(cur_node);
-        //add node to new_degree set (if not source)
-        if(new_degree >= 0 && related_edges.size() != 1)
-        {
-            if (new_degree + 1> degrees.size())
-                degrees.resize(new_degree + 1);
-            degrees[new_degree].insert(cur_node);
-        }
-        //remove current edge from wg
-        related_edges.erase(std::remove(related_edges.begin(), related_edges.end(), edge), related_edges.end());
-    }
-
-    return result;
-}
-
-/*Find node with max degree*/
-id_t FlowSort::find_max_node(std::vector<std::set<id_t>> nodes_degree)
-{
-    int start_size = nodes_degree.size()-1;
-    int last_ind = start_size;
-    while(nodes_degree[last_ind].size() == 0)
-    {
-        last_ind--;
-    }
-    if(last_ind != start_size)
-        nodes_degree.resize(last_ind + 1);
-    set<id_t>::iterator i_last_el = nodes_degree[last_ind].end();
-    return *(--i_last_el);
-}
-
 /*  Method finds min cut in a given set of nodes, then removes min cut edges,
     finds in- and -out growth from the reference path and calls itself on them recursively.
 */
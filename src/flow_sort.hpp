@@ -73,13 +73,7 @@ public:
                                    const set<id_t>& all_nodes, id_t start_ref_node);
     void groom_components(EdgeMapping& edges_in, EdgeMapping& edges_out, set<id_t>& isolated_nodes, set<id_t>& main_nodes,
                           map<id_t, set<Edge*>> &minus_start, map<id_t, set<Edge*>> &minus_end);
-      
-    /* Iterate all edges adjacent to node, recalc degrees of related nodes.
-     * If node has no incoming edges we add it to the sources and return as next node.
-     * */
-    id_t get_next_node_recalc_degrees(WeightedGraph& wg, std::vector<std::set<id_t>>& degrees,std::set<id_t> &sources,
-                                         id_t node);
-    id_t find_max_node(std::vector<std::set<id_t>> nodes_degree);
+
 
     bool bfs(set<id_t>& nodes, map<id_t, map<id_t, int>>& edge_weight, id_t s, id_t t, map<id_t, id_t>& parent);
     void dfs(set<id_t>& nodes, id_t s, set<id_t>& visited, map<id_t, map<id_t, int>>& edge_weight);
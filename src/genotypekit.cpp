@@ -332,10 +332,10 @@ vector<SnarlTraversal> PathBasedTraversalFinder::find_traversals(const Snarl& si
     return ret;
 }
 
-SnarlManager CactusUltrabubbleFinder::find_snarls() {
+vector<Snarl> CactusUltrabubbleFinder::component_snarls(VG& component) {
     
     // Get the bubble tree in Cactus format
-    BubbleTree* bubble_tree = ultrabubble_tree(graph);
+    BubbleTree* bubble_tree = ultrabubble_tree(component);
     
     // Convert to Snarls
     
@@ -351,8 +351,8 @@ SnarlManager CactusUltrabubbleFinder::find_snarls() {
                 
                 // Check whether the bubble consists of a single edge
                 
-                set<NodeSide> start_connections = graph.sides_of(bubble.start);
-                set<NodeSide> end_connections = graph.sides_of(bubble.end);
+                set<NodeSide> start_connections = component.sides_of(bubble.start);
+                set<NodeSide> end_connections = component.sides_of(bubble.end);
                 
                 if (start_connections.size() == 1
                     && start_connections.count(bubble.end)
@@ -395,6 +395,73 @@ SnarlManager CactusUltrabubbleFinder::find_snarls() {
     
     delete bubble_tree;
     
+    return converted_snarls;
+}
+
+void CactusUltrabubbleFinder::for_each_component_snarls(const function<void(size_t, vector<Snarl>&)>& lambda) {
+    
+    vector<unordered_set<id_t>> components = graph.weakly_connected_components();
+    
+    if (components.size() <= 1) {
+        // No need to copy anything out
+        vector<Snarl> snarls = component_snarls(graph);
+        lambda(0, snarls);
+        return;
+    }
+    
+    // Do the biggest components first so one huge component doesn't end up
+    // running by itself at the end
+    vector<size_t> order(components.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return components[a].size() > components[b].size();
+    });
+    
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < order.size(); i++) {
+        size_t component_number = order[i];
+        
+        vector<Snarl> snarls;
+        {
+            // Copy the component out of the (read-only) parent graph. It
+            // only lives as long as we need it to run Cactus.
+            set<Node*> nodes;
+            for (id_t id : components[component_number]) {
+                nodes.insert(graph.get_node(id));
+            }
+            set<Edge*> edges;
+            graph.edges_of_nodes(nodes, edges);
+            VG component(nodes, edges);
+            
+            snarls = component_snarls(component);
+        }
+        
+#pragma omp critical (component_snarls)
+        lambda(component_number, snarls);
+    }
+}
+
+SnarlManager CactusUltrabubbleFinder::find_snarls() {
+    
+    // Collect the per-component results in component order so the output
+    // doesn't depend on thread scheduling
+    vector<vector<Snarl>> snarls_by_component;
+    for_each_component_snarls([&](size_t component_number, vector<Snarl>& snarls) {
+        if (snarls_by_component.size() <= component_number) {
+            snarls_by_component.resize(component_number + 1);
+        }
+        snarls_by_component[component_number] = std::move(snarls);
+    });
+    
+    vector<Snarl> converted_snarls;
+    for (auto& snarls : snarls_by_component) {
+        for (auto& snarl : snarls) {
+            converted_snarls.emplace_back(std::move(snarl));
+        }
+    }
+    
     // Now form the SnarlManager and return
     return SnarlManager(converted_snarls.begin(), converted_snarls.end());
 }
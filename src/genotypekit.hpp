@@ -280,10 +280,29 @@ public:
     
     /**
      * Find all the sites in parallel with Cactus, make the site tree, and call
-     * the given function on all the top-level sites.
+     * the given function on all the top-level sites. Each weakly connected
+     * component is decomposed independently.
      */
     virtual SnarlManager find_snarls();
     
+    /**
+     * Decompose each weakly connected component of the graph with its own
+     * Cactus graph, in parallel, and call the given function with the index
+     * of the component and its snarls (parents before children) as soon as
+     * the component is done. Calls are serialized but come in no particular
+     * order. Only one component's Cactus graph per thread is in memory at a
+     * time.
+     */
+    void for_each_component_snarls(const function<void(size_t, vector<Snarl>&)>& lambda);
+    
+private:
+    
+    /**
+     * Run Cactus on a single connected graph and convert its bubble tree into
+     * Snarls, parents before children.
+     */
+    vector<Snarl> component_snarls(VG& component);
+    
 };
     
 class ExhaustiveTraversalFinder : public TraversalFinder {
@@ -293,9 +293,15 @@ int json_dump_std_string(const char *buf, size_t size, void *data)
 std::string pb2json(const Message &msg)
 {
 	std::string r;
+	pb2json(msg, r);
+	return r;
+}
+
+void pb2json(const Message &msg, std::string &out)
+{
+	out.clear();
 
 	json_t *root = _pb2json(msg);
 	json_autoptr _auto(root);
-	json_dump_callback(root, json_dump_std_string, &r, 0);
-	return r;
+	json_dump_callback(root, json_dump_std_string, &out, 0);
 }
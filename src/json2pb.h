@@ -12,6 +12,7 @@
 #include <cstdio>
 #include <functional>
 #include <vector>
+#include <exception>
 #include <stream.hpp>
 #include <iostream>
 
@@ -24,6 +25,19 @@ class Message;
 void json2pb(google::protobuf::Message &msg, const char *buf, size_t size);
 void json2pb(google::protobuf::Message &msg, FILE *fp);
 std::string pb2json(const google::protobuf::Message &msg);
+// Serialize into the given string, replacing its contents but reusing its
+// storage, so a caller converting many messages need not allocate for each.
+void pb2json(const google::protobuf::Message &msg, std::string &out);
+
+// Convert every protobuf object of type T in the given stream to JSON, one
+// per line. Objects are read in batches of batch_size, each batch is converted
+// using all threads, and the JSON is written in the original order. If given,
+// preprocess is applied to each object before it is converted. Returns the
+// number of objects converted.
+template <class T>
+int64_t pb2json_stream(std::istream& in, std::ostream& out,
+                       const std::function<void(T&)>& preprocess = nullptr,
+                       size_t batch_size = 1000);
 
 // It's handy to be able to stream in JSON via vg view for testing.
 // This helper class takes this functionality from vg view -J and
@@ -40,9 +54,13 @@ public:
     std::function<bool(T&)> get_read_fn();
     // read json stream (using above fn), and directly write to out in either
     // protobuf or json format. 
+    // Objects in each buffer are parsed using all threads.
     int64_t write(std::ostream& out, bool json_out = false, int64_t buf_size = 1000);
 private:
     FILE* _fp;
+    // Read the text of the next JSON object into text, without parsing it.
+    // Returns false at the end of the stream.
+    bool read_text(std::string& text);
 };
 
 
@@ -100,35 +118,136 @@ inline std::function<bool(T&)> JSONStreamHelper<T>::get_read_fn() {
     };
 }
 
+template <class T>
+inline bool JSONStreamHelper<T>::read_text(std::string& text) {
+    text.clear();
+
+    // Skip whitespace between records
+    int c;
+    do {
+        c = fgetc(this->_fp);
+        if (c == EOF) {
+            return false;
+        }
+    } while (isspace(c));
+
+    if (c != '{') {
+        std::cerr << "error:[JSONStreamHelper] expected a JSON object but found '" << (char) c << "'" << std::endl;
+        exit(1);
+    }
+
+    // Copy characters until the braces balance, ignoring any inside strings
+    size_t depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    do {
+        text.push_back(c);
+        if (in_string) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == '{') {
+            depth++;
+        } else if (c == '}') {
+            depth--;
+            if (depth == 0) {
+                return true;
+            }
+        }
+    } while ((c = fgetc(this->_fp)) != EOF);
+
+    std::cerr << "error:[JSONStreamHelper] JSON object is truncated at end of file" << std::endl;
+    exit(1);
+}
+
 template<class T>
 inline int64_t JSONStreamHelper<T>::write(std::ostream& out, bool json_out,
-                                          int64_t buf_size) {    
-    std::function<bool(T&)> reader = get_read_fn();        
-    std::vector<T> buf;
+                                          int64_t buf_size) {
+    // Object texts and objects, reused from buffer to buffer
+    std::vector<std::string> texts(buf_size);
+    std::vector<T> buf(buf_size);
     int64_t total = 0;
     bool good = true;
     std::function<T(uint64_t)> lambda = [&](uint64_t i) -> T {return buf[i];};
     while (good) {
-        T obj;
-        good = reader(obj);
-        if (good) {
-            buf.push_back(obj);
+        // Read the buffer's texts serially
+        int64_t count = 0;
+        while (count < buf_size && (good = read_text(texts[count]))) {
+            count++;
         }
-        if (!good || buf.size() >= buf_size) {
-            if (!json_out) {
-                stream::write(out, buf.size(), lambda);
-            } else {
-                for (int i = 0; i < buf.size(); ++i) {
-                    out << pb2json(buf[i]);
-                }
+
+        // And parse them in parallel
+        std::exception_ptr error;
+#pragma omp parallel for schedule(dynamic, 64)
+        for (int64_t i = 0; i < count; i++) {
+            try {
+                buf[i] = T();
+                json2pb(buf[i], texts[i].data(), texts[i].size());
+            } catch (...) {
+#pragma omp critical (json_stream_error)
+                error = std::current_exception();
             }
-            total += buf.size();
-            buf.clear();
         }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        if (!json_out) {
+            stream::write(out, count, lambda);
+        } else {
+            for (int64_t i = 0; i < count; ++i) {
+                out << pb2json(buf[i]);
+            }
+        }
+        total += count;
     }
     out.flush();
     return total;
 }
 
+template <class T>
+inline int64_t pb2json_stream(std::istream& in, std::ostream& out,
+                              const std::function<void(T&)>& preprocess,
+                              size_t batch_size) {
+    // Objects and their JSON, reused from batch to batch
+    std::vector<T> batch(batch_size);
+    std::vector<std::string> jsons(batch_size);
+    size_t count = 0;
+    int64_t total = 0;
+
+    auto flush = [&](void) {
+#pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < count; i++) {
+            if (preprocess) {
+                preprocess(batch[i]);
+            }
+            pb2json(batch[i], jsons[i]);
+        }
+        for (size_t i = 0; i < count; i++) {
+            out << jsons[i] << "\n";
+        }
+        total += count;
+        count = 0;
+    };
+
+    std::function<void(T&)> lambda = [&](T& obj) {
+        batch[count++].Swap(&obj);
+        if (count == batch_size) {
+            flush();
+        }
+    };
+    stream::for_each(in, lambda);
+    flush();
+
+    out.flush();
+    return total;
+}
+
 
 #endif//VG_JSON2PB_H_INCLUDED
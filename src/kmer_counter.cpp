@@ -0,0 +1,219 @@
+#include "kmer_counter.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+#include <unordered_map>
+
+namespace vg {
+
+using namespace std;
+
+/// Rough bytes of memory taken by each distinct k-mer while counting, beyond
+/// the k-mer itself
+static const size_t count_entry_overhead = 96;
+
+/// How many times a partition may be split again before we count it anyway
+static const size_t max_split_levels = 8;
+
+/// Most pieces to split a partition into at once, to bound open files
+static const size_t max_split_pieces = 64;
+
+/// Open a new temporary spill file for reading and writing
+static FILE* open_spill_file(string& file_name) {
+    file_name = tmpfilename(find_temp_dir() + "/vg-kmers");
+    FILE* file = fopen(file_name.c_str(), "w+b");
+    if (file == nullptr) {
+        cerr << "error:[KmerCounter] could not open " << file_name << ": " << strerror(errno) << endl;
+        exit(1);
+    }
+    return file;
+}
+
+KmerCounter::KmerCounter(size_t kmer_size, size_t memory_budget, size_t partitions) :
+    kmer_size(kmer_size), partitions(max(partitions, (size_t) 1)), memory_budget(memory_budget),
+    record_size(kmer_size + sizeof(int64_t) + sizeof(int32_t)) {
+
+    size_t thread_count = omp_get_max_threads();
+    thread_budget = max(memory_budget / thread_count, record_size);
+
+    buffers.resize(thread_count, vector<vector<char>>(this->partitions));
+    buffered_bytes.resize(thread_count, 0);
+
+    spill_locks.resize(this->partitions);
+    for (size_t i = 0; i < this->partitions; i++) {
+        string file_name;
+        FILE* file = open_spill_file(file_name);
+        spill_file_names.push_back(file_name);
+        spill_files.push_back(file);
+        omp_init_lock(&spill_locks[i]);
+    }
+}
+
+KmerCounter::~KmerCounter() {
+    for (size_t i = 0; i < partitions; i++) {
+        fclose(spill_files[i]);
+        remove(spill_file_names[i].c_str());
+        omp_destroy_lock(&spill_locks[i]);
+    }
+}
+
+void KmerCounter::add(const string& kmer, int64_t node_id, int32_t offset) {
+    assert(kmer.size() == kmer_size);
+    size_t thread = omp_get_thread_num();
+    assert(thread < buffers.size());
+
+    auto& buffer = buffers[thread][partition_of(kmer.data(), 0, partitions)];
+    buffer.insert(buffer.end(), kmer.begin(), kmer.end());
+    buffer.insert(buffer.end(), (char*) &node_id, (char*) &node_id + sizeof(node_id));
+    buffer.insert(buffer.end(), (char*) &offset, (char*) &offset + sizeof(offset));
+
+    buffered_bytes[thread] += record_size;
+    if (buffered_bytes[thread] >= thread_budget) {
+        spill(thread);
+    }
+}
+
+size_t KmerCounter::partition_of(const char* kmer, size_t level, size_t partition_count) const {
+    // Salt the hash with the level, and mix it so every level splits differently
+    uint64_t h = hash<string>()(string(kmer, kmer_size)) + (level + 1) * 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h = h ^ (h >> 31);
+    return h % partition_count;
+}
+
+void KmerCounter::spill(size_t thread) {
+    for (size_t i = 0; i < partitions; i++) {
+        auto& buffer = buffers[thread][i];
+        if (buffer.empty()) {
+            continue;
+        }
+        omp_set_lock(&spill_locks[i]);
+        if (fwrite(buffer.data(), 1, buffer.size(), spill_files[i]) != buffer.size()) {
+            cerr << "error:[KmerCounter] could not write to " << spill_file_names[i] << endl;
+            exit(1);
+        }
+        omp_unset_lock(&spill_locks[i]);
+        buffer.clear();
+    }
+    buffered_bytes[thread] = 0;
+}
+
+void KmerCounter::for_each_count(const function<void(const KmerCount&)>& lambda, size_t min_count) {
+    // Get everything onto disk, so each partition is all in one place
+    for (size_t thread = 0; thread < buffers.size(); thread++) {
+        spill(thread);
+    }
+
+    for (size_t i = 0; i < partitions; i++) {
+        count_file(spill_files[i], 0, lambda, min_count);
+        // Leave the file positioned for any further spills
+        fseek(spill_files[i], 0, SEEK_END);
+    }
+}
+
+void KmerCounter::count_file(FILE* file, size_t level, const function<void(const KmerCount&)>& lambda,
+                             size_t min_count) {
+    fflush(file);
+    fseek(file, 0, SEEK_END);
+    size_t records = ftell(file) / record_size;
+    rewind(file);
+
+    // Read spill files back a chunk of whole records at a time
+    vector<char> chunk(record_size * max(thread_budget / record_size, (size_t) 1));
+    size_t read;
+
+    // In the worst case every occurrence is a distinct k-mer
+    size_t needed = records * (kmer_size + count_entry_overhead);
+    if (needed > memory_budget && records > 1 && level < max_split_levels) {
+        // Too big to count at once, so split it into pieces that should fit,
+        // or at least into as many pieces as we can have open
+        size_t piece_count = min(max(needed / max(memory_budget, (size_t) 1) + 1, (size_t) 2), max_split_pieces);
+        vector<string> piece_names(piece_count);
+        vector<FILE*> pieces(piece_count);
+        for (size_t i = 0; i < piece_count; i++) {
+            pieces[i] = open_spill_file(piece_names[i]);
+        }
+        vector<size_t> piece_records(piece_count, 0);
+        while ((read = fread(chunk.data(), 1, chunk.size(), file)) > 0) {
+            assert(read % record_size == 0);
+            for (const char* record = chunk.data(); record < chunk.data() + read; record += record_size) {
+                size_t piece = partition_of(record, level + 1, piece_count);
+                if (fwrite(record, 1, record_size, pieces[piece]) != record_size) {
+                    cerr << "error:[KmerCounter] could not write to " << piece_names[piece] << endl;
+                    exit(1);
+                }
+                piece_records[piece]++;
+            }
+        }
+        chunk = vector<char>();
+
+        // If every occurrence went to one piece, they are probably all the
+        // same k-mer, and splitting again won't help.
+        bool unsplittable = *max_element(piece_records.begin(), piece_records.end()) == records;
+        for (size_t i = 0; i < piece_count; i++) {
+            if (piece_records[i]) {
+                count_file(pieces[i], unsplittable ? max_split_levels : level + 1, lambda, min_count);
+            }
+            fclose(pieces[i]);
+            remove(piece_names[i].c_str());
+        }
+        return;
+    }
+
+    unordered_map<string, KmerCount> counts;
+    while ((read = fread(chunk.data(), 1, chunk.size(), file)) > 0) {
+        assert(read % record_size == 0);
+        for (const char* record = chunk.data(); record < chunk.data() + read; record += record_size) {
+            int64_t node_id;
+            int32_t offset;
+            memcpy(&node_id, record + kmer_size, sizeof(node_id));
+            memcpy(&offset, record + kmer_size + sizeof(node_id), sizeof(offset));
+
+            // Compare positions by node, then offset, ignoring strand except
+            // to prefer the forward strand at the same place
+            KmerCount& count = counts[string(record, kmer_size)];
+            if (count.count == 0 || make_tuple(llabs(node_id), abs(offset), node_id < 0)
+                < make_tuple(llabs(count.node_id), abs(count.offset), count.node_id < 0)) {
+                count.node_id = node_id;
+                count.offset = offset;
+            }
+            count.count++;
+        }
+    }
+
+    // Report the frequent k-mers in a stable order
+    vector<KmerCount> frequent;
+    for (auto& kmer_and_count : counts) {
+        if (kmer_and_count.second.count >= min_count) {
+            frequent.push_back(kmer_and_count.second);
+            frequent.back().kmer = kmer_and_count.first;
+        }
+    }
+    counts.clear();
+    sort(frequent.begin(), frequent.end(), [](const KmerCount& a, const KmerCount& b) {
+        return a.kmer < b.kmer;
+    });
+    for (auto& count : frequent) {
+        lambda(count);
+    }
+}
+
+void KmerCounter::write_binary_header(ostream& out, size_t kmer_size) {
+    uint32_t size = kmer_size;
+    out.write((const char*) &size, sizeof(size));
+}
+
+void KmerCounter::write_binary(ostream& out, const KmerCount& count) {
+    out.write(count.kmer.data(), count.kmer.size());
+    out.write((const char*) &count.count, sizeof(count.count));
+    out.write((const char*) &count.node_id, sizeof(count.node_id));
+    out.write((const char*) &count.offset, sizeof(count.offset));
+}
+
+}
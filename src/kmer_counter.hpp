@@ -0,0 +1,105 @@
+#ifndef VG_KMER_COUNTER_HPP_INCLUDED
+#define VG_KMER_COUNTER_HPP_INCLUDED
+
+/** \file
+ * Counting of distinct k-mers in bounded memory (vg kmers --count).
+ *
+ * K-mer occurrences are partitioned by hash into per-thread buffers, which are
+ * spilled to one temporary file per partition whenever the memory budget is
+ * used up. The partitions are then counted one at a time, so only one
+ * partition's distinct k-mers are ever held in memory together. A partition
+ * too big to count within the budget is split again, by a differently salted
+ * hash, until its pieces fit.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+namespace vg {
+
+using namespace std;
+
+/// A distinct k-mer, how many times it occurs, and where it first occurs
+struct KmerCount {
+    string kmer;
+    uint64_t count = 0;
+    /// Node ID of the first occurrence, negated if it is on the reverse strand
+    int64_t node_id = 0;
+    /// Offset of the first occurrence, negated if it is on the reverse strand
+    int32_t offset = 0;
+};
+
+/**
+ * Counts occurrences of fixed-size k-mers, spilling to disk to stay within a
+ * memory budget. Occurrences may be added from many threads at once.
+ */
+class KmerCounter {
+public:
+    /// Count k-mers of the given size, buffering about memory_budget bytes of
+    /// occurrences in memory before spilling them to temporary files, and
+    /// counting no more k-mers at once than should fit in memory_budget bytes.
+    KmerCounter(size_t kmer_size, size_t memory_budget, size_t partitions = 64);
+
+    /// Removes the temporary files
+    ~KmerCounter();
+
+    /// Record an occurrence of a k-mer at a position, in the signed
+    /// orientation encoding vg kmers uses. May be called from multiple threads
+    /// at once.
+    void add(const string& kmer, int64_t node_id, int32_t offset);
+
+    /// Call the given function on each distinct k-mer that occurs at least
+    /// min_count times. The first occurrence of a k-mer is its occurrence with
+    /// the smallest absolute node ID, then absolute offset, preferring the
+    /// forward strand. K-mers come one partition at a time,
+    /// sorted within each partition. Must not run concurrently with add().
+    void for_each_count(const function<void(const KmerCount&)>& lambda, size_t min_count = 1);
+
+    /// Write the header for a binary k-mer count file: the k-mer size as a
+    /// uint32_t.
+    static void write_binary_header(ostream& out, size_t kmer_size);
+
+    /// Write a count in binary: the k-mer's kmer_size characters, then the
+    /// count as a uint64_t, the node ID as an int64_t and the offset as an
+    /// int32_t, all in host byte order.
+    static void write_binary(ostream& out, const KmerCount& count);
+
+private:
+    size_t kmer_size;
+    size_t partitions;
+    size_t memory_budget;
+    /// Bytes of buffered occurrences each thread may hold before it spills
+    size_t thread_budget;
+    /// Bytes in one serialized occurrence
+    size_t record_size;
+
+    /// Serialized occurrences waiting to be spilled, by thread and partition
+    vector<vector<vector<char>>> buffers;
+    /// Total bytes buffered by each thread
+    vector<size_t> buffered_bytes;
+
+    /// Spill file for each partition, and a lock to append to it
+    vector<string> spill_file_names;
+    vector<FILE*> spill_files;
+    vector<omp_lock_t> spill_locks;
+
+    /// Append all of a thread's buffered occurrences to the spill files
+    void spill(size_t thread);
+
+    /// Which of the given number of partitions a k-mer goes to, at the given
+    /// level of splitting
+    size_t partition_of(const char* kmer, size_t level, size_t partition_count) const;
+
+    /// Count the occurrences in a spill file, which was split out at the
+    /// given level, splitting it further if its k-mers may not fit in memory
+    void count_file(FILE* file, size_t level, const function<void(const KmerCount&)>& lambda, size_t min_count);
+};
+
+}
+
+#endif
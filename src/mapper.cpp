@@ -1,6 +1,7 @@
 #include <unordered_set>
 #include "mapper.hpp"
 #include "algorithms/vg_algorithms.hpp"
+#include "stage_profiler.hpp"
 
 //#define debug_mapper
 
@@ -26,6 +27,7 @@ BaseMapper::BaseMapper(xg::XG* xidex,
     , max_mapping_quality(60)
     , strip_bonuses(false)
     , assume_acyclic(false)
+    , mem_overlay(nullptr)
 {
     init_aligner(default_match, default_mismatch, default_gap_open,
                  default_gap_extension, default_full_length_bonus);
@@ -33,6 +35,7 @@ BaseMapper::BaseMapper(xg::XG* xidex,
     init_node_start_cache();
     init_node_pos_cache();
     init_edge_cache();
+    init_rescue_graph_cache();
     
     // TODO: removing these consistency checks because we seem to have violated them pretty wontonly in
     // the code base already by changing the members directly when they were still public
@@ -79,6 +82,9 @@ BaseMapper::~BaseMapper(void) {
     for (auto& ec : edge_cache) {
         delete ec;
     }
+    for (auto& rgc : rescue_graph_cache) {
+        delete rgc;
+    }
 }
     
 // Use the GCSA2 index to find super-maximal exact matches.
@@ -284,6 +290,8 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
                                                      int min_mem_length,
                                                      int reseed_length) {
     
+    PROFILE_STAGE(MEMS);
+    
 #ifdef debug_mapper
 #pragma omp critical
     {
@@ -570,6 +578,11 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
         
     }
     
+    if (mem_overlay) {
+        // the index is from an older graph, so move the hits over and add what it's missing
+        mem_overlay->adjust_mems(seq_begin, seq_end, mems, hit_max);
+    }
+    
     // return the MEMs in order along the read
     // TODO: there should actually be a linear time method to merge and order the sub-MEMs, since
     // they are ordered by the parent MEMs
@@ -1160,6 +1173,7 @@ void BaseMapper::set_alignment_threads(int new_thread_count) {
     init_node_start_cache();
     init_node_pos_cache();
     init_edge_cache();
+    init_rescue_graph_cache();
 }
 
 void BaseMapper::init_node_cache(void) {
@@ -1202,12 +1216,23 @@ void BaseMapper::init_edge_cache(void) {
     }
 }
 
+void BaseMapper::init_rescue_graph_cache(void) {
+    for (auto& rgc : rescue_graph_cache) {
+        delete rgc;
+    }
+    rescue_graph_cache.clear();
+    for (int i = 0; i < alignment_threads; ++i) {
+        rescue_graph_cache.push_back(new LRUCache<int64_t, pair<int, Graph> >(cache_size));
+    }
+}
+
 void BaseMapper::set_cache_size(int new_cache_size) {
     cache_size = new_cache_size;
     init_edge_cache();
     init_node_cache();
     init_node_pos_cache();
     init_node_start_cache();
+    init_rescue_graph_cache();
 }
 
 // TODO: this strategy of dropping the index down to 0 works for vg map's approach of having a copy of
@@ -1232,6 +1257,11 @@ LRUCache<id_t, vector<Edge> >& BaseMapper::get_edge_cache(void) {
     return *edge_cache[tid];
 }
 
+LRUCache<int64_t, pair<int, Graph> >& BaseMapper::get_rescue_graph_cache(void) {
+    int tid = rescue_graph_cache.size() > 1 ? omp_get_thread_num() : 0;
+    return *rescue_graph_cache[tid];
+}
+
 void BaseMapper::clear_aligners(void) {
     delete qual_adj_aligner;
     delete regular_aligner;
@@ -1320,6 +1350,10 @@ Mapper::Mapper(xg::XG* xidex,
     , extra_multimaps(512)
     , band_multimaps(4)
     , always_rescue(false)
+    , annotate_haplotype_counts(false)
+    , fast_surject(true)
+    , surjections_projected(0)
+    , surjections_realigned(0)
     , max_cluster_mapping_quality(1024)
     , use_cluster_mq(false)
     , simultaneous_pair_alignment(true)
@@ -1329,6 +1363,7 @@ Mapper::Mapper(xg::XG* xidex,
     , maybe_mq_threshold(10)
     , min_banded_mq(0)
     , max_band_jump(0)
+    , long_read_chaining(false)
     , identity_weight(2)
 {
     
@@ -1520,8 +1555,8 @@ pos_t Mapper::likely_mate_position(const Alignment& aln, bool is_first_mate) {
     //return make_pos_t(target, target_is_rev, 0);
 }
 
-bool Mapper::pair_rescue(Alignment& mate1, Alignment& mate2, int match_score, bool traceback) {
-    auto pair_sig = signature(mate1, mate2);
+bool Mapper::rescue_target(const Alignment& mate1, const Alignment& mate2, int match_score,
+                           bool& rescue_off_first, pos_t& mate_pos) {
     // bail out if we can't figure out how far to go
     if (!frag_stats.fragment_size) return false;
     //double hang_threshold = 0.9;
@@ -1533,11 +1568,8 @@ bool Mapper::pair_rescue(Alignment& mate1, Alignment& mate2, int match_score, bo
     //double retry_threshold = mate1.sequence().size() * aligner->match * 0.3;
     // based on our statistics about the alignments
     // get the subgraph overlapping the likely candidate position of the second alignment
-    bool rescue_off_first = false;
-    bool rescue_off_second = false;
     double mate1_id = (double) mate1.score() / perfect_score;
     double mate2_id = (double) mate2.score() / perfect_score;
-    pos_t mate_pos;
     if (debug) cerr << "pair rescue: mate1 " << signature(mate1) << " " << mate1_id << " mate2 " << signature(mate2) << " " << mate2_id << " consistent? " << consistent << endl;
     //if (debug) cerr << "mate1: " << pb2json(mate1) << endl;
     //if (debug) cerr << "mate2: " << pb2json(mate2) << endl;
@@ -1560,7 +1592,7 @@ bool Mapper::pair_rescue(Alignment& mate1, Alignment& mate2, int match_score, bo
             if (debug) cerr << "Rescue read 1 off of read 2" << endl;
         }
 #endif
-        rescue_off_second = true;
+        rescue_off_first = false;
         // record id and direction to second mate
         mate_pos = likely_mate_position(mate2, false);
     } else {
@@ -1573,54 +1605,136 @@ bool Mapper::pair_rescue(Alignment& mate1, Alignment& mate2, int match_score, bo
     }
     if (id(mate_pos) == 0) return false; // can't rescue because the selected mate is unaligned
 #endif
-    auto& node_cache = get_node_cache();
-    auto& edge_cache = get_edge_cache();
-    int get_at_least = (!frag_stats.cached_fragment_length_mean ? frag_stats.fragment_max
-                        : max((int)frag_stats.cached_fragment_length_stdev * 6 + mate1.sequence().size(),
-                              mate1.sequence().size() * 4));
+    return true;
+}
+
+int Mapper::rescue_context_length(const Alignment& mate) {
+    return (!frag_stats.cached_fragment_length_mean ? frag_stats.fragment_max
+            : max((int)frag_stats.cached_fragment_length_stdev * 6 + mate.sequence().size(),
+                  mate.sequence().size() * 4));
+}
+
+Graph Mapper::rescue_graph(const pos_t& mate_pos, int get_at_least) {
     Graph graph = xindex->graph_context_id(mate_pos, get_at_least/2);
     graph.MergeFrom(xindex->graph_context_id(reverse(mate_pos, get_node_length(id(mate_pos))), get_at_least/2));
     sort_by_id_dedup_and_clean(graph);
     //graph.remove_orphan_edges();
     //if (debug) cerr << "rescue got graph " << pb2json(graph.graph) << endl;
+    return graph;
+}
+
+int64_t Mapper::rescue_window(const pos_t& mate_pos, int get_at_least) {
+    return approx_position(make_pos_t(id(mate_pos), false, 0)) / get_at_least;
+}
+
+Graph Mapper::rescue_window_graph(int64_t window, int get_at_least) {
+    auto& cache = get_rescue_graph_cache();
+    auto cached = cache.retrieve(window);
+    if (cached.second && cached.first.first == get_at_least) {
+        return cached.first.second;
+    }
+    // take the context of the first and last nodes of the window and
+    // everything between them, which covers the context of any node in it
+    id_t first = node_approximately_at(window * get_at_least);
+    id_t last = node_approximately_at((window + 1) * get_at_least);
+    Graph graph = rescue_graph(make_pos_t(first, false, 0), get_at_least);
+    graph.MergeFrom(rescue_graph(make_pos_t(last, false, 0), get_at_least));
+    xindex->get_id_range(first, last, graph);
+    sort_by_id_dedup_and_clean(graph);
+    cache.put(window, make_pair(get_at_least, graph));
+    return graph;
+}
+
+bool Mapper::rescue_flip(const Alignment& anchor) {
     // if we're reversed, align the reverse sequence and flip it back
-    // align against it
-    if (rescue_off_first) {
-        bool flip = !mate1.path().mapping(0).position().is_reverse() && !frag_stats.cached_fragment_orientation
-            || mate1.path().mapping(0).position().is_reverse() && frag_stats.cached_fragment_orientation;
-        Alignment aln2 = align_maybe_flip(mate2, graph, flip, traceback);
+    return !anchor.path().mapping(0).position().is_reverse() && !frag_stats.cached_fragment_orientation
+        || anchor.path().mapping(0).position().is_reverse() && frag_stats.cached_fragment_orientation;
+}
+
+bool Mapper::pair_rescue(Alignment& mate1, Alignment& mate2, int match_score, bool traceback) {
+    bool rescue_off_first;
+    pos_t mate_pos;
+    if (!rescue_target(mate1, mate2, match_score, rescue_off_first, mate_pos)) {
+        return false;
+    }
+    PROFILE_STAGE(RESCUE);
+    PROFILE_COUNT(RESCUES_ATTEMPTED, 1);
+    int get_at_least = rescue_context_length(mate1);
+    Graph graph = rescue_window_graph(rescue_window(mate_pos, get_at_least), get_at_least);
+    // align the mate we aren't rescuing off against it
+    Alignment& anchor = (rescue_off_first ? mate1 : mate2);
+    Alignment& mate = (rescue_off_first ? mate2 : mate1);
+    Alignment aln = align_maybe_flip(mate, graph, rescue_flip(anchor), traceback);
 #ifdef debug_mapper
 #pragma omp critical
-        {
-            if (debug) cerr << "aln2 score/ident vs " << aln2.score() << "/" << aln2.identity()
-                            << " vs " << mate2.score() << "/" << mate2.identity() << endl;
-        }
+    {
+        if (debug) cerr << "rescued score/ident vs " << aln.score() << "/" << aln.identity()
+                        << " vs " << mate.score() << "/" << mate.identity() << endl;
+    }
 #endif
-        if (aln2.score() > mate2.score()) {
-            mate2 = aln2;
-        } else {
-            return false;
+    // if the new alignment is better
+    // set the old alignment to it
+    if (aln.score() > mate.score()) {
+        mate = aln;
+    } else {
+        return false;
+    }
+    PROFILE_COUNT(RESCUES_SUCCEEDED, 1);
+    return true;
+}
+
+bool Mapper::pair_rescue_batch(const vector<pair<Alignment, Alignment>*>& pairs, int match_score, bool traceback) {
+    if (!frag_stats.fragment_size) return false;
+    // Rescue subgraphs by the window of the graph they cover and how far they
+    // reach, so that all the pairs aiming somewhere in the window share one
+    // extraction (which the rescue graph cache also shares with later batches)
+    map<pair<int64_t, int>, Graph> graphs;
+    // Realignments by subgraph, strand and the whole mate being realigned, so
+    // a mate that turns up unchanged in several pairs is only aligned once
+    // against each subgraph on each strand
+    map<tuple<int64_t, int, bool, string>, Alignment> realignments;
+    bool rescued = false;
+    for (auto p : pairs) {
+        auto& mate1 = p->first;
+        auto& mate2 = p->second;
+        bool rescue_off_first;
+        pos_t mate_pos;
+        if (!rescue_target(mate1, mate2, match_score, rescue_off_first, mate_pos)) {
+            continue;
+        }
+        PROFILE_STAGE(RESCUE);
+        PROFILE_COUNT(RESCUES_ATTEMPTED, 1);
+        int get_at_least = rescue_context_length(mate1);
+        Alignment& anchor = (rescue_off_first ? mate1 : mate2);
+        Alignment& mate = (rescue_off_first ? mate2 : mate1);
+        bool flip = rescue_flip(anchor);
+        int64_t window = rescue_window(mate_pos, get_at_least);
+
+        auto key = make_tuple(window, get_at_least, flip, mate.SerializeAsString());
+        auto found = realignments.find(key);
+        if (found == realignments.end()) {
+            auto graph_key = make_pair(window, get_at_least);
+            auto found_graph = graphs.find(graph_key);
+            if (found_graph == graphs.end()) {
+                found_graph = graphs.emplace(graph_key, rescue_window_graph(window, get_at_least)).first;
+            }
+            found = realignments.emplace(key, align_maybe_flip(mate, found_graph->second, flip, traceback)).first;
         }
-    } else if (rescue_off_second) {
-        bool flip = !mate2.path().mapping(0).position().is_reverse() && !frag_stats.cached_fragment_orientation
-            || mate2.path().mapping(0).position().is_reverse() && frag_stats.cached_fragment_orientation;
-        Alignment aln1 = align_maybe_flip(mate1, graph, flip, traceback);
+        const Alignment& aln = found->second;
 #ifdef debug_mapper
 #pragma omp critical
         {
-            if (debug) cerr << "aln1 score/ident vs " << aln1.score() << "/" << aln1.identity()
-                            << " vs " << mate1.score() << "/" << mate1.identity() << endl;
+            if (debug) cerr << "rescued score/ident vs " << aln.score() << "/" << aln.identity()
+                            << " vs " << mate.score() << "/" << mate.identity() << endl;
         }
 #endif
-        if (aln1.score() > mate1.score()) {
-            mate1 = aln1;
-        } else {
-            return false;
+        if (aln.score() > mate.score()) {
+            mate = aln;
+            rescued = true;
+            PROFILE_COUNT(RESCUES_SUCCEEDED, 1);
         }
     }
-    // if the new alignment is better
-    // set the old alignment to it
-    return true;
+    return rescued;
 }
 
 bool Mapper::alignments_consistent(const map<string, double>& pos1,
@@ -1688,6 +1802,10 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
     bool only_top_scoring_pair,
     bool retrying) {
 
+    if (!retrying) {
+        PROFILE_COUNT(READS, 2);
+    }
+
     Alignment read1;
     read1.set_name(first_mate.name());
     read1.set_sequence(first_mate.sequence());
@@ -1746,6 +1864,7 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
                                                      max_mem_length,
                                                      min_mem_length,
                                                      mem_reseed_length);
+    PROFILE_COUNT(MEMS_FOUND, mems1.size() + mems2.size());
 
     double mq_cap1, mq_cap2;
     mq_cap1 = mq_cap2 = max_mapping_quality;
@@ -1967,6 +2086,7 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
     vector<vector<MaximalExactMatch> > clusters;
     if (total_multimaps) {
         // We're going to run the chainer because we want to calculate alignments
+        PROFILE_STAGE(CLUSTER);
         
         // What band width during the alignment should the chainer plan for?
         int band_width = max((int)(read1.sequence().size() + read2.sequence().size()),
@@ -1991,6 +2111,7 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
                               transition_weight,
                               band_width);
         clusters = chainer.traceback(total_multimaps, true, debug);
+        PROFILE_COUNT(CLUSTERS_FOUND, clusters.size());
     }
 
     auto show_clusters = [&](void) {
@@ -2319,6 +2440,28 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
         }
     }
 
+    if (mate_rescues && frag_stats.fragment_size) {
+        // go through the best pairs and see if we need to rescue one side off the other,
+        // sharing subgraphs and realignments between pairs that aim for the same place
+        vector<pair<Alignment, Alignment>*> to_rescue(aln_ptrs.begin(),
+                                                      aln_ptrs.begin() + min(aln_ptrs.size(),
+                                                                             (size_t) min(mate_rescues, max_multimaps)));
+        rescued = pair_rescue_batch(to_rescue, match, true);
+        if (rescued) {
+            for (auto& p : to_rescue) {
+                auto& aln1 = p->first;
+                auto& aln2 = p->second;
+                aln1.clear_fragment();
+                aln2.clear_fragment();
+                auto approx_frag_lengths = approx_pair_fragment_length(aln1, aln2);
+                frag_stats.save_frag_lens_to_alns(aln1, aln2, approx_frag_lengths, pair_consistent(aln1, aln2, 0.01));
+            }
+            sort_and_dedup();
+        }
+#pragma omp critical
+        show_alignments("rescue");
+    }
+
     int read1_max_score = 0;
     int read2_max_score = 0;
     // build up the results
@@ -2457,6 +2600,8 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
     // if we have references, annotate the alignments with their reference positions
     annotate_with_mean_path_positions(results.first);
     annotate_with_mean_path_positions(results.second);
+    annotate_with_haplotype_counts(results.first);
+    annotate_with_haplotype_counts(results.second);
 
     return results;
 
@@ -2472,6 +2617,18 @@ void Mapper::annotate_with_mean_path_positions(vector<Alignment>& alns) {
     }
 }
 
+void Mapper::annotate_with_haplotype_counts(vector<Alignment>& alns) {
+    if (!annotate_haplotype_counts) {
+        return;
+    }
+    // We are already running in a per-read thread, so use the serial search
+    for (auto& aln : alns) {
+        if (aln.path().mapping_size() > 0) {
+            aln.set_haplotype_count(xindex->count_matches(aln.path()));
+        }
+    }
+}
+
 double Mapper::compute_cluster_mapping_quality(const vector<vector<MaximalExactMatch> >& clusters,
                                                int read_length) {
     if (clusters.size() == 0) {
@@ -2670,11 +2827,13 @@ Mapper::align_mem_multi(const Alignment& aln,
     // establish the chains
     vector<vector<MaximalExactMatch> > clusters;
     if (total_multimaps) {
+        PROFILE_STAGE(CLUSTER);
         MEMChainModel chainer({ aln.sequence().size() }, { mems },
             [&](pos_t n) {
                 return approx_position(n);
             }, transition_weight, aln.sequence().size());
         clusters = chainer.traceback(total_multimaps, false, debug);
+        PROFILE_COUNT(CLUSTERS_FOUND, clusters.size());
     }
     
     /*
@@ -2928,15 +3087,22 @@ Alignment Mapper::align_cluster(const Alignment& aln, const vector<MaximalExactM
         }
     }
     // get the graph with cluster.hpp's cluster_subgraph
-    Graph graph = cluster_subgraph(*xindex, aln, mems);
+    Graph graph;
+    {
+        PROFILE_STAGE(SUBGRAPH);
+        graph = cluster_subgraph(*xindex, aln, mems);
+    }
     // and test each direction for which we have MEM hits
     Alignment aln_fwd;
     Alignment aln_rev;
-    if (count_fwd) {
-        aln_fwd = align_maybe_flip(aln, graph, false, traceback);
-    }
-    if (count_rev) {
-        aln_rev = align_maybe_flip(aln, graph, true, traceback);
+    {
+        PROFILE_STAGE(ALIGN);
+        if (count_fwd) {
+            aln_fwd = align_maybe_flip(aln, graph, false, traceback);
+        }
+        if (count_rev) {
+            aln_rev = align_maybe_flip(aln, graph, true, traceback);
+        }
     }
     // TODO check if we have soft clipping on the end of the graph and if so try to expand the context
     if (aln_fwd.score() + aln_rev.score() == 0) {
@@ -3199,17 +3365,87 @@ void FragmentLengthStatistics::record_fragment_configuration(int length, const A
         auto last = fragment_lengths.back();
         fragment_lengths.pop_back();
     }
+    recorded_fragments = min(recorded_fragments + 1, fragment_lengths.size());
     if (++since_last_fragment_length_estimate > fragment_model_update_interval) {
-        cached_fragment_length_mean = fragment_length_mean();
-        cached_fragment_length_stdev = fragment_length_stdev();
-        cached_fragment_orientation = fragment_orientation();
-        cached_fragment_direction = fragment_direction();
-        // set our fragment size cap to the cached mean + 10x the standard deviation
-        fragment_size = cached_fragment_length_mean + fragment_sigma * cached_fragment_length_stdev;
-        since_last_fragment_length_estimate = 1;
+        update_cached_model();
+    }
+}
+
+void FragmentLengthStatistics::update_cached_model(void) {
+    cached_fragment_length_mean = fragment_length_mean();
+    cached_fragment_length_stdev = fragment_length_stdev();
+    cached_fragment_orientation = fragment_orientation();
+    cached_fragment_direction = fragment_direction();
+    // set our fragment size cap to the cached mean + 10x the standard deviation
+    fragment_size = cached_fragment_length_mean + fragment_sigma * cached_fragment_length_stdev;
+    since_last_fragment_length_estimate = 1;
+}
+
+void FragmentLengthStatistics::merge(const FragmentLengthStatistics& other) {
+    // the other thread's own configurations are the most recent ones
+    size_t recorded = other.recorded_fragments;
+    fragment_lengths.insert(fragment_lengths.end(), other.fragment_lengths.begin(),
+                            other.fragment_lengths.begin() + recorded);
+    fragment_orientations.insert(fragment_orientations.end(), other.fragment_orientations.begin(),
+                                 other.fragment_orientations.begin() + recorded);
+    fragment_directions.insert(fragment_directions.end(), other.fragment_directions.begin(),
+                               other.fragment_directions.begin() + recorded);
+    if (!fixed_fragment_model && !fragment_lengths.empty()) {
+        update_cached_model();
+    }
+}
+
+void FragmentLengthStatistics::save_fragment_model(ostream& out) {
+    out << fragment_model_str() << endl;
+    for (size_t i = 0; i < fragment_lengths.size(); ++i) {
+        out << fragment_lengths[i] << "\t"
+            << fragment_orientations[i] << "\t"
+            << fragment_directions[i] << endl;
     }
 }
 
+bool FragmentLengthStatistics::load_fragment_model(istream& in) {
+    string line;
+    if (!getline(in, line)) return false;
+    vector<string> parts = split_delims(line, ":");
+    if (parts.size() != 5) return false;
+    int size;
+    double mean, stdev;
+    bool orientation, direction;
+    if (!(stringstream(parts[0]) >> size) || !(stringstream(parts[1]) >> mean)
+        || !(stringstream(parts[2]) >> stdev) || !(stringstream(parts[3]) >> orientation)
+        || !(stringstream(parts[4]) >> direction)) {
+        return false;
+    }
+    deque<double> lengths;
+    deque<bool> orientations;
+    deque<bool> directions;
+    while (getline(in, line)) {
+        if (line.empty()) continue;
+        stringstream fields(line);
+        double length;
+        bool same_orientation, same_direction;
+        if (!(fields >> length >> same_orientation >> same_direction)) return false;
+        // keep the most recent pairs, which come first
+        if (lengths.size() < (size_t) fragment_length_cache_size) {
+            lengths.push_back(length);
+            orientations.push_back(same_orientation);
+            directions.push_back(same_direction);
+        }
+    }
+    fragment_size = size;
+    cached_fragment_length_mean = mean;
+    cached_fragment_length_stdev = stdev;
+    cached_fragment_orientation = orientation;
+    cached_fragment_direction = direction;
+    fragment_lengths = lengths;
+    fragment_orientations = orientations;
+    fragment_directions = directions;
+    recorded_fragments = 0;
+    since_last_fragment_length_estimate = 1;
+    return true;
+}
+
 double FragmentLengthStatistics::fragment_length_stdev(void) {
     return stdev(fragment_lengths);
 }
@@ -3490,6 +3726,10 @@ vector<Alignment> Mapper::make_bands(const Alignment& read, int band_width, vect
 
 vector<Alignment> Mapper::align_banded(const Alignment& read, int kmer_size, int stride, int max_mem_length, int band_width) {
 
+    if (long_read_chaining) {
+        return align_chained(read, max_mem_length, band_width);
+    }
+
     int match;
     int gap_extension;
     int gap_open;
@@ -3626,6 +3866,171 @@ vector<Alignment> Mapper::align_banded(const Alignment& read, int kmer_size, int
     return alignments;
 }
 
+vector<Alignment> Mapper::align_chained(const Alignment& read, int max_mem_length, int band_width) {
+
+    int match;
+    int gap_extension;
+    int gap_open;
+    if (read.quality().empty() || !adjust_alignments_for_base_quality) {
+        match = regular_aligner->match;
+        gap_extension = regular_aligner->gap_extension;
+        gap_open = regular_aligner->gap_open;
+    }
+    else {
+        match = qual_adj_aligner->match;
+        gap_extension = qual_adj_aligner->gap_extension;
+        gap_open = qual_adj_aligner->gap_open;
+    }
+
+    // seed the whole read once
+    double longest_lcp;
+    vector<MaximalExactMatch> mems = find_mems_deep(read.sequence().begin(),
+                                                    read.sequence().end(),
+                                                    longest_lcp,
+                                                    max_mem_length,
+                                                    min_mem_length,
+                                                    mem_reseed_length);
+    PROFILE_COUNT(MEMS_FOUND, mems.size());
+
+    // chain MEMs on the same strand whose spacing in the read and in the graph
+    // differ by no more than the largest variant we want to detect
+    int max_jump = max(max_band_jump, band_width);
+    auto transition_weight = [&](const MaximalExactMatch& m1, const MaximalExactMatch& m2) {
+        pos_t m1_pos = make_pos_t(m1.nodes.front());
+        pos_t m2_pos = make_pos_t(m2.nodes.front());
+        if (is_rev(m1_pos) != is_rev(m2_pos)) {
+            // disable inversions
+            return -std::numeric_limits<double>::max();
+        }
+        int64_t approx_dist = abs(approx_distance(m1_pos, m2_pos));
+        double jump = abs((m2.begin - m1.begin) - approx_dist);
+        if (jump > max_jump) {
+            return -std::numeric_limits<double>::max();
+        }
+        int duplicate_coverage = mems_overlap_length(m1, m2);
+        if (jump) {
+            return (double) -duplicate_coverage * match - (gap_open + jump * gap_extension);
+        } else {
+            return (double) -duplicate_coverage * match;
+        }
+    };
+
+    vector<vector<MaximalExactMatch> > chains;
+    if (!mems.empty()) {
+        PROFILE_STAGE(CLUSTER);
+        MEMChainModel chainer({ read.sequence().size() }, { mems },
+            [&](pos_t n) {
+                return approx_position(n);
+            }, transition_weight, read.sequence().size() + max_jump);
+        chains = chainer.traceback(max_multimaps + 1, false, debug);
+        PROFILE_COUNT(CLUSTERS_FOUND, chains.size());
+    }
+
+    vector<Alignment> alignments;
+    for (auto& chain : chains) {
+        // cut the read into segments of about band_width, each carrying the
+        // MEMs of the chain that fall in it; stretches of more than band_width
+        // without any MEMs get segments of their own and are left unaligned
+        auto seq_begin = read.sequence().begin();
+        size_t flank = band_width / 2;
+        vector<pair<size_t, size_t>> segment_bounds;
+        vector<vector<MaximalExactMatch>> segment_mems;
+        size_t segment_begin = 0;
+        vector<MaximalExactMatch> current_mems;
+        auto close_segment = [&](size_t segment_end) {
+            if (segment_end > segment_begin) {
+                segment_bounds.push_back(make_pair(segment_begin, segment_end));
+                segment_mems.push_back(current_mems);
+            }
+            segment_begin = segment_end;
+            current_mems.clear();
+        };
+        for (auto& mem : chain) {
+            size_t mem_begin = mem.begin - seq_begin;
+            size_t mem_end = mem.end - seq_begin;
+            if (current_mems.empty()) {
+                if (mem_begin > segment_begin + flank) {
+                    close_segment(mem_begin - flank);
+                }
+            } else {
+                size_t prev_end = current_mems.back().end - seq_begin;
+                // never cut through overlapping MEMs
+                if (mem_begin >= prev_end && mem_end - segment_begin > (size_t) band_width) {
+                    if (mem_begin - prev_end > 2 * flank) {
+                        close_segment(prev_end + flank);
+                        close_segment(mem_begin - flank);
+                    } else {
+                        close_segment((prev_end + mem_begin) / 2);
+                    }
+                }
+            }
+            current_mems.push_back(mem);
+        }
+        if (!current_mems.empty()) {
+            size_t prev_end = current_mems.back().end - seq_begin;
+            if (read.sequence().size() > prev_end + flank) {
+                close_segment(prev_end + flank);
+            }
+        }
+        close_segment(read.sequence().size());
+
+        // make the segments, and point their MEMs into the segment sequences
+        vector<Alignment> segments(segment_bounds.size());
+        for (size_t i = 0; i < segments.size(); ++i) {
+            size_t length = segment_bounds[i].second - segment_bounds[i].first;
+            segments[i].set_name(read.name());
+            segments[i].set_sequence(read.sequence().substr(segment_bounds[i].first, length));
+            if (!read.quality().empty()) {
+                segments[i].set_quality(read.quality().substr(segment_bounds[i].first, length));
+            }
+        }
+        for (size_t i = 0; i < segments.size(); ++i) {
+            for (auto& mem : segment_mems[i]) {
+                size_t length = mem.length();
+                mem.begin = segments[i].sequence().begin() + (mem.begin - seq_begin - segment_bounds[i].first);
+                mem.end = mem.begin + length;
+            }
+        }
+
+        vector<Alignment> aligned(segments.size());
+        auto do_segment = [&](int i) {
+            if (!segment_mems[i].empty()) {
+                aligned[i] = align_cluster(segments[i], segment_mems[i], true);
+            }
+            if (!aligned[i].has_path() || aligned[i].identity() < min_identity) {
+                // leave it unaligned for patching
+                aligned[i] = segments[i];
+            }
+        };
+
+        if (alignment_threads > 1) {
+#pragma omp parallel for
+            for (int i = 0; i < segments.size(); ++i) {
+                do_segment(i);
+            }
+        } else {
+            for (int i = 0; i < segments.size(); ++i) {
+                do_segment(i);
+            }
+        }
+
+        Alignment aln = merge_alignments(aligned, debug);
+        aln.set_name(read.name());
+        aln = patch_alignment(aln, band_width);
+        aln.set_score(score_alignment(aln, true));
+        alignments.push_back(aln);
+    }
+
+    if (alignments.empty()) {
+        alignments.push_back(read);
+    }
+    // sort the alignments by score
+    std::sort(alignments.begin(), alignments.end(), [](const Alignment& aln1, const Alignment& aln2) { return aln1.score() > aln2.score(); });
+    compute_mapping_qualities(alignments, 0, max_mapping_quality, max_mapping_quality);
+    filter_and_process_multimaps(alignments, max_multimaps);
+    return alignments;
+}
+
 vector<Alignment> Mapper::resolve_banded_multi(vector<vector<Alignment>>& multi_alns) {
     // use a basic dynamic programming to score the path through the multi mapping
     // we add the score as long as our alignments are within a bandwidth, subtracting the distance
@@ -3778,6 +4183,7 @@ bool Mapper::adjacent_positions(const Position& pos1, const Position& pos2) {
 
 void Mapper::compute_mapping_qualities(vector<Alignment>& alns, double cluster_mq, double mq_estimate, double mq_cap) {
     if (alns.empty()) return;
+    PROFILE_STAGE(MAPQ);
     double max_mq = min(mq_cap, (double)max_mapping_quality);
     BaseAligner* aligner = (alns.front().quality().empty() ? (BaseAligner*) regular_aligner : (BaseAligner*) qual_adj_aligner);
     int sub_overlaps = 0; //sub_overlaps_of_first_aln(alns, mq_overlap);
@@ -3795,6 +4201,7 @@ void Mapper::compute_mapping_qualities(vector<Alignment>& alns, double cluster_m
     
 void Mapper::compute_mapping_qualities(pair<vector<Alignment>, vector<Alignment>>& pair_alns, double cluster_mq, double mq_estimate1, double mq_estimate2, double mq_cap1, double mq_cap2) {
     if (pair_alns.first.empty() || pair_alns.second.empty()) return;
+    PROFILE_STAGE(MAPQ);
     double max_mq1 = min(mq_cap1, (double)max_mapping_quality);
     double max_mq2 = min(mq_cap2, (double)max_mapping_quality);
     BaseAligner* aligner = (pair_alns.first.front().quality().empty() ? (BaseAligner*) regular_aligner : (BaseAligner*) qual_adj_aligner);
@@ -3879,6 +4286,7 @@ void Mapper::filter_and_process_multimaps(vector<Alignment>& sorted_unique_align
 }
     
 vector<Alignment> Mapper::align_multi(const Alignment& aln, int kmer_size, int stride, int max_mem_length, int band_width) {
+    PROFILE_COUNT(READS, 1);
     double cluster_mq = 0;
     Alignment clean_aln;
     clean_aln.set_name(aln.name());
@@ -3952,6 +4360,7 @@ vector<Alignment> Mapper::align_multi_internal(bool compute_unpaired_quality,
                                                         max_mem_length,
                                                         min_mem_length,
                                                         mem_reseed_length);
+        PROFILE_COUNT(MEMS_FOUND, mems.size());
         // query mem hits
         alignments = align_mem_multi(aln, mems, cluster_mq, longest_lcp, max_mem_length, keep_multimaps, additional_multimaps_for_quality);
     }
@@ -3973,6 +4382,7 @@ vector<Alignment> Mapper::align_multi_internal(bool compute_unpaired_quality,
     }
     
     annotate_with_mean_path_positions(alignments);
+    annotate_with_haplotype_counts(alignments);
 
     return alignments;
 }
@@ -4562,6 +4972,19 @@ Alignment Mapper::surject_alignment(const Alignment& source,
 #endif
         return surjection;
     }
+    
+    if (fast_surject && project_onto_path(source, path_names, path_name, path_pos, path_reverse)) {
+        // The read is already on the path, so realigning would just give us the same thing back,
+        // except that the score and identity would be recomputed for it
+        surjections_projected++;
+        surjection = source;
+        BaseAligner* aligner = (adjust_alignments_for_base_quality && !source.quality().empty()) ?
+            (BaseAligner*) qual_adj_aligner : (BaseAligner*) regular_aligner;
+        surjection.set_score(aligner->score_ungapped_alignment(surjection));
+        surjection.set_identity(identity(surjection.path()));
+        return surjection;
+    }
+    surjections_realigned++;
 
     set<id_t> nodes;
     for (int i = 0; i < source.path().mapping_size(); ++ i) {
@@ -4688,6 +5111,109 @@ Alignment Mapper::surject_alignment(const Alignment& source,
     return surjection;
 }
 
+bool Mapper::project_onto_path(const Alignment& source,
+                               const set<string>& path_names,
+                               string& path_name,
+                               int64_t& path_pos,
+                               bool& path_reverse) {
+    
+    const Path& path = source.path();
+    const Mapping& first = path.mapping(0);
+    id_t first_id = first.position().node_id();
+    
+    // Only one of the target paths can touch the read anywhere along it, or we'd have to choose
+    // between them
+    string candidate;
+    set<id_t> checked;
+    for (size_t i = 0; i < path.mapping_size(); i++) {
+        id_t id = path.mapping(i).position().node_id();
+        if (!checked.insert(id).second) {
+            continue;
+        }
+        for (size_t rank : xindex->paths_of_node(id)) {
+            string name = xindex->path_name(rank);
+            if (path_names.count(name) && name != candidate) {
+                if (!candidate.empty()) {
+                    return false;
+                }
+                candidate = name;
+            }
+        }
+    }
+    if (candidate.empty()) {
+        return false;
+    }
+    size_t candidate_length = xindex->path_length(candidate);
+    
+    // Try each place the path visits the first node until we find one the whole read follows
+    for (size_t start : xindex->position_in_path(first_id, candidate)) {
+        
+        // Is the read running backward along the path?
+        bool against = first.position().is_reverse() != xindex->mapping_at_path_position(candidate, start).position().is_reverse();
+        
+        // Where the path enters the node the read is currently on
+        size_t node_start = start;
+        bool on_path = true;
+        for (size_t i = 1; i < path.mapping_size() && on_path; i++) {
+            const Position& prev = path.mapping(i - 1).position();
+            const Position& here = path.mapping(i).position();
+            size_t prev_end = prev.offset() + mapping_from_length(path.mapping(i - 1));
+            
+            if (here.node_id() == prev.node_id() && here.is_reverse() == prev.is_reverse() && here.offset() == prev_end) {
+                // Still on the same node
+                continue;
+            }
+            
+            // Otherwise we need to leave the end of one node for the start of the next
+            size_t here_length = xindex->node_length(here.node_id());
+            if (prev_end != xindex->node_length(prev.node_id()) || here.offset() != 0) {
+                on_path = false;
+                break;
+            }
+            
+            size_t next_start;
+            if (!against) {
+                next_start = node_start + xindex->node_length(prev.node_id());
+                if (next_start >= candidate_length) {
+                    on_path = false;
+                    break;
+                }
+            } else {
+                if (node_start < here_length) {
+                    on_path = false;
+                    break;
+                }
+                next_start = node_start - here_length;
+            }
+            
+            // The path has to visit the next node there, in the orientation the read does
+            Position path_here = xindex->mapping_at_path_position(candidate, next_start).position();
+            if (path_here.node_id() != here.node_id() || (path_here.is_reverse() != here.is_reverse()) != against) {
+                on_path = false;
+                break;
+            }
+            
+            node_start = next_start;
+        }
+        
+        if (on_path) {
+            path_name = candidate;
+            path_reverse = against;
+            if (!against) {
+                path_pos = start + first.position().offset();
+            } else {
+                // The leftmost base on the path is the last base of the read
+                const Mapping& last = path.mapping(path.mapping_size() - 1);
+                path_pos = node_start + xindex->node_length(last.position().node_id())
+                    - last.position().offset() - mapping_from_length(last);
+            }
+            return true;
+        }
+    }
+    
+    return false;
+}
+
 const int balanced_stride(int read_length, int kmer_size, int stride) {
     double r = read_length;
     double k = kmer_size;
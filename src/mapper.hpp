@@ -20,6 +20,7 @@
 #include "entropy.hpp"
 #include "gssw_aligner.hpp"
 #include "mem.hpp"
+#include "mem_overlay.hpp"
 #include "cluster.hpp"
 #include "graph.hpp"
 
@@ -185,6 +186,7 @@ public:
     bool fast_reseed; // use the fast reseed algorithm
     int fast_reseed_length_diff; // how much smaller than its parent a sub-MEM can be in the fast reseed algorithm
     int hit_max;       // ignore or MEMs with more than this many hits
+    MEMOverlay* mem_overlay; // if set, the GCSA2 index is from an older graph and this brings its MEMs up to date
     
     bool strip_bonuses; // remove any bonuses used by the aligners from the final reported scores
     bool assume_acyclic; // the indexed graph is acyclic
@@ -263,6 +265,11 @@ protected:
     LRUCache<id_t, vector<Edge> >& get_edge_cache(void);
     void init_edge_cache(void);
     
+    // rescue subgraphs by window of the graph's sequence, with the context length they were extracted for
+    vector<LRUCache<int64_t, pair<int, Graph> >* > rescue_graph_cache;
+    LRUCache<int64_t, pair<int, Graph> >& get_rescue_graph_cache(void);
+    void init_rescue_graph_cache(void);
+    
     void init_aligner(int8_t match, int8_t mismatch, int8_t gap_open, int8_t gap_extend, int8_t full_length_bonus);
     void clear_aligners(void);
     
@@ -290,6 +297,20 @@ public:
     void record_fragment_configuration(int length, const Alignment& aln1, const Alignment& aln2);
     
     string fragment_model_str(void);
+    
+    /// Pool the configurations another thread recorded itself (not any it
+    /// loaded with load_fragment_model()) into ours, and reestimate from all of
+    /// them unless the model is fixed
+    void merge(const FragmentLengthStatistics& other);
+    
+    /// Write the model, as per fragment_model_str(), on the first line, then a
+    /// "length\tsame orientation\tsame direction" line for each recorded pair,
+    /// most recent first
+    void save_fragment_model(ostream& out);
+    
+    /// Warm-start from a model written by save_fragment_model(). Returns false
+    /// if the model is malformed.
+    bool load_fragment_model(istream& in);
     void save_frag_lens_to_alns(Alignment& aln1, Alignment& aln2, const map<string, int>& approx_frag_lengths, bool is_consistent);
     
     // These functions are the authorities on the estimated parameters
@@ -300,6 +321,9 @@ public:
     bool fragment_orientation(void);
     bool fragment_direction(void);
     
+    // Recompute the cached parameters from the recorded configurations
+    void update_cached_model(void);
+    
     // These cached versions of the parameters are updated periodically
     double cached_fragment_length_mean = 0;
     double cached_fragment_length_stdev = 0;
@@ -314,6 +338,9 @@ public:
     deque<double> fragment_lengths;
     deque<bool> fragment_orientations;
     deque<bool> fragment_directions;
+    // How many of the configurations at the front of the deques were recorded
+    // rather than loaded
+    size_t recorded_fragments = 0;
 
     int fragment_max = 10000; // the maximum length fragment which we will consider when estimating fragment lengths
     int fragment_size = 0; // Used to bound clustering of MEMs during paired end mapping, also acts as sentinel to determine
@@ -363,6 +390,12 @@ private:
                                    int stride = 0,
                                    int max_mem_length = 0,
                                    int band_width = 1000);
+    // Long read alternative to align_banded: find MEMs across the whole read
+    // once, chain them, and align only the stretches of read between chained
+    // MEMs, cutting the read into pieces of about band_width.
+    vector<Alignment> align_chained(const Alignment& read,
+                                    int max_mem_length = 0,
+                                    int band_width = 1000);
     // alignment based on the MEM approach
 //    vector<Alignment> align_mem_multi(const Alignment& alignment, vector<MaximalExactMatch>& mems, double& cluster_mq, double lcp_avg, int max_mem_length, int additional_multimaps = 0);
     // uses approximate-positional clustering based on embedded paths in the xg index to find and align against alignment targets
@@ -390,6 +423,8 @@ public:
     // use the xg index to get the mean position of the nodes in the alignent for each reference that it corresponds to
     map<string, double> alignment_mean_path_positions(const Alignment& aln, bool first_hit_only = true);
     void annotate_with_mean_path_positions(vector<Alignment>& alns);
+    // use the gPBWT in the xg index to count the haplotypes consistent with each alignment's path
+    void annotate_with_haplotype_counts(vector<Alignment>& alns);
 
     // Return true of the two alignments are consistent for paired reads, and false otherwise
     bool alignments_consistent(const map<string, double>& pos1,
@@ -403,6 +438,23 @@ public:
 
     // use the fragment configuration statistics to rescue more precisely
     bool pair_rescue(Alignment& mate1, Alignment& mate2, int match_score, bool traceback);
+    // rescue a batch of pairs, which may be of different reads, extracting one rescue subgraph
+    // for each window of the graph the pairs aim for and realigning each distinct mate against it only once
+    bool pair_rescue_batch(const vector<pair<Alignment, Alignment>*>& pairs, int match_score, bool traceback);
+    // decide whether and where to rescue one mate off the other
+    bool rescue_target(const Alignment& mate1, const Alignment& mate2, int match_score,
+                       bool& rescue_off_first, pos_t& mate_pos);
+    // how much graph to extract around the rescue target
+    int rescue_context_length(const Alignment& mate);
+    // the cleaned-up subgraph around the rescue target
+    Graph rescue_graph(const pos_t& mate_pos, int get_at_least);
+    // which window of get_at_least bases of the graph's sequence the rescue target is in
+    int64_t rescue_window(const pos_t& mate_pos, int get_at_least);
+    // one subgraph covering the rescue subgraph of every target in the window, shared
+    // through the rescue graph cache by all the pairs this thread rescues there
+    Graph rescue_window_graph(int64_t window, int get_at_least);
+    // whether to align the rescued mate's reverse complement, given the mate we rescue off
+    bool rescue_flip(const Alignment& anchor);
     
     vector<Alignment> resolve_banded_multi(vector<vector<Alignment>>& multi_alns);
     set<MaximalExactMatch*> resolve_paired_mems(vector<MaximalExactMatch>& mems1,
@@ -495,6 +547,14 @@ public:
                                 int64_t& path_pos,
                                 bool& path_reverse,
                                 int window);
+    
+    // if the alignment already runs along exactly one of the given paths, find where without realigning
+    // returns false if the alignment leaves the path or could belong to more than one of them
+    bool project_onto_path(const Alignment& source,
+                           const set<string>& path_names,
+                           string& path_name,
+                           int64_t& path_pos,
+                           bool& path_reverse);
 
     
     // compute a mapping quality component based only on the MEMs we've obtained
@@ -561,9 +621,16 @@ public:
     double identity_weight; // scale mapping quality by the alignment score identity to this power
 
     bool always_rescue; // Should rescue be attempted for all imperfect alignments?
+    bool annotate_haplotype_counts; // Should alignments be annotated with the number of consistent haplotypes?
+    bool fast_surject; // Should surjection project alignments that already lie on the path instead of realigning them?
+    
+    // how many surjections were done by projection and by realignment
+    size_t surjections_projected;
+    size_t surjections_realigned;
     
     bool simultaneous_pair_alignment;
     int max_band_jump; // the maximum length edit we can detect via banded alignment
+    bool long_read_chaining; // align long reads with align_chained instead of per-band mapping
     float drop_chain; // drop chains shorter than this fraction of the longest overlapping chain
     float mq_overlap; // consider as alternative mappings any alignment with this overlap with our best
     int mate_rescues;
@@ -0,0 +1,191 @@
+#include "mem_overlay.hpp"
+#include "position.hpp"
+#include "utility.hpp"
+
+#include <cassert>
+#include <map>
+#include <set>
+#include <tuple>
+
+namespace vg {
+
+using namespace std;
+
+MEMOverlay::MEMOverlay(const xg::XG* base_xg, const gcsa::GCSA* gcsa, id_t max_id, size_t kmer_size) :
+    base_xg(base_xg), gcsa(gcsa), max_id(max_id), kmer_size(kmer_size) {
+    assert(kmer_size > 0 && kmer_size <= 32);
+}
+
+void MEMOverlay::update(const xg::XG* current_xg) {
+    this->current_xg = current_xg;
+
+    set<string> indexed(new_paths.begin(), new_paths.end());
+    for (size_t rank = 1; rank <= current_xg->max_path_rank(); rank++) {
+        string name = current_xg->path_name(rank);
+        if (indexed.count(name) || base_xg->path_rank(name) != 0) {
+            continue;
+        }
+
+        // spell out the new path
+        string sequence;
+        for (const Mapping& mapping : current_xg->path(name).mapping()) {
+            string node_sequence = current_xg->node_sequence(mapping.position().node_id());
+            sequence += mapping.position().is_reverse() ? reverse_complement(node_sequence) : node_sequence;
+        }
+        size_t path = new_paths.size();
+        new_paths.push_back(name);
+        new_length += sequence.size();
+
+        // remember where the k-mers the GCSA2 index can't find are
+        for (size_t i = 0; i + kmer_size <= sequence.size(); i++) {
+            uint64_t packed;
+            if (!pack(sequence.begin() + i, packed)) {
+                continue;
+            }
+            if (!gcsa::Range::empty(gcsa->find(sequence.substr(i, kmer_size)))) {
+                continue;
+            }
+            kmers[packed].push_back(PathHit{path, i});
+        }
+    }
+}
+
+size_t MEMOverlay::added_length(void) const {
+    return new_length;
+}
+
+bool MEMOverlay::pack(string::const_iterator begin, uint64_t& packed) const {
+    packed = 0;
+    for (auto iter = begin; iter != begin + kmer_size; ++iter) {
+        packed <<= 2;
+        switch (*iter) {
+            case 'A': case 'a': break;
+            case 'C': case 'c': packed |= 1; break;
+            case 'G': case 'g': packed |= 2; break;
+            case 'T': case 't': packed |= 3; break;
+            default: return false;
+        }
+    }
+    return true;
+}
+
+gcsa::node_type MEMOverlay::path_to_graph(const string& name, size_t offset, bool reverse) const {
+    Mapping mapping = current_xg->mapping_at_path_position(name, offset);
+    id_t id = mapping.position().node_id();
+    bool node_reverse = mapping.position().is_reverse();
+    size_t length = current_xg->node_length(id);
+    // how far into the node's visit the base is, and which base of the forward strand that is
+    size_t into_visit = offset - current_xg->node_start_at_path_position(name, offset);
+    size_t forward_base = node_reverse ? length - 1 - into_visit : into_visit;
+    bool is_rev = reverse != node_reverse;
+    return gcsa::Node::encode(id, is_rev ? length - 1 - forward_base : forward_base, is_rev);
+}
+
+bool MEMOverlay::translate(gcsa::node_type hit, gcsa::node_type& translated) const {
+    pos_t pos = make_pos_t(hit);
+    if (id(pos) < 1 || id(pos) > max_id) {
+        return false;
+    }
+    vector<size_t> ranks = base_xg->paths_of_node(id(pos));
+    if (ranks.empty()) {
+        return false;
+    }
+    // the node divides up the same way wherever it is, so any visit on any path will do
+    string name = base_xg->path_name(ranks.front());
+    size_t visit_start = base_xg->position_in_path(id(pos), ranks.front()).front();
+    bool node_reverse = base_xg->mapping_at_path_position(name, visit_start).position().is_reverse();
+    size_t length = base_xg->node_length(id(pos));
+    size_t forward_base = is_rev(pos) ? length - 1 - offset(pos) : offset(pos);
+    size_t into_visit = node_reverse ? length - 1 - forward_base : forward_base;
+    translated = path_to_graph(name, visit_start + into_visit, is_rev(pos) != node_reverse);
+    return true;
+}
+
+void MEMOverlay::adjust_mems(string::const_iterator seq_begin, string::const_iterator seq_end,
+                             vector<MaximalExactMatch>& mems, size_t hit_max) const {
+
+    // move the hits the GCSA2 index found over to the current graph
+    for (MaximalExactMatch& mem : mems) {
+        vector<gcsa::node_type> translated;
+        translated.reserve(mem.nodes.size());
+        for (gcsa::node_type hit : mem.nodes) {
+            gcsa::node_type moved;
+            if (translate(hit, moved)) {
+                translated.push_back(moved);
+            }
+        }
+        mem.match_count -= mem.nodes.size() - translated.size();
+        mem.nodes = move(translated);
+    }
+
+    if (kmers.empty() || seq_end - seq_begin < (ptrdiff_t) kmer_size) {
+        return;
+    }
+
+    // runs of k-mer hits along the same diagonal of a new path make exact matches
+    struct Run {
+        size_t first;
+        size_t last;
+        // path offset of the k-mer at the first sequence offset
+        size_t start_offset;
+    };
+    // keyed by path, orientation and diagonal
+    map<tuple<size_t, bool, int64_t>, Run> runs;
+    // the hits of each interval of the sequence that new sequence matches
+    map<pair<size_t, size_t>, set<gcsa::node_type>> matches;
+
+    auto finish_run = [&](const tuple<size_t, bool, int64_t>& key, const Run& run) {
+        bool reverse = get<1>(key);
+        // where on the path the first base of the match is, which is the
+        // last base of the first k-mer if we're reading against the path
+        size_t offset = reverse ? run.start_offset + kmer_size - 1 : run.start_offset;
+        matches[make_pair(run.first, run.last + kmer_size)].insert(path_to_graph(new_paths[get<0>(key)], offset, reverse));
+    };
+
+    size_t length = seq_end - seq_begin;
+    string rc_kmer;
+    for (size_t i = 0; i + kmer_size <= length; i++) {
+        uint64_t forward, backward;
+        if (!pack(seq_begin + i, forward)) {
+            continue;
+        }
+        rc_kmer = reverse_complement(string(seq_begin + i, seq_begin + i + kmer_size));
+        pack(rc_kmer.begin(), backward);
+
+        for (bool reverse : {false, true}) {
+            auto found = kmers.find(reverse ? backward : forward);
+            if (found == kmers.end()) {
+                continue;
+            }
+            for (const PathHit& hit : found->second) {
+                // reading against the path, the path offset falls as the sequence offset rises
+                int64_t diagonal = reverse ? (int64_t) hit.offset + (int64_t) i : (int64_t) hit.offset - (int64_t) i;
+                auto key = make_tuple(hit.path, reverse, diagonal);
+                auto run = runs.find(key);
+                if (run != runs.end() && run->second.last + 1 == i) {
+                    run->second.last = i;
+                } else {
+                    if (run != runs.end()) {
+                        finish_run(key, run->second);
+                    }
+                    runs[key] = Run{i, i, hit.offset};
+                }
+            }
+        }
+    }
+    for (auto& run : runs) {
+        finish_run(run.first, run.second);
+    }
+
+    for (auto& match : matches) {
+        MaximalExactMatch mem(seq_begin + match.first.first, seq_begin + match.first.second,
+                              gcsa::range_type(1, 0), match.second.size());
+        mem.primary = true;
+        if (!hit_max || mem.match_count <= hit_max) {
+            mem.nodes.assign(match.second.begin(), match.second.end());
+        }
+        mems.push_back(move(mem));
+    }
+}
+
+}
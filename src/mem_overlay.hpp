@@ -0,0 +1,96 @@
+#ifndef VG_MEM_OVERLAY_HPP_INCLUDED
+#define VG_MEM_OVERLAY_HPP_INCLUDED
+
+/** \file
+ * Lets a Mapper keep using a GCSA2 index after the graph it was built from
+ * has had sequences added to it, as vg msga does after every sequence.
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "gcsa/gcsa.h"
+#include "xg.hpp"
+#include "mem.hpp"
+#include "types.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * An overlay on a GCSA2 index built from an older version of a graph, for
+ * finding MEMs in the current version of the graph. The graph may only have
+ * changed by adding paths, nodes and edges, and by dividing and renumbering
+ * nodes, so that every path that was in the older graph still spells the same
+ * sequence.
+ *
+ * The MEMs the GCSA2 index finds are translated into the current graph through
+ * the paths they lie on. Sequence on paths added since the index was built
+ * that the index has never seen is kept in a k-mer table, and exact matches
+ * to it are added as extra MEMs.
+ */
+class MEMOverlay {
+public:
+
+    /// Make an overlay for the GCSA2 index of the graph in the given XG index,
+    /// which must have node IDs 1 to max_id. Hits on nodes with other IDs, such
+    /// as the head and tail nodes of pruned graphs, are dropped. Matches to new
+    /// sequence are found with k-mers of kmer_size, which can be at most 32.
+    MEMOverlay(const xg::XG* base_xg, const gcsa::GCSA* gcsa, id_t max_id, size_t kmer_size);
+
+    /// Switch to the XG index of the current graph, and add the k-mers of
+    /// paths that are new since the last update. The XG index must outlive the
+    /// overlay or the next update.
+    void update(const xg::XG* current_xg);
+
+    /// Total length of the paths added since the GCSA2 index was built
+    size_t added_length(void) const;
+
+    /// Translate the hits of MEMs found in the sequence with the GCSA2 index
+    /// into the current graph, and add MEMs for matches to new sequence. MEMs
+    /// with more than hit_max hits (if nonzero) keep their count but lose their
+    /// hits, as in BaseMapper::find_mems_deep(). Safe to call from many threads
+    /// at once.
+    void adjust_mems(string::const_iterator seq_begin, string::const_iterator seq_end,
+                     vector<MaximalExactMatch>& mems, size_t hit_max) const;
+
+private:
+
+    /// A place on a new path: the path's index in new_paths and a base offset
+    /// along it
+    struct PathHit {
+        size_t path;
+        size_t offset;
+    };
+
+    const xg::XG* base_xg;
+    const xg::XG* current_xg = nullptr;
+    const gcsa::GCSA* gcsa;
+    id_t max_id;
+    size_t kmer_size;
+
+    /// Paths that were not in the base graph, by name
+    vector<string> new_paths;
+    size_t new_length = 0;
+
+    /// Where each k-mer that is not in the GCSA2 index occurs on the new paths,
+    /// read forward along them
+    unordered_map<uint64_t, vector<PathHit>> kmers;
+
+    /// Pack a k-mer with two bits per base, or return false if it has an N
+    bool pack(string::const_iterator begin, uint64_t& packed) const;
+
+    /// Find the current graph position of the given base of the named path,
+    /// reading along the path or against it
+    gcsa::node_type path_to_graph(const string& name, size_t offset, bool reverse) const;
+
+    /// Translate a GCSA2 hit in the base graph into the current graph, or
+    /// return false if it isn't on a path
+    bool translate(gcsa::node_type hit, gcsa::node_type& translated) const;
+};
+
+}
+
+#endif
@@ -8,6 +8,7 @@
 //#define debug_validate_multipath_alignments
 
 #include "multipath_mapper.hpp"
+#include "stage_profiler.hpp"
 
 namespace vg {
     
@@ -36,6 +37,8 @@ namespace vg {
         double dummy;
         vector<MaximalExactMatch> mems = find_mems_deep(alignment.sequence().begin(), alignment.sequence().end(),
                                                         dummy, 0, min_mem_length, mem_reseed_length);
+        PROFILE_COUNT(READS, 1);
+        PROFILE_COUNT(MEMS_FOUND, mems.size());
         
 #ifdef debug_multipath_mapper
         cerr << "obtained MEMs:" << endl;
@@ -49,14 +52,18 @@ namespace vg {
         
         // cluster the MEMs
         vector<vector<pair<const MaximalExactMatch*, pos_t>>> clusters;
-        if (adjust_alignments_for_base_quality) {
-            OrientedDistanceClusterer clusterer(alignment, mems, *qual_adj_aligner, xindex, max_expected_dist_approx_error);
-            clusters = clusterer.clusters(max_mapping_quality);
-        }
-        else {
-            OrientedDistanceClusterer clusterer(alignment, mems, *regular_aligner, xindex, max_expected_dist_approx_error);
-            clusters = clusterer.clusters(max_mapping_quality);
+        {
+            PROFILE_STAGE(CLUSTER);
+            if (adjust_alignments_for_base_quality) {
+                OrientedDistanceClusterer clusterer(alignment, mems, *qual_adj_aligner, xindex, max_expected_dist_approx_error);
+                clusters = clusterer.clusters(max_mapping_quality);
+            }
+            else {
+                OrientedDistanceClusterer clusterer(alignment, mems, *regular_aligner, xindex, max_expected_dist_approx_error);
+                clusters = clusterer.clusters(max_mapping_quality);
+            }
         }
+        PROFILE_COUNT(CLUSTERS_FOUND, clusters.size());
         
 #ifdef debug_multipath_mapper
         cerr << "obtained clusters:" << endl;
@@ -179,6 +186,8 @@ namespace vg {
                                                          dummy, 0, min_mem_length, mem_reseed_length);
         vector<MaximalExactMatch> mems2 = find_mems_deep(alignment2.sequence().begin(), alignment2.sequence().end(),
                                                          dummy, 0, min_mem_length, mem_reseed_length);
+        PROFILE_COUNT(READS, 2);
+        PROFILE_COUNT(MEMS_FOUND, mems1.size() + mems2.size());
         
 #ifdef debug_multipath_mapper
         cerr << "obtained read1 MEMs:" << endl;
@@ -196,18 +205,22 @@ namespace vg {
         
         vector<vector<pair<const MaximalExactMatch*, pos_t>>> clusters1;
         vector<vector<pair<const MaximalExactMatch*, pos_t>>> clusters2;
-        if (adjust_alignments_for_base_quality) {
-            OrientedDistanceClusterer clusterer1(alignment1, mems1, *qual_adj_aligner, xindex, max_expected_dist_approx_error);
-            OrientedDistanceClusterer clusterer2(alignment2, mems2, *qual_adj_aligner, xindex, max_expected_dist_approx_error);
-            clusters1 = clusterer1.clusters(max_mapping_quality);
-            clusters2 = clusterer2.clusters(max_mapping_quality);
-        }
-        else {
-            OrientedDistanceClusterer clusterer1(alignment1, mems1, *regular_aligner, xindex, max_expected_dist_approx_error);
-            OrientedDistanceClusterer clusterer2(alignment2, mems2, *regular_aligner, xindex, max_expected_dist_approx_error);
-            clusters1 = clusterer1.clusters(max_mapping_quality);
-            clusters2 = clusterer2.clusters(max_mapping_quality);
+        {
+            PROFILE_STAGE(CLUSTER);
+            if (adjust_alignments_for_base_quality) {
+                OrientedDistanceClusterer clusterer1(alignment1, mems1, *qual_adj_aligner, xindex, max_expected_dist_approx_error);
+                OrientedDistanceClusterer clusterer2(alignment2, mems2, *qual_adj_aligner, xindex, max_expected_dist_approx_error);
+                clusters1 = clusterer1.clusters(max_mapping_quality);
+                clusters2 = clusterer2.clusters(max_mapping_quality);
+            }
+            else {
+                OrientedDistanceClusterer clusterer1(alignment1, mems1, *regular_aligner, xindex, max_expected_dist_approx_error);
+                OrientedDistanceClusterer clusterer2(alignment2, mems2, *regular_aligner, xindex, max_expected_dist_approx_error);
+                clusters1 = clusterer1.clusters(max_mapping_quality);
+                clusters2 = clusterer2.clusters(max_mapping_quality);
+            }
         }
+        PROFILE_COUNT(CLUSTERS_FOUND, clusters1.size() + clusters2.size());
         
         // extract graphs around the clusters and get the assignments of MEMs to these graphs
         vector<tuple<VG*, vector<pair<const MaximalExactMatch*, pos_t>>, size_t>> cluster_graphs1;
@@ -320,14 +333,11 @@ namespace vg {
                                                const vector<vector<pair<const MaximalExactMatch*, pos_t>>>& clusters,
                                                vector<tuple<VG*, vector<pair<const MaximalExactMatch*, pos_t>>, size_t>>& cluster_graphs_out) {
         
-        // we will ensure that nodes are in only one cluster, use this to record which one
-        unordered_map<id_t, size_t> node_id_to_cluster;
-        
-        // to hold the clusters as they are (possibly) merged
-        unordered_map<size_t, VG*> cluster_graphs;
+        PROFILE_STAGE(SUBGRAPH);
         
-        // to keep track of which clusters have been merged
-        UnionFind union_find(clusters.size());
+        // extract the subgraph around each cluster as a bare Graph first, so that we only pay for
+        // building a VG (and its indexes) once for each graph we actually return
+        vector<Graph> extracted_graphs(clusters.size());
         
         for (size_t i = 0; i < clusters.size(); i++) {
             
@@ -370,185 +380,78 @@ namespace vg {
             }
             
             
-            // TODO: a progressive expansion of the subgraph if the MEM hit is already contained in
-            // a cluster graph somewhere?
-            
             // extract the subgraph within the search distance
-            
-            VG* cluster_graph = new VG();
-            Graph& graph = cluster_graph->graph;
-            
-            // extract the protobuf Graph in place in the VG
-            algorithms::extract_containing_graph(*xindex, graph, positions, forward_max_dist,
+            algorithms::extract_containing_graph(*xindex, extracted_graphs[i], positions, forward_max_dist,
                                                  backward_max_dist, &get_node_cache());
-            
-            // check if this subgraph overlaps with any previous subgraph (indicates a probable clustering failure where
-            // one cluster was split into multiple clusters)
-            size_t next_cluster_idx = cluster_graphs_out.size();
-            unordered_set<size_t> overlapping_graphs;
+        }
+        
+        // clusters whose subgraphs overlap probably come from one hit that the clusterer split up, and
+        // a cluster's subgraph can also have several connected components (another clustering failure),
+        // so the graphs we want are exactly the weakly connected components of the union of the subgraphs
+        unordered_map<id_t, size_t> node_idx;
+        vector<const Node*> nodes;
+        for (const Graph& graph : extracted_graphs) {
             for (size_t j = 0; j < graph.node_size(); j++) {
-                id_t node_id = graph.node(j).id();
-                if (node_id_to_cluster.count(node_id)) {
-                    overlapping_graphs.insert(node_id_to_cluster[node_id]);
+                if (node_idx.insert(make_pair(graph.node(j).id(), nodes.size())).second) {
+                    nodes.push_back(&graph.node(j));
                 }
-                else {
-                    node_id_to_cluster[node_id] = next_cluster_idx;
-                }
-            }
-            
-            if (overlapping_graphs.empty()) {
-                // there is no overlap with any other graph, suggesting a new unique hit
-                
-#ifdef debug_multipath_mapper
-                cerr << "cluster graph does not overlap with any other cluster graphs, adding as cluster " << cluster_graphs_out.size() << endl;
-#endif
-                cluster_graphs[i] = cluster_graph;
-                
-                // now that we know we're going to save the graph, manually trigger the index building since
-                // we circumvented the constructors
-                cluster_graph->rebuild_indexes();
             }
-            else {
-                // this graph overlaps at least one other graph, so we merge them into one
-                
-#ifdef debug_multipath_mapper
-                cerr << "cluster graph overlaps with the following graphs:" << endl;
-                for (auto idx : overlapping_graphs) {
-                    cerr << "\t" << idx << endl;
-                }
-#endif
-                
-                // merge the groups and decide one graph to stay in the record
-                for (size_t j : overlapping_graphs) {
-                    union_find.union_groups(i, j);
-                }
-                size_t remaining_idx = union_find.find_group(i);
-                
-                VG* merging_graph;
-                if (remaining_idx == i) {
-                    // the new graph was chosen to remain, so add it to the record
-                    cluster_graphs[i] = cluster_graph;
-                    merging_graph = cluster_graph;
-                }
-                else {
-                    // the new graph will be merged into an existing graph
-                    merging_graph = cluster_graphs[remaining_idx];
-                    merging_graph->extend(graph);
-                    delete cluster_graph;
-                }
-                
-                // merge any other chained graphs into the remaining graph
-                for (size_t j : overlapping_graphs) {
-                    if (j != remaining_idx) {
-                        VG* removing_graph = cluster_graphs[j];
-                        merging_graph->extend(removing_graph->graph);
-                        delete removing_graph;
-                        cluster_graphs.erase(j);
-                    }
-                }
-                
-                Graph& merged_graph = merging_graph->graph;
-                for (size_t j = 0; j < merged_graph.node_size(); j++) {
-                    node_id_to_cluster[merged_graph.node(j).id()] = remaining_idx;
+        }
+        
+        UnionFind components(nodes.size());
+        for (const Graph& graph : extracted_graphs) {
+            for (size_t j = 0; j < graph.edge_size(); j++) {
+                const Edge& edge = graph.edge(j);
+                auto from_iter = node_idx.find(edge.from());
+                auto to_iter = node_idx.find(edge.to());
+                if (from_iter != node_idx.end() && to_iter != node_idx.end()) {
+                    components.union_groups(from_iter->second, to_iter->second);
                 }
             }
         }
         
-        // check if any cluster graphs pulled disconnected components (as a result of a clustering failure)
-        // and if so split them up
-        
-        // keeps track of the connected components of any multicomponent graph
-        vector<pair<size_t, vector<unordered_set<id_t>>>> multicomponent_graphs;
-        unordered_map<size_t, vector<size_t>> multicomponent_splits;
-        
-        size_t max_graph_idx = 0;
-        for (const pair<size_t, VG*> cluster_graph : cluster_graphs) {
-            vector<unordered_set<id_t>> connected_components = cluster_graph.second->weakly_connected_components();
-            if (connected_components.size() > 1) {
-                multicomponent_graphs.emplace_back(cluster_graph.first, std::move(connected_components));
+        // make one graph per component, in order of first appearance, and record which graph each
+        // node ended up in
+        unordered_map<size_t, size_t> component_to_idx;
+        unordered_map<id_t, size_t> node_id_to_cluster;
+        node_id_to_cluster.reserve(nodes.size());
+        for (size_t j = 0; j < nodes.size(); j++) {
+            size_t component = components.find_group(j);
+            auto iter = component_to_idx.find(component);
+            if (iter == component_to_idx.end()) {
+                iter = component_to_idx.insert(make_pair(component, cluster_graphs_out.size())).first;
+                cluster_graphs_out.emplace_back(new VG(), vector<pair<const MaximalExactMatch*, pos_t>>(), 0);
             }
-            max_graph_idx = max(cluster_graph.first, max_graph_idx);
+            get<0>(cluster_graphs_out[iter->second])->add_node(*nodes[j]);
+            node_id_to_cluster[nodes[j]->id()] = iter->second;
         }
         
-        // did we find any graphs that consist of disconnected components?
-        for (pair<size_t, vector<unordered_set<id_t>>>& multicomponent_graph : multicomponent_graphs) {
-            max_graph_idx++;
-            // make a new graph for each of the components
-#ifdef debug_multipath_mapper
-            cerr << "cluster graph " << multicomponent_graph.first << " has multiple connected components, splitting now" << endl;
-            for (size_t i = 0; i < multicomponent_graph.second.size(); i++) {
-                cerr << "component " << max_graph_idx + i << ":" << endl;
-                
-                for (auto node_id : multicomponent_graph.second[i]) {
-                    cerr << "\t" << node_id << endl;
+        // overlapping subgraphs repeat edges, which VG::add_edge skips
+        for (const Graph& graph : extracted_graphs) {
+            for (size_t j = 0; j < graph.edge_size(); j++) {
+                const Edge& edge = graph.edge(j);
+                auto iter = node_id_to_cluster.find(edge.from());
+                if (iter != node_id_to_cluster.end() && node_id_to_cluster.count(edge.to())) {
+                    get<0>(cluster_graphs_out[iter->second])->add_edge(edge);
                 }
             }
-#endif
-            
-            for (size_t i = 0; i < multicomponent_graph.second.size(); i++) {
-                cluster_graphs[max_graph_idx + i] = new VG();
-            }
-            
-            Graph& joined_graph = cluster_graphs[multicomponent_graph.first]->graph;
-            
-            // divvy up the nodes
-            for (size_t i = 0; i < joined_graph.node_size(); i++) {
-                const Node& node = joined_graph.node(i);
-                for (size_t j = 0; j < multicomponent_graph.second.size(); j++) {
-                    if (multicomponent_graph.second[j].count(node.id())) {
-                        cluster_graphs[max_graph_idx + j]->add_node(node);
-                        node_id_to_cluster[node.id()] = max_graph_idx + j;
-                        break;
-                    }
-                }
-            }
-            
-            // divvy up the edges
-            for (size_t i = 0; i < joined_graph.edge_size(); i++) {
-                const Edge& edge = joined_graph.edge(i);
-                for (size_t j = 0; j < multicomponent_graph.second.size(); j++) {
-                    if (multicomponent_graph.second[j].count(edge.from())) {
-                        cluster_graphs[max_graph_idx + j]->add_edge(edge);
-                        break;
-                    }
-                }
-            }
-            
-#ifdef debug_multipath_mapper
-            cerr << "split graphs:" << endl;
-            for (size_t i = 0; i < multicomponent_graph.second.size(); i++) {
-                cerr << "component " << max_graph_idx + i << ":" << endl;
-                cerr << pb2json(cluster_graphs[max_graph_idx + i]->graph) << endl;
-            }
-#endif
-            
-            // remove the old graph
-            delete cluster_graphs[multicomponent_graph.first];
-            cluster_graphs.erase(multicomponent_graph.first);
-            
-            max_graph_idx += multicomponent_graph.second.size();
         }
         
-        // move the pointers to the return vector and figure out which graph in the return
-        // vector each MEM cluster ended up in
-        cluster_graphs_out.reserve(cluster_graphs.size());
-        unordered_map<size_t, size_t> cluster_to_idx;
-        for (const auto& cluster_graph : cluster_graphs) {
-            cluster_to_idx[cluster_graph.first] = cluster_graphs_out.size();
-            cluster_graphs_out.emplace_back(cluster_graph.second, vector<pair<const MaximalExactMatch*, pos_t>>(), 0);
-        }
-
-        
 #ifdef debug_multipath_mapper
+        cerr << "extracted " << cluster_graphs_out.size() << " cluster graphs from " << clusters.size() << " clusters" << endl;
+        for (size_t j = 0; j < cluster_graphs_out.size(); j++) {
+            cerr << "cluster graph " << j << ":" << endl;
+            cerr << pb2json(get<0>(cluster_graphs_out[j])->graph) << endl;
+        }
         cerr << "computing MEM assignments to cluster graphs" << endl;
 #endif
         // which MEMs are in play for which cluster?
         for (const MaximalExactMatch& mem : mems) {
             for (gcsa::node_type hit : mem.nodes) {
                 id_t node_id = gcsa::Node::id(hit);
-                if (node_id_to_cluster.count(node_id)) {
-                    size_t cluster_idx = cluster_to_idx[node_id_to_cluster[node_id]];
-                    get<1>(cluster_graphs_out[cluster_idx]).push_back(make_pair(&mem, make_pos_t(hit)));
+                auto iter = node_id_to_cluster.find(node_id);
+                if (iter != node_id_to_cluster.end()) {
+                    get<1>(cluster_graphs_out[iter->second]).push_back(make_pair(&mem, make_pos_t(hit)));
                 }
             }
         }
@@ -570,6 +473,8 @@ namespace vg {
                                           vector<pair<const MaximalExactMatch*, pos_t>>& graph_mems,
                                           MultipathAlignment& multipath_aln_out) const {
 
+        PROFILE_STAGE(ALIGN);
+
 #ifdef debug_multipath_mapper
         cerr << "constructing alignment graph" << endl;
 #endif
@@ -1326,6 +1231,8 @@ namespace vg {
             return;
         }
         
+        PROFILE_STAGE(MAPQ);
+        
         // query the scores of the optimal alignments
         vector<int32_t> scores(multipath_alns.size(), 0);
         for (size_t i = 0; i < multipath_alns.size(); i++) {
@@ -604,6 +604,160 @@ void PathIndex::replace_occurrence(iterator to_replace, const vector<Mapping>& r
     }
 }
 
+CompactPathIndex::CompactPathIndex(const xg::XG& index, const string& path_name, bool extract_sequence) {
+    // Make sure the path is present
+    assert(index.path_rank(path_name) != 0);
+    
+    size_t length = index.path_length(path_name);
+    sdsl::util::assign(starts, sdsl::bit_vector(length + 1, 0));
+    
+    // Gather the visits. We don't know how many there are up front, so
+    // collect them at full width and compress after.
+    vector<int64_t> visit_ids;
+    vector<bool> visit_reversed;
+    std::stringstream seq_stream;
+    size_t path_base = 0;
+    index.for_each_path_visit(path_name, [&](int64_t id, bool is_reverse) {
+        starts[path_base] = 1;
+        visit_ids.push_back(id);
+        visit_reversed.push_back(is_reverse);
+        if (extract_sequence) {
+            string node_sequence = index.node_sequence(id);
+            seq_stream << (is_reverse ? reverse_complement(node_sequence) : node_sequence);
+        }
+        path_base += index.node_length(id);
+    });
+    assert(path_base == length);
+    starts[length] = 1;
+    sdsl::util::init_support(starts_rank, &starts);
+    sdsl::util::init_support(starts_select, &starts);
+    
+    sdsl::util::assign(ids, sdsl::int_vector<>(visit_ids.size()));
+    sdsl::util::assign(reversed, sdsl::bit_vector(visit_ids.size(), 0));
+    for (size_t i = 0; i < visit_ids.size(); i++) {
+        ids[i] = visit_ids[i];
+        reversed[i] = visit_reversed[i];
+    }
+    sdsl::util::bit_compress(ids);
+    
+    // Order the occurrences by node, keeping path order within each node
+    vector<size_t> order(visit_ids.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return visit_ids[a] < visit_ids[b];
+    });
+    sdsl::util::assign(by_node, sdsl::int_vector<>(order.size()));
+    for (size_t i = 0; i < order.size(); i++) {
+        by_node[i] = order[i];
+    }
+    sdsl::util::bit_compress(by_node);
+    
+    path_sequence = seq_stream.str();
+}
+
+size_t CompactPathIndex::size() const {
+    return ids.size();
+}
+
+size_t CompactPathIndex::path_length() const {
+    return starts.size() - 1;
+}
+
+size_t CompactPathIndex::occurrence_at(size_t position) const {
+    if (position >= path_length()) {
+        return size();
+    }
+    // count the occurrences starting at or before the position
+    return starts_rank(position + 1) - 1;
+}
+
+size_t CompactPathIndex::occurrence_start(size_t occurrence) const {
+    assert(occurrence < size());
+    return starts_select(occurrence + 1);
+}
+
+size_t CompactPathIndex::occurrence_length(size_t occurrence) const {
+    assert(occurrence < size());
+    // the terminal bit gives the last occurrence an end too
+    return starts_select(occurrence + 2) - starts_select(occurrence + 1);
+}
+
+NodeSide CompactPathIndex::occurrence_side(size_t occurrence) const {
+    assert(occurrence < size());
+    return NodeSide(ids[occurrence], reversed[occurrence]);
+}
+
+NodeSide CompactPathIndex::at_position(size_t position) const {
+    assert(position < path_length());
+    return occurrence_side(occurrence_at(position));
+}
+
+pair<size_t, size_t> CompactPathIndex::node_range(id_t node_id) const {
+    auto compare = [&](size_t occurrence, id_t id) {
+        return (id_t) ids[occurrence] < id;
+    };
+    auto first = std::lower_bound(by_node.begin(), by_node.end(), node_id, compare);
+    auto last = first;
+    while (last != by_node.end() && (id_t) ids[*last] == node_id) {
+        ++last;
+    }
+    return make_pair(first - by_node.begin(), last - by_node.begin());
+}
+
+bool CompactPathIndex::path_contains_node(id_t node_id) const {
+    auto range = node_range(node_id);
+    return range.first != range.second;
+}
+
+vector<size_t> CompactPathIndex::node_positions(id_t node_id) const {
+    auto range = node_range(node_id);
+    vector<size_t> positions;
+    positions.reserve(range.second - range.first);
+    for (size_t i = range.first; i < range.second; i++) {
+        positions.push_back(occurrence_start(by_node[i]));
+    }
+    return positions;
+}
+
+size_t CompactPathIndex::first_position(id_t node_id) const {
+    auto range = node_range(node_id);
+    assert(range.first != range.second);
+    return occurrence_start(by_node[range.first]);
+}
+
+pair<size_t, size_t> CompactPathIndex::round_outward(size_t start, size_t past_end) const {
+    // Keep the range on the path, so anything past its end rounds to its end
+    start = min(start, path_length());
+    past_end = min(past_end, path_length());
+    
+    size_t start_rounded;
+    if (start == path_length()) {
+        // There's no node to round back to the start of
+        start_rounded = start;
+    } else {
+        start_rounded = occurrence_start(occurrence_at(start));
+    }
+    
+    size_t past_end_rounded;
+    if (past_end == 0) {
+        // Range must have been empty anyway, so keep it ending before the first
+        // node.
+        past_end_rounded = 0;
+    } else {
+        // Go out past the end of the node holding the last included base
+        size_t end_occurrence = occurrence_at(past_end - 1);
+        past_end_rounded = occurrence_start(end_occurrence) + occurrence_length(end_occurrence);
+    }
+    
+    return make_pair(start_rounded, past_end_rounded);
+}
+
+const string& CompactPathIndex::sequence() const {
+    return path_sequence;
+}
+
 }
 
 
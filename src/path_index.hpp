@@ -7,6 +7,8 @@
  * Stores all the mappings uncompressed in memory.
  *
  * Used for the reference path during VCF creation and interpretation.
+ *
+ * Also provides a compact, read-only index for paths in XG graphs.
  */
  
 #include <map>
@@ -140,6 +142,83 @@ protected:
     
 };
 
+/**
+ * Immutable index of one path in an XG graph, for random access along big
+ * reference paths without materializing them as Paths or ordered maps. Node
+ * occurrence starts are marked in a bit vector with rank and select support,
+ * so position-to-node queries are constant time; node IDs and orientations
+ * are kept bit-compressed, along with the occurrences sorted by node for
+ * node-to-position queries. All queries are const and safe to make from many
+ * threads at once, so one index can be shared across workers.
+ */
+class CompactPathIndex {
+public:
+    /// Index the named path, which must exist, in the given XG. The path's
+    /// sequence is only kept if extract_sequence is set.
+    CompactPathIndex(const xg::XG& index, const string& path_name, bool extract_sequence = false);
+    
+    // These contain rank and select supports and so cannot move or be copied
+    // without code to update them.
+    CompactPathIndex(const CompactPathIndex& other) = delete;
+    CompactPathIndex(CompactPathIndex&& other) = delete;
+    CompactPathIndex& operator=(const CompactPathIndex& other) = delete;
+    CompactPathIndex& operator=(CompactPathIndex&& other) = delete;
+    
+    /// Get the number of node occurrences along the path.
+    size_t size() const;
+    /// Get the length of the path in bases.
+    size_t path_length() const;
+    
+    /// Get the number of the node occurrence covering a position. Returns
+    /// size() for positions at or past the end of the path.
+    size_t occurrence_at(size_t position) const;
+    /// Get where a node occurrence starts along the path.
+    size_t occurrence_start(size_t occurrence) const;
+    /// Get the length of a node occurrence.
+    size_t occurrence_length(size_t occurrence) const;
+    /// Get the node and orientation of a node occurrence, as a NodeSide that
+    /// is a right side if the node is visited in reverse.
+    NodeSide occurrence_side(size_t occurrence) const;
+    
+    /// Find what node and orientation covers a position. The position must be
+    /// less than the path length.
+    NodeSide at_position(size_t position) const;
+    
+    /// Check whether a node is on the path.
+    bool path_contains_node(id_t node_id) const;
+    /// Get the start positions of all occurrences of a node along the path, in
+    /// path order. Empty if the node is not on the path.
+    vector<size_t> node_positions(id_t node_id) const;
+    /// Get the first position along the path where a node occurs. The node
+    /// must be on the path.
+    size_t first_position(id_t node_id) const;
+    
+    /// Given an end-exclusive range on the path, round outward to the nearest
+    /// node boundary positions.
+    pair<size_t, size_t> round_outward(size_t start, size_t past_end) const;
+    
+    /// Get the sequence of the path, if it was extracted.
+    const string& sequence() const;
+    
+protected:
+    /// Find the range in by_node of the occurrences of a node.
+    pair<size_t, size_t> node_range(id_t node_id) const;
+
+    /// One bit per base plus a terminal bit, set at the start of each node
+    /// occurrence and at the end of the path
+    sdsl::bit_vector starts;
+    sdsl::rank_support_v<1> starts_rank;
+    sdsl::bit_vector::select_1_type starts_select;
+    /// Node ID of each occurrence
+    sdsl::int_vector<> ids;
+    /// Whether each occurrence visits its node in reverse
+    sdsl::bit_vector reversed;
+    /// Occurrence numbers ordered by node ID, then along the path
+    sdsl::int_vector<> by_node;
+    /// The path's sequence, if extracted
+    string path_sequence;
+};
+
 }
  
 #endif
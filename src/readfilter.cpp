@@ -1,5 +1,6 @@
 #include "readfilter.hpp"
 #include "IntervalTree.h"
+#include "cached_position.hpp"
 
 #include <fstream>
 #include <sstream>
@@ -12,8 +13,8 @@ bool ReadFilter::trim_ambiguous_ends(xg::XG* index, Alignment& alignment, int k)
     assert(index != nullptr);
 
     // Define a way to get node length, for flipping alignments
-    function<int64_t(id_t)> get_node_length = [&index](id_t node) {
-        return index->node_length(node);
+    function<int64_t(id_t)> get_node_length = [&](id_t node) {
+        return node_length(index, node);
     };
 
     // Because we need to flip the alignment, make sure it is new-style and
@@ -124,7 +125,7 @@ bool ReadFilter::trim_ambiguous_end(xg::XG* index, Alignment& alignment, int k)
     for(size_t i = root_mapping; i < alignment.path().mapping_size(); i++) {
         // Collect the appropriately oriented from sequence from each mapping
         auto& mapping = alignment.path().mapping(i);
-        string sequence = index->node_sequence(mapping.position().node_id());
+        string sequence = node_sequence(index, mapping.position().node_id());
         if(mapping.position().is_reverse()) {
             // Have it in the right orientation
             sequence = reverse_complement(sequence);
@@ -174,7 +175,7 @@ bool ReadFilter::trim_ambiguous_end(xg::XG* index, Alignment& alignment, int k)
         ++dfs_visit_count;
       
         // Grab the node sequence and match more of the target sequence.
-        string node_sequence = index->node_sequence(node_id);
+        string node_sequence = this->node_sequence(index, node_id);
         if(is_reverse) {
             node_sequence = reverse_complement(node_sequence);
         }
@@ -321,7 +322,7 @@ bool ReadFilter::trim_ambiguous_end(xg::XG* index, Alignment& alignment, int k)
     // get that much sequence; we know it is either full length or at a mapping
     // boundary. We handle the root special because it's always full length and
     // we have to cut after its end.
-    size_t kept_sequence_accounted_for = index->node_length(alignment.path().mapping(root_mapping).position().node_id());
+    size_t kept_sequence_accounted_for = node_length(index, alignment.path().mapping(root_mapping).position().node_id());
     size_t first_mapping_to_drop;
     for(first_mapping_to_drop = root_mapping + 1;
         first_mapping_to_drop < alignment.path().mapping_size();
@@ -337,7 +338,7 @@ bool ReadFilter::trim_ambiguous_end(xg::XG* index, Alignment& alignment, int k)
             // We know it's not the root mapping, and it can't be the non-full-
             // length end mapping (because we would have kept the full length
             // target sequence and not had to cut). So assume full node is used.
-            kept_sequence_accounted_for += index->node_length(mapping.position().node_id());
+            kept_sequence_accounted_for += node_length(index, mapping.position().node_id());
         }
     }
     
@@ -445,6 +446,20 @@ bool ReadFilter::is_split(xg::XG* index, Alignment& alignment) {
     return false;
 }
 
+string ReadFilter::node_sequence(xg::XG* index, id_t node_id) {
+    if (node_cache.empty()) {
+        return index->node_sequence(node_id);
+    }
+    return xg_cached_node_sequence(node_id, index, *node_cache[omp_get_thread_num()]);
+}
+
+size_t ReadFilter::node_length(xg::XG* index, id_t node_id) {
+    if (node_cache.empty()) {
+        return index->node_length(node_id);
+    }
+    return xg_cached_node_length(node_id, index, *node_cache[omp_get_thread_num()]);
+}
+
 int ReadFilter::filter(istream* alignment_stream, xg::XG* xindex) {
 
     // name helper for output
@@ -559,13 +574,20 @@ int ReadFilter::filter(istream* alignment_stream, xg::XG* xindex) {
     for (int i = 0; i < buffer.size(); ++i) {
         buffer[i].resize(chunk_names.size());
     }
-    
-    static const int buffer_size = 1000; // we let this be off by 1
 
-    // remember if write or append
-    vector<bool> chunk_append(chunk_names.size(), append_regions);
+    // remember if write or append (not a vector<bool>, since threads holding
+    // different chunks' locks update it concurrently)
+    vector<char> chunk_append(chunk_names.size(), append_regions);
+
+    // each chunk's file gets its own lock, so that writing one chunk never
+    // holds up threads that are writing other chunks
+    vector<omp_lock_t> chunk_lock(chunk_names.size());
+    for (auto& lock : chunk_lock) {
+        omp_init_lock(&lock);
+    }
 
     // flush a buffer specified by cur_buffer to target in chunk_names, and clear it
+    // (caller must hold the chunk's lock)
     function<void(int, int)> flush_buffer = [&buffer, &chunk_names, &chunk_append](int tid, int cur_buffer) {
         ofstream outfile;
         auto& outbuf = chunk_names[cur_buffer] == "-" ? cout : outfile;
@@ -581,23 +603,35 @@ int ReadFilter::filter(istream* alignment_stream, xg::XG* xindex) {
     };
 
     // add alignment to all appropriate buffers, flushing as necessary
-    function<void(int, Alignment&, const vector<int>&)> update_buffers = [
-        &buffer, &region_map, &get_chunks, &flush_buffer](int tid, Alignment& aln,
-                                                          const vector<int>& aln_chunks) {
+    function<void(int, Alignment&, const vector<int>&)> update_buffers = [&](int tid, Alignment& aln,
+                                                                            const vector<int>& aln_chunks) {
         for (auto chunk : aln_chunks) {
             buffer[tid][chunk].push_back(aln);
             if (buffer[tid][chunk].size() >= buffer_size) {
-                // flush buffer (could get fancier and allow parallel writes to different
-                // files, but unlikely to be worth effort as we're mostly trying to
-                // speed up defray and not write IO)
-#pragma omp critical (ReadFilter_flush_buffer)
-                {
+                // flush if nobody else is writing this chunk; otherwise keep
+                // buffering, and only wait for the chunk once we've built up
+                // a huge buffer
+                bool locked = omp_test_lock(&chunk_lock[chunk]);
+                if (!locked && buffer[tid][chunk].size() >= 10 * buffer_size) {
+                    omp_set_lock(&chunk_lock[chunk]);
+                    locked = true;
+                }
+                if (locked) {
                     flush_buffer(tid, chunk);
+                    omp_unset_lock(&chunk_lock[chunk]);
                 }
             }
         }
     };
 
+    // cache node sequences for the XG-backed filters
+    if (xindex != nullptr && defray_length) {
+        node_cache.clear();
+        for (int i = 0; i < threads; ++i) {
+            node_cache.emplace_back(new LRUCache<id_t, Node>(node_cache_size));
+        }
+    }
+
     // keep counts of what's filtered to report (in verbose mode)
     vector<Counts> counts_vec(threads);
             
@@ -733,6 +767,10 @@ int ReadFilter::filter(istream* alignment_stream, xg::XG* xindex) {
             }
         }
     }
+    for (auto& lock : chunk_lock) {
+        omp_destroy_lock(&lock);
+    }
+    node_cache.clear();
 
     if (verbose) {
         Counts& counts = counts_vec[0];
@@ -5,9 +5,11 @@
 #include <cstdlib>
 #include <iostream>
 #include <string>
+#include <memory>
 #include "vg.hpp"
 #include "xg.hpp"
 #include "vg.pb.h"
+#include "lru_cache.h"
 
 /** \file
  * Provides a way to filter and transform reads, implementing the bulk of the
@@ -41,6 +43,10 @@ public:
     bool drop_split = false;
     // default to 1 thread (as opposed to all)
     int threads = 1;
+    // Number of XG nodes each thread keeps cached while filtering
+    int node_cache_size = 1000;
+    // Buffer this many alignments per thread per chunk before writing
+    int buffer_size = 1000;
 
     // Keep some basic counts for when verbose mode is enabled
     struct Counts {
@@ -129,6 +135,21 @@ private:
      */
     bool is_split(xg::XG* index, Alignment& alignment);
     
+    /// Per-thread caches of XG nodes, only populated during filter()
+    vector<unique_ptr<LRUCache<id_t, Node>>> node_cache;
+    
+    /**
+     * Get the sequence of a node, going through this thread's node cache if
+     * we are inside filter().
+     */
+    string node_sequence(xg::XG* index, id_t node_id);
+    
+    /**
+     * Get the length of a node, going through this thread's node cache if we
+     * are inside filter().
+     */
+    size_t node_length(xg::XG* index, id_t node_id);
+    
 };
 }
 
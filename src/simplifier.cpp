@@ -25,7 +25,7 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
     }
 
     // Make a list of leaf sites
-    list<const Snarl*> leaves;
+    vector<const Snarl*> leaves;
     
     if (show_progress) {
         cerr << "Iteration " << iteration << ": Scanning " << graph.node_count() << " nodes and "
@@ -54,37 +54,53 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
         cerr << "Found " << leaves.size() << " leaves" << endl;
     }
     
-    // Index all the graph paths
-    map<string, unique_ptr<PathIndex>> path_indexes;
+    // Index the graph paths that carry features, so we can tell the features
+    // where their paths get edited. Paths without features don't need to be
+    // retraced after every edit.
+    vector<string> featured_paths;
     graph.paths.for_each_name([&](const string& name) {
-        // For every path name, go index it and put it in this collection
-        path_indexes.insert(make_pair(name, move(unique_ptr<PathIndex>(new PathIndex(graph, name)))));
+        if (features.has_features(name)) {
+            featured_paths.push_back(name);
+        }
     });
+    vector<unique_ptr<PathIndex>> built_indexes(featured_paths.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < featured_paths.size(); i++) {
+        built_indexes[i] = unique_ptr<PathIndex>(new PathIndex(graph, featured_paths[i]));
+    }
+    map<string, unique_ptr<PathIndex>> path_indexes;
+    for (size_t i = 0; i < featured_paths.size(); i++) {
+        path_indexes.insert(make_pair(featured_paths[i], move(built_indexes[i])));
+    }
     
     // Now we have a list of all the leaf sites.
     create_progress("simplifying leaves", leaves.size());
     
     // We can't use the SnarlManager after we modify the graph, so we load the
     // contents of all the leaves we're going to modify first.
-    map<const Snarl*, pair<unordered_set<Node*>, unordered_set<Edge*>>> leaf_contents;
+    vector<pair<unordered_set<Node*>, unordered_set<Edge*>>> leaf_contents(leaves.size());
     
     // How big is each leaf in bp
-    map<const Snarl*, size_t> leaf_sizes;
+    vector<size_t> leaf_sizes(leaves.size(), 0);
     
     // We also need to pre-calculate the traversals for the snarls that are the
     // right size, since the traversal finder uses the snarl manager amd might
     // not work if we modify the graph.
-    map<const Snarl*, vector<SnarlTraversal>> leaf_traversals;
+    vector<vector<SnarlTraversal>> leaf_traversals(leaves.size());
     
-    for (const Snarl* leaf : leaves) {
+    // None of this modifies the graph, so the leaves can be looked at in
+    // parallel.
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < leaves.size(); i++) {
         // Look at all the leaves
+        const Snarl* leaf = leaves[i];
         
         // Get the contents of the bubble, excluding the boundary nodes
-        leaf_contents[leaf] = site_manager.deep_contents(leaf, graph, false);
+        leaf_contents[i] = site_manager.deep_contents(leaf, graph, false);
         
         // For each leaf, calculate its total size.
-        unordered_set<Node*>& nodes = leaf_contents[leaf].first;
-        size_t& total_size = leaf_sizes[leaf];
+        unordered_set<Node*>& nodes = leaf_contents[i].first;
+        size_t& total_size = leaf_sizes[i];
         for (Node* node : nodes) {
             // For each node include it in the size figure
             total_size += node->sequence().size();
@@ -103,19 +119,19 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
         
         // Identify the replacement traversal for the bubble if it's the right size.
         // We can't necessarily do this after we've modified the graph.
-        vector<SnarlTraversal>& traversals = leaf_traversals[leaf];
-        traversals = traversal_finder.find_traversals(*leaf);
+        leaf_traversals[i] = traversal_finder.find_traversals(*leaf);
     }
     
-    for (const Snarl* leaf : leaves) {
-        // Look at all the leaves
+    for (size_t leaf_number = 0; leaf_number < leaves.size(); leaf_number++) {
+        // Look at all the leaves, in order
+        const Snarl* leaf = leaves[leaf_number];
         
         // Get the contents of the bubble, excluding the boundary nodes
-        unordered_set<Node*>& nodes = leaf_contents[leaf].first;
-        unordered_set<Edge*>& edges = leaf_contents[leaf].second;
+        unordered_set<Node*>& nodes = leaf_contents[leaf_number].first;
+        unordered_set<Edge*>& edges = leaf_contents[leaf_number].second;
         
         // For each leaf, grab its total size.
-        size_t& total_size = leaf_sizes[leaf];
+        size_t& total_size = leaf_sizes[leaf_number];
         
         if (total_size == 0) {
             // This site is just the start and end nodes, so it doesn't make
@@ -138,7 +154,7 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
         // Otherwise we want to simplify this site away
         
         // Grab the replacement traversal for the bubble
-        vector<SnarlTraversal>& traversals = leaf_traversals[leaf];
+        vector<SnarlTraversal>& traversals = leaf_traversals[leaf_number];
         
         if (traversals.empty()) {
             // We couldn't find any paths through the site.
@@ -450,36 +466,40 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
                     existing_mappings.reverse();
                 }
                 
-                // Where does the variable region of the site start for this
-                // traversal of the path? If there are no existing mappings,
-                // it's the start mapping's position if we traverse the site
-                // backwards and the end mapping's position if we traverse
-                // the site forwards. If there are existing mappings, it's
-                // the first existing mapping's position in the path. TODO:
-                // This is super ugly. Can we view the site in path
-                // coordinates or something?
-                PathIndex& path_index = *path_indexes.at(path_name).get();
-                Mapping* mapping_after_first = existing_mappings.empty() ?
-                    (backward ? start_mapping : end_mapping) : existing_mappings.front();
-                assert(path_index.mapping_positions.count(mapping_after_first));
-                size_t variable_start = path_index.mapping_positions.at(mapping_after_first); 
-                
-                
-                
-                // Determine the total length of the old traversal of the site
-                size_t old_site_length = 0;
-                for (auto* mapping : existing_mappings) {
-                    // Add in the lengths of all the mappings that will get
-                    // removed.
-                    old_site_length += mapping_from_length(*mapping);
-                }
+                // Only paths with features need to know where the edit
+                // happens along them.
+                auto found_index = path_indexes.find(path_name);
+                
+                if (found_index != path_indexes.end()) {
+                    // Where does the variable region of the site start for this
+                    // traversal of the path? If there are no existing mappings,
+                    // it's the start mapping's position if we traverse the site
+                    // backwards and the end mapping's position if we traverse
+                    // the site forwards. If there are existing mappings, it's
+                    // the first existing mapping's position in the path. TODO:
+                    // This is super ugly. Can we view the site in path
+                    // coordinates or something?
+                    PathIndex& path_index = *found_index->second.get();
+                    Mapping* mapping_after_first = existing_mappings.empty() ?
+                        (backward ? start_mapping : end_mapping) : existing_mappings.front();
+                    assert(path_index.mapping_positions.count(mapping_after_first));
+                    size_t variable_start = path_index.mapping_positions.at(mapping_after_first); 
+                    
+                    // Determine the total length of the old traversal of the site
+                    size_t old_site_length = 0;
+                    for (auto* mapping : existing_mappings) {
+                        // Add in the lengths of all the mappings that will get
+                        // removed.
+                        old_site_length += mapping_from_length(*mapping);
+                    }
 #ifdef debug
-                cerr << "Replacing " << old_site_length << " bp at " << variable_start
-                    << " with " << new_site_length << " bp" << endl;
+                    cerr << "Replacing " << old_site_length << " bp at " << variable_start
+                        << " with " << new_site_length << " bp" << endl;
 #endif
 
-                // Actually update any BED features
-                features.on_path_edit(path_name, variable_start, old_site_length, new_site_length);
+                    // Actually update any BED features
+                    features.on_path_edit(path_name, variable_start, old_site_length, new_site_length);
+                }
                 
                 // Where will we insert the new site traversal into the path?
                 list<Mapping>::iterator insert_position;
@@ -550,7 +570,9 @@ pair<size_t, size_t> Simplifier::simplify_once(size_t iteration) {
                 
                 // Now we've corrected this site on this path. Update its index.
                 // TODO: right now this means retracing the entire path.
-                path_indexes[path_name].get()->update_mapping_positions(graph, path_name);
+                if (found_index != path_indexes.end()) {
+                    found_index->second.get()->update_mapping_positions(graph, path_name);
+                }
             }
             
             if (kill_path) {
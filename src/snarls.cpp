@@ -9,6 +9,8 @@
 #include "json2pb.h"
 
 namespace vg {
+    const uint32_t SnarlManager::NO_SNARL;
+    
     // TODO: this is duplicative with the other constructor, but protobuf won't let me make
     // a deserialization iterator to match its signature because its internal file streams
     // disallow copy constructors
@@ -21,20 +23,29 @@ namespace vg {
         build_indexes();
     }
     
-    const vector<const Snarl*>& SnarlManager::children_of(const Snarl* snarl) {
-        return children[key_form(snarl)];
+    SnarlManager::Children SnarlManager::children_of(const Snarl* snarl) {
+        uint32_t number = number_of(snarl);
+        if (number == NO_SNARL) {
+            return Children(nullptr, nullptr);
+        }
+        const Snarl* const* base = child_list.data();
+        return Children(base + child_offset[number], base + child_offset[number + 1]);
     }
     
     const Snarl* SnarlManager::parent_of(const Snarl* snarl) {
-        return parent[key_form(snarl)];
+        uint32_t number = number_of(snarl);
+        if (number == NO_SNARL || parent_number[number] == NO_SNARL) {
+            return nullptr;
+        }
+        return &snarls[parent_number[number]];
     }
     
     bool SnarlManager::is_leaf(const Snarl* snarl) {
-        return children[key_form(snarl)].size() == 0;
+        return children_of(snarl).empty();
     }
     
     bool SnarlManager::is_root(const Snarl* snarl) {
-        return parent[key_form(snarl)] == nullptr;
+        return parent_of(snarl) == nullptr;
     }
     
     const vector<const Snarl*>& SnarlManager::top_level_snarls() {
@@ -69,9 +80,6 @@ namespace vg {
         
         Snarl& to_flip = snarls[offset / sizeof(Snarl)];
         
-        // save the key used in the indices before editing the snarl
-        auto old_key = key_form(snarl);
-        
         // swap and reverse the start and end Visits
         int64_t start_id = to_flip.start().node_id();
         bool start_orientation = to_flip.start().backward();
@@ -82,23 +90,20 @@ namespace vg {
         to_flip.mutable_end()->set_node_id(start_id);
         to_flip.mutable_end()->set_backward(!start_orientation);
         
-        // update parent index
-        parent[key_form(snarl)] = parent[old_key];
-        parent.erase(old_key);
-        
-        // update children index
-        children[key_form(snarl)] = std::move(children[old_key]);
-        children.erase(old_key);
-        
-        // Update index index
-        index_of[key_form(snarl)] = std::move(index_of[old_key]);
-        index_of.erase(old_key);
-        
-        // note: snarl_into index is invariant to flipping
+        // note: the tree and snarl_into indexes are by position and node side, so they are
+        // invariant to flipping
     }
     
     const Snarl* SnarlManager::into_which_snarl(int64_t id, bool reverse) {
-        return snarl_into.count(make_pair(id, reverse)) ? snarl_into[make_pair(id, reverse)] : nullptr;
+        if (!snarl_into_dense.empty()) {
+            size_t slot = 2 * (id - dense_min_id) + reverse;
+            if (id < dense_min_id || slot >= snarl_into_dense.size() || snarl_into_dense[slot] == 0) {
+                return nullptr;
+            }
+            return &snarls[snarl_into_dense[slot] - 1];
+        }
+        auto found = snarl_into.find(make_pair(id, reverse));
+        return found == snarl_into.end() ? nullptr : found->second;
     }
     
     const Snarl* SnarlManager::into_which_snarl(const Visit& visit) {
@@ -136,228 +141,264 @@ namespace vg {
                          make_pair(snarl->end().node_id(), snarl->end().backward()));
     }
     
+    uint32_t SnarlManager::number_of(const Snarl* snarl) {
+        if (snarls.empty()) {
+            return NO_SNARL;
+        }
+        
+        // Pointers we own can be converted directly
+        if (snarl >= snarls.data() && snarl < snarls.data() + snarls.size()) {
+            return snarl - snarls.data();
+        }
+        
+        // Otherwise a snarl is identified by its boundaries, and both of
+        // them point into it
+        key_t key = key_form(snarl);
+        for (const Snarl* candidate : {into_which_snarl(snarl->start().node_id(), snarl->start().backward()),
+                                       into_which_snarl(snarl->end().node_id(), !snarl->end().backward())}) {
+            if (candidate != nullptr && key_form(candidate) == key) {
+                return candidate - snarls.data();
+            }
+        }
+        return NO_SNARL;
+    }
 
     void SnarlManager::build_indexes() {
         
-        for (size_t i = 0; i < snarls.size(); i++) {
-            Snarl& snarl = snarls[i];
+        if (snarls.size() >= NO_SNARL) {
+            throw runtime_error("error:[SnarlManager] too many snarls to index");
+        }
+        
+        roots.clear();
+        snarl_into.clear();
+        snarl_into_dense.clear();
+        
+        // Index the boundaries first, since we find parents by their boundaries
+        if (!snarls.empty()) {
+            int64_t min_id = numeric_limits<int64_t>::max();
+            int64_t max_id = numeric_limits<int64_t>::min();
+            for (const Snarl& snarl : snarls) {
+                min_id = min(min_id, min(snarl.start().node_id(), snarl.end().node_id()));
+                max_id = max(max_id, max(snarl.start().node_id(), snarl.end().node_id()));
+            }
             
-            // Remember where each snarl is
-            index_of[key_form(&snarl)] = i;
+            // Use a flat table unless the IDs are so spread out that it would be much bigger
+            // than a hash table of the boundaries
+            if ((uint64_t) (max_id - min_id) < 8 * 2 * snarls.size()) {
+                dense_min_id = min_id;
+                snarl_into_dense.resize(2 * (max_id - min_id + 1), 0);
+                for (size_t i = 0; i < snarls.size(); i++) {
+                    const Snarl& snarl = snarls[i];
+                    snarl_into_dense[2 * (snarl.start().node_id() - min_id) + snarl.start().backward()] = i + 1;
+                    snarl_into_dense[2 * (snarl.end().node_id() - min_id) + !snarl.end().backward()] = i + 1;
+                }
+            }
+            else {
+                for (const Snarl& snarl : snarls) {
+                    snarl_into[make_pair(snarl.start().node_id(), snarl.start().backward())] = &snarl;
+                    snarl_into[make_pair(snarl.end().node_id(), !snarl.end().backward())] = &snarl;
+                }
+            }
+        }
         
-            // is this a top-level snarl?
+        // Find everyone's parent
+        parent_number.assign(snarls.size(), NO_SNARL);
+        vector<uint32_t> child_count(snarls.size(), 0);
+        for (size_t i = 0; i < snarls.size(); i++) {
+            Snarl& snarl = snarls[i];
             if (snarl.has_parent()) {
-                // add this snarl to the parent-to-children index
-                if (!children.count(key_form(&(snarl.parent()))) ) {
-                    children.insert(make_pair(key_form(&snarl.parent()), vector<const Snarl*>(1, &snarl)));
-                }
-                else {
-                    children[key_form(&(snarl.parent()))].push_back(&snarl);
+                parent_number[i] = number_of(&snarl.parent());
+                if (parent_number[i] != NO_SNARL) {
+                    child_count[parent_number[i]]++;
                 }
             }
             else {
                 // record top level status
                 roots.push_back(&snarl);
-                parent[key_form(&snarl)] = nullptr;
             }
-            
-            // add the boundaries into the indices
-            snarl_into[make_pair(snarl.start().node_id(), snarl.start().backward())] = &snarl;
-            snarl_into[make_pair(snarl.end().node_id(), !snarl.end().backward())] = &snarl;
         }
         
-        for (Snarl& snarl : snarls) {
-            if (children.count(key_form(&snarl))) {
-                // mark this snarl as the parent in child-to-parent map
-                for (const Snarl* child : children[key_form(&snarl)]) {
-                    parent[key_form(child)] = &snarl;
-                }
-            }
-            else {
-                // ensure that all snarls are in the parent-to-children map
-                children.insert(make_pair(key_form(&snarl), vector<const Snarl*>()));
+        // Lay the children out contiguously, in the order they were given
+        child_offset.resize(snarls.size() + 1);
+        child_offset[0] = 0;
+        for (size_t i = 0; i < snarls.size(); i++) {
+            child_offset[i + 1] = child_offset[i] + child_count[i];
+        }
+        child_list.resize(child_offset.back());
+        for (size_t i = 0; i < snarls.size(); i++) {
+            if (parent_number[i] != NO_SNARL) {
+                uint32_t parent = parent_number[i];
+                child_list[child_offset[parent + 1] - child_count[parent]] = &snarls[i];
+                child_count[parent]--;
             }
         }
     }
     
-    pair<unordered_set<Node*>, unordered_set<Edge*> > SnarlManager::shallow_contents(const Snarl* snarl, VG& graph,
-                                                                                     bool include_boundary_nodes) {
+    size_t SnarlManager::serialize(ostream& out) const {
+        size_t written = 0;
+        auto write_value = [&](const void* value, size_t size) {
+            out.write((const char*) value, size);
+            written += size;
+        };
+        
+        const char magic[8] = {'v', 'g', 's', 'n', 'a', 'r', 'l', '1'};
+        write_value(magic, sizeof(magic));
+        uint64_t count = snarls.size();
+        write_value(&count, sizeof(count));
         
-        pair<unordered_set<Node*>, unordered_set<Edge*> > to_return;
-        
-        unordered_set<Node*> already_stacked;
-        
-        // initialize stack for DFS traversal of site
-        vector<Node*> stack;
-        
-        Node* start_node = graph.get_node(snarl->start().node_id());
-        Node* end_node = graph.get_node(snarl->end().node_id());
+        for (size_t i = 0; i < snarls.size(); i++) {
+            const Snarl& snarl = snarls[i];
+            int64_t ids[2] = {snarl.start().node_id(), snarl.end().node_id()};
+            write_value(ids, sizeof(ids));
+            uint8_t flags = (snarl.start().backward() ? 1 : 0) | (snarl.end().backward() ? 2 : 0)
+                | (snarl.start_self_reachable() ? 4 : 0) | (snarl.end_self_reachable() ? 8 : 0)
+                | (snarl.has_parent() ? 16 : 0);
+            write_value(&flags, sizeof(flags));
+            int32_t type = snarl.type();
+            write_value(&type, sizeof(type));
+            // Parents are stored by position when we have them, since that's all we need to
+            // rebuild the Snarl
+            uint32_t parent = parent_number[i];
+            write_value(&parent, sizeof(parent));
+            if (snarl.has_parent() && parent == NO_SNARL) {
+                int64_t parent_ids[2] = {snarl.parent().start().node_id(), snarl.parent().end().node_id()};
+                write_value(parent_ids, sizeof(parent_ids));
+                uint8_t parent_flags = (snarl.parent().start().backward() ? 1 : 0)
+                    | (snarl.parent().end().backward() ? 2 : 0);
+                write_value(&parent_flags, sizeof(parent_flags));
+            }
+            uint32_t name_length = snarl.name().size();
+            write_value(&name_length, sizeof(name_length));
+            write_value(snarl.name().data(), name_length);
+        }
         
-        // mark the boundary nodes as already stacked so that paths will terminate on them
-        already_stacked.insert(start_node);
-        already_stacked.insert(end_node);
+        return written;
+    }
+    
+    void SnarlManager::load(istream& in) {
+        auto read_value = [&](void* value, size_t size) {
+            in.read((char*) value, size);
+            if (!in) {
+                throw runtime_error("error:[SnarlManager] truncated snarl index");
+            }
+        };
         
-        // add boundary nodes as directed
-        if (include_boundary_nodes) {
-            to_return.first.insert(start_node);
-            to_return.first.insert(end_node);
+        char magic[8];
+        read_value(magic, sizeof(magic));
+        if (string(magic, sizeof(magic)) != "vgsnarl1") {
+            throw runtime_error("error:[SnarlManager] input is not a serialized snarl index");
         }
+        uint64_t count;
+        read_value(&count, sizeof(count));
         
-        vector<Edge*> edges_of_node;
+        snarls.clear();
+        snarls.resize(count);
         
-        // stack up the nodes one edge inside the snarl from the start
-        graph.edges_of_node(start_node, edges_of_node);
-        for (Edge* edge : edges_of_node) {
+        vector<uint32_t> parents(count);
+        for (size_t i = 0; i < count; i++) {
+            Snarl& snarl = snarls[i];
+            int64_t ids[2];
+            read_value(ids, sizeof(ids));
+            uint8_t flags;
+            read_value(&flags, sizeof(flags));
+            int32_t type;
+            read_value(&type, sizeof(type));
+            read_value(&parents[i], sizeof(uint32_t));
             
-            // does the edge point into the snarl?
-            if (edge->from() == snarl->start().node_id() && edge->from_start() == snarl->start().backward()) {
-
-                Node* node = graph.get_node(edge->to());
-                
-                if (!already_stacked.count(node)) {
-                    stack.push_back(node);
-                    already_stacked.insert(node);
-                }
-
-                to_return.second.insert(edge);
+            snarl.mutable_start()->set_node_id(ids[0]);
+            snarl.mutable_start()->set_backward(flags & 1);
+            snarl.mutable_end()->set_node_id(ids[1]);
+            snarl.mutable_end()->set_backward(flags & 2);
+            snarl.set_start_self_reachable(flags & 4);
+            snarl.set_end_self_reachable(flags & 8);
+            snarl.set_type((SnarlType) type);
+            
+            if ((flags & 16) && parents[i] == NO_SNARL) {
+                // The parent isn't one of ours, but we still need to remember it
+                int64_t parent_ids[2];
+                read_value(parent_ids, sizeof(parent_ids));
+                uint8_t parent_flags;
+                read_value(&parent_flags, sizeof(parent_flags));
+                snarl.mutable_parent()->mutable_start()->set_node_id(parent_ids[0]);
+                snarl.mutable_parent()->mutable_start()->set_backward(parent_flags & 1);
+                snarl.mutable_parent()->mutable_end()->set_node_id(parent_ids[1]);
+                snarl.mutable_parent()->mutable_end()->set_backward(parent_flags & 2);
             }
-            else if (edge->to() == snarl->start().node_id() && edge->to_end() != snarl->start().backward()) {
-
-                Node* node = graph.get_node(edge->from());
-                
-                if (!already_stacked.count(node)) {
-                    stack.push_back(node);
-                    already_stacked.insert(node);
-                }
-                
-                to_return.second.insert(edge);
+            
+            uint32_t name_length;
+            read_value(&name_length, sizeof(name_length));
+            if (name_length) {
+                string name(name_length, '\0');
+                read_value(&name[0], name_length);
+                snarl.set_name(name);
             }
         }
-        edges_of_node.clear();
         
-        // stack up the nodes one edge inside the snarl from the end
-        graph.edges_of_node(end_node, edges_of_node);
-        for (Edge* edge : edges_of_node) {
-            // does the edge point into the snarl?
-            if (edge->from() == snarl->end().node_id() && edge->from_start() != snarl->end().backward()) {
-                
-                Node* node = graph.get_node(edge->to());
-                
-                if (!already_stacked.count(node)) {
-                    stack.push_back(node);
-                    already_stacked.insert(node);
+        // Fill in parent boundaries from the parents themselves
+        for (size_t i = 0; i < count; i++) {
+            if (parents[i] != NO_SNARL) {
+                if (parents[i] >= count) {
+                    throw runtime_error("error:[SnarlManager] corrupt snarl index");
                 }
-                
-                to_return.second.insert(edge);
-            }
-            else if (edge->to() == snarl->end().node_id() && edge->to_end() == snarl->end().backward()) {
-                
-                Node* node = graph.get_node(edge->from());
-                
-                if (!already_stacked.count(node)) {
-                    stack.push_back(node);
-                    already_stacked.insert(node);
-                }
-                
-                to_return.second.insert(edge);
+                transfer_boundary_info(snarls[parents[i]], *snarls[i].mutable_parent());
             }
         }
-        edges_of_node.clear();
         
-        // traverse the snarl with DFS, skipping over any child snarls
-        // do not pay attention to valid walks since we also want to discover any tips
-        while (stack.size()) {
-            
-            // pop the top node off the stack
-            Node* node = stack.back();
-            stack.pop_back();
-            
-            // record that this node is in the snarl
-            to_return.first.insert(node);
-            
-            const Snarl* forward_snarl = into_which_snarl(node->id(), false);
-            const Snarl* backward_snarl = into_which_snarl(node->id(), true);
-            if (forward_snarl) {
-                // this node points into a snarl
-                
-                // What's on the other side of the snarl?
-                id_t other_id = forward_snarl->start().node_id() == node->id() ? forward_snarl->end().node_id() : forward_snarl->start().node_id();
-                
-                // stack up the node on the opposite side of the snarl
-                // rather than traversing it
-                Node* opposite_node = graph.get_node(other_id);
-                if (!already_stacked.count(opposite_node)) {
-                    stack.push_back(opposite_node);
-                    already_stacked.insert(opposite_node);
-                }
-            }
-            
-            if (backward_snarl) {
-                // the reverse of this node points into a snarl
-                
-                // What's on the other side of the snarl?
-                id_t other_id = backward_snarl->end().node_id() == node->id() ? backward_snarl->start().node_id(): backward_snarl->end().node_id();
-                
-                // stack up the node on the opposite side of the snarl
-                // rather than traversing it
-                Node* opposite_node = graph.get_node(other_id);
-                if (!already_stacked.count(opposite_node)) {
-                    stack.push_back(opposite_node);
-                    already_stacked.insert(opposite_node);
-                }
+        build_indexes();
+    }
+    
+    namespace {
+        /// Reusable per-thread working memory for snarl content traversals
+        struct ContentScratch {
+            unordered_set<Node*> already_stacked;
+            unordered_set<Edge*> reported_edges;
+            vector<Node*> stack;
+            vector<Edge*> edges_of_node;
+            bool in_use = false;
+        };
+        
+        /// Marks scratch space as taken for as long as it lives, so a lambda
+        /// that throws out of a traversal doesn't leave it marked
+        struct ScratchClaim {
+            ContentScratch& scratch;
+            ScratchClaim(ContentScratch& scratch) : scratch(scratch) {
+                scratch.in_use = true;
             }
-            
-            graph.edges_of_node(node, edges_of_node);
-            
-            for (Edge* edge : edges_of_node) {
-                // which end of the edge is the current node?
-                if (edge->from() == node->id()) {
-                    // does this edge point forward or backward?
-                    if ((edge->from_start() && !backward_snarl) ||
-                        (!edge->from_start() && !forward_snarl)) {
-                        
-                        to_return.second.insert(edge);
-                        Node* next_node = graph.get_node(edge->to());
-                        
-                        if (!already_stacked.count(next_node)) {
-                            
-                            stack.push_back(next_node);
-                            already_stacked.insert(next_node);
-                        }
-                    }
-                }
-                else {
-                    // does this edge point forward or backward?
-                    if ((edge->to_end() && !forward_snarl) ||
-                        (!edge->to_end() && !backward_snarl)) {
-                        
-                        to_return.second.insert(edge);
-                        Node* next_node = graph.get_node(edge->from());
-                        
-                        if (!already_stacked.count(next_node)) {
-                            
-                            stack.push_back(next_node);
-                            already_stacked.insert(next_node);
-                        }
-                    }
-                }
+            ~ScratchClaim() {
+                scratch.in_use = false;
             }
-            
-            edges_of_node.clear();
-        }
-        
-        return to_return;
+        };
     }
     
-    pair<unordered_set<Node*>, unordered_set<Edge*> > SnarlManager::deep_contents(const Snarl* snarl, VG& graph,
-                                                                                  bool include_boundary_nodes) {
-        
-        pair<unordered_set<Node*>, unordered_set<Edge*> > to_return;
-        
-        unordered_set<Node*> already_stacked;
+    void SnarlManager::for_each_content(const Snarl* snarl, VG& graph, bool include_boundary_nodes, bool deep,
+                                        const function<void(Node*)>& node_lambda,
+                                        const function<void(Edge*)>& edge_lambda) {
+        
+        // If a lambda starts another traversal on this thread, it gets its own scratch space
+        thread_local ContentScratch thread_scratch;
+        ContentScratch own_scratch;
+        ContentScratch& scratch = thread_scratch.in_use ? own_scratch : thread_scratch;
+        ScratchClaim claim(scratch);
+        // clear() keeps the hash tables' buckets around for next time
+        scratch.already_stacked.clear();
+        scratch.reported_edges.clear();
+        scratch.stack.clear();
+        
+        unordered_set<Node*>& already_stacked = scratch.already_stacked;
+        vector<Node*>& stack = scratch.stack;
+        vector<Edge*>& edges_of_node = scratch.edges_of_node;
+        
+        auto report_edge = [&](Edge* edge) {
+            if (scratch.reported_edges.insert(edge).second) {
+                edge_lambda(edge);
+            }
+        };
         
-        // initialize stack for DFS traversal of site
-        vector<Node*> stack;
+        auto stack_up = [&](Node* node) {
+            if (already_stacked.insert(node).second) {
+                stack.push_back(node);
+            }
+        };
         
         Node* start_node = graph.get_node(snarl->start().node_id());
         Node* end_node = graph.get_node(snarl->end().node_id());
@@ -368,37 +409,24 @@ namespace vg {
         
         // add boundary nodes as directed
         if (include_boundary_nodes) {
-            to_return.first.insert(start_node);
-            to_return.first.insert(end_node);
+            node_lambda(start_node);
+            if (end_node != start_node) {
+                node_lambda(end_node);
+            }
         }
         
-        vector<Edge*> edges_of_node;
-        
         // stack up the nodes one edge inside the snarl from the start
+        edges_of_node.clear();
         graph.edges_of_node(start_node, edges_of_node);
         for (Edge* edge : edges_of_node) {
             // does the edge point into the snarl?
             if (edge->from() == snarl->start().node_id() && edge->from_start() == snarl->start().backward()) {
-                
-                Node* node = graph.get_node(edge->to());
-                
-                if (!already_stacked.count(node)) {
-                    stack.push_back(node);
-                    already_stacked.insert(node);
-                }
-                
-                to_return.second.insert(edge);
+                stack_up(graph.get_node(edge->to()));
+                report_edge(edge);
             }
             else if (edge->to() == snarl->start().node_id() && edge->to_end() != snarl->start().backward()) {
-                
-                Node* node = graph.get_node(edge->from());
-                
-                if (!already_stacked.count(node)) {
-                    stack.push_back(node);
-                    already_stacked.insert(node);
-                }
-                
-                to_return.second.insert(edge);
+                stack_up(graph.get_node(edge->from()));
+                report_edge(edge);
             }
         }
         edges_of_node.clear();
@@ -408,31 +436,17 @@ namespace vg {
         for (Edge* edge : edges_of_node) {
             // does the edge point into the snarl?
             if (edge->from() == snarl->end().node_id() && edge->from_start() != snarl->end().backward()) {
-                
-                Node* node = graph.get_node(edge->to());
-                
-                if (!already_stacked.count(node)) {
-                    stack.push_back(node);
-                    already_stacked.insert(node);
-                }
-                
-                to_return.second.insert(edge);
+                stack_up(graph.get_node(edge->to()));
+                report_edge(edge);
             }
             else if (edge->to() == snarl->end().node_id() && edge->to_end() == snarl->end().backward()) {
-                
-                Node* node = graph.get_node(edge->from());
-                
-                if (!already_stacked.count(node)) {
-                    stack.push_back(node);
-                    already_stacked.insert(node);
-                }
-                
-                to_return.second.insert(edge);
+                stack_up(graph.get_node(edge->from()));
+                report_edge(edge);
             }
         }
         edges_of_node.clear();
         
-        // traverse the snarl with DFS, skipping over any child snarls
+        // traverse the snarl with DFS, skipping over any child snarls unless we're going deep
         // do not pay attention to valid walks since we also want to discover any tips
         while (stack.size()) {
             
@@ -441,46 +455,113 @@ namespace vg {
             stack.pop_back();
             
             // record that this node is in the snarl
-            to_return.first.insert(node);
+            node_lambda(node);
             
             graph.edges_of_node(node, edges_of_node);
             
-            for (Edge* edge : edges_of_node) {
-                to_return.second.insert(edge);
-                // get the other end of the edge
-                Node* next_node = edge->from() == node->id() ? graph.get_node(edge->to()) :
-                                                               graph.get_node(edge->from());
-                if (!already_stacked.count(next_node)) {
-                    stack.push_back(next_node);
-                    already_stacked.insert(next_node);
+            if (deep) {
+                for (Edge* edge : edges_of_node) {
+                    report_edge(edge);
+                    // get the other end of the edge
+                    stack_up(edge->from() == node->id() ? graph.get_node(edge->to()) :
+                                                          graph.get_node(edge->from()));
+                }
+            }
+            else {
+                const Snarl* forward_snarl = into_which_snarl(node->id(), false);
+                const Snarl* backward_snarl = into_which_snarl(node->id(), true);
+                if (forward_snarl) {
+                    // this node points into a snarl
+                    
+                    // stack up the node on the opposite side of the snarl
+                    // rather than traversing it
+                    id_t other_id = forward_snarl->start().node_id() == node->id() ? forward_snarl->end().node_id() : forward_snarl->start().node_id();
+                    stack_up(graph.get_node(other_id));
+                }
+                
+                if (backward_snarl) {
+                    // the reverse of this node points into a snarl
+                    
+                    // stack up the node on the opposite side of the snarl
+                    // rather than traversing it
+                    id_t other_id = backward_snarl->end().node_id() == node->id() ? backward_snarl->start().node_id(): backward_snarl->end().node_id();
+                    stack_up(graph.get_node(other_id));
+                }
+                
+                for (Edge* edge : edges_of_node) {
+                    // which end of the edge is the current node?
+                    if (edge->from() == node->id()) {
+                        // does this edge point forward or backward?
+                        if ((edge->from_start() && !backward_snarl) ||
+                            (!edge->from_start() && !forward_snarl)) {
+                            report_edge(edge);
+                            stack_up(graph.get_node(edge->to()));
+                        }
+                    }
+                    else {
+                        // does this edge point forward or backward?
+                        if ((edge->to_end() && !forward_snarl) ||
+                            (!edge->to_end() && !backward_snarl)) {
+                            report_edge(edge);
+                            stack_up(graph.get_node(edge->from()));
+                        }
+                    }
                 }
             }
             
             edges_of_node.clear();
         }
+    }
+    
+    void SnarlManager::for_each_shallow_content(const Snarl* snarl, VG& graph, bool include_boundary_nodes,
+                                                const function<void(Node*)>& node_lambda,
+                                                const function<void(Edge*)>& edge_lambda) {
+        for_each_content(snarl, graph, include_boundary_nodes, false, node_lambda, edge_lambda);
+    }
+    
+    void SnarlManager::for_each_deep_content(const Snarl* snarl, VG& graph, bool include_boundary_nodes,
+                                             const function<void(Node*)>& node_lambda,
+                                             const function<void(Edge*)>& edge_lambda) {
+        for_each_content(snarl, graph, include_boundary_nodes, true, node_lambda, edge_lambda);
+    }
+    
+    pair<unordered_set<Node*>, unordered_set<Edge*> > SnarlManager::shallow_contents(const Snarl* snarl, VG& graph,
+                                                                                     bool include_boundary_nodes) {
+        
+        pair<unordered_set<Node*>, unordered_set<Edge*> > to_return;
+        
+        for_each_shallow_content(snarl, graph, include_boundary_nodes,
+                                 [&](Node* node) { to_return.first.insert(node); },
+                                 [&](Edge* edge) { to_return.second.insert(edge); });
         
         return to_return;
     }
     
-    const Snarl* SnarlManager::manage(const Snarl& not_owned) {
-        // TODO: keep the Snarls in some kind of sorted order to make lookup
-        // efficient. We could also have a map<Snarl, Snarl*> but that would be
-        // a tremendous waste of space.
+    pair<unordered_set<Node*>, unordered_set<Edge*> > SnarlManager::deep_contents(const Snarl* snarl, VG& graph,
+                                                                                  bool include_boundary_nodes) {
+        
+        pair<unordered_set<Node*>, unordered_set<Edge*> > to_return;
         
-        // Work out the key for the snarl
-        key_t key = key_form(&not_owned);
+        for_each_deep_content(snarl, graph, include_boundary_nodes,
+                              [&](Node* node) { to_return.first.insert(node); },
+                              [&](Edge* edge) { to_return.second.insert(edge); });
+        
+        return to_return;
+    }
+    
+    const Snarl* SnarlManager::manage(const Snarl& not_owned) {
         
-        // Get the index of the snarl with that key.
-        auto it = index_of.find(key);
+        // Find the position of the snarl from its boundaries
+        uint32_t number = number_of(&not_owned);
         
-        if (it == index_of.end()) {
+        if (number == NO_SNARL) {
             // It's not there. Someone is trying to manage a snarl we don't
             // really own. Complain.
             throw runtime_error("Unable to find snarl " +  pb2json(not_owned) + " in SnarlManager");
         }
         
         // Return the official copy of that snarl
-        return &snarls.at(it->second);
+        return &snarls[number];
     }
     
     vector<Visit> SnarlManager::visits_right(const Visit& visit, VG& graph, const Snarl* in_snarl) {
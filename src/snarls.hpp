@@ -12,6 +12,8 @@
 #include <stdio.h>
 #include <unordered_map>
 #include <unordered_set>
+#include <limits>
+#include <functional>
 #include <fstream>
 #include "stream.hpp"
 #include "vg.hpp"
@@ -30,6 +32,28 @@ namespace vg {
     class SnarlManager {
     public:
         
+        /// A read-only view of the children of a Snarl. Children are stored
+        /// contiguously, so this is just a pair of pointers. Converts to a
+        /// vector if a modifiable copy is needed.
+        class Children {
+        public:
+            typedef const Snarl* const* const_iterator;
+            
+            Children(const_iterator begin, const_iterator end) : first(begin), last(end) {}
+            
+            const_iterator begin() const { return first; }
+            const_iterator end() const { return last; }
+            size_t size() const { return last - first; }
+            bool empty() const { return first == last; }
+            const Snarl* const& operator[](size_t i) const { return first[i]; }
+            
+            operator vector<const Snarl*>() const { return vector<const Snarl*>(first, last); }
+            
+        private:
+            const_iterator first;
+            const_iterator last;
+        };
+        
         /// Construct a SnarlManager for the snarls returned by an iterator
         template <typename SnarlIterator>
         SnarlManager(SnarlIterator begin, SnarlIterator end);
@@ -43,8 +67,8 @@ namespace vg {
         /// Destructor
         ~SnarlManager() = default;
         
-        /// Returns a vector of pointers to the children of a Snarl
-        const vector<const Snarl*>& children_of(const Snarl* snarl);
+        /// Returns the children of a Snarl
+        Children children_of(const Snarl* snarl);
         
         /// Returns a pointer to the parent of a Snarl or nullptr if there is none
         const Snarl* parent_of(const Snarl* snarl);
@@ -79,6 +103,20 @@ namespace vg {
         pair<unordered_set<Node*>, unordered_set<Edge*> > deep_contents(const Snarl* snarl, VG& graph,
                                                                         bool include_boundary_nodes);
         
+        /// Calls the given functions once on each Node and each Edge that
+        /// shallow_contents() would return, without building result sets.
+        /// Scratch space is reused between calls on the same thread.
+        void for_each_shallow_content(const Snarl* snarl, VG& graph, bool include_boundary_nodes,
+                                      const function<void(Node*)>& node_lambda,
+                                      const function<void(Edge*)>& edge_lambda);
+        
+        /// Calls the given functions once on each Node and each Edge that
+        /// deep_contents() would return, without building result sets.
+        /// Scratch space is reused between calls on the same thread.
+        void for_each_deep_content(const Snarl* snarl, VG& graph, bool include_boundary_nodes,
+                                   const function<void(Node*)>& node_lambda,
+                                   const function<void(Edge*)>& edge_lambda);
+        
         /// Look left from the given visit in the given graph and gets all the
         /// attached Visits to nodes or snarls.
         vector<Visit> visits_left(const Visit& visit, VG& graph, const Snarl* in_snarl);
@@ -108,32 +146,61 @@ namespace vg {
         /// pointer to the managed copy of that Snarl.
         const Snarl* manage(const Snarl& not_owned);
         
+        /// Write the snarls and their tree structure to a stream in a compact
+        /// binary format that can be loaded without parsing protobuf. Returns
+        /// the number of bytes written. No subcommand writes or reads this
+        /// format yet; vg snarls still emits protobuf.
+        size_t serialize(ostream& out) const;
+        
+        /// Replace the contents of this SnarlManager with snarls written by
+        /// serialize().
+        void load(istream& in);
+        
     private:
     
         /// Define the key type
         using key_t = pair<pair<int64_t, bool>, pair<int64_t, bool>>;
         
+        /// Sentinel snarl number meaning "no snarl"
+        static const uint32_t NO_SNARL = numeric_limits<uint32_t>::max();
+        
         /// Master list of the snarls in the graph
         vector<Snarl> snarls;
         
         /// Roots of snarl trees
         vector<const Snarl*> roots;
         
-        /// Map of snarls to the child snarls they contain
-        unordered_map<key_t, vector<const Snarl*>> children;
-        /// Map of snarls to their parent
-        unordered_map<key_t, const Snarl*> parent;
+        /// Number in the snarl array of each snarl's parent, or NO_SNARL
+        vector<uint32_t> parent_number;
+        
+        /// The children of snarl i are child_list[child_offset[i]] up to
+        /// child_list[child_offset[i + 1]]
+        vector<uint32_t> child_offset;
+        vector<const Snarl*> child_list;
         
-        /// Map of snarl keys to the indexes in the snarl array
-        // TODO: should we switch to just pointers here and save an indirection?
-        unordered_map<key_t, size_t> index_of;
+        /// Snarl number plus one pointed into by each node side, two entries
+        /// per node ID starting at dense_min_id; 0 means no snarl. Only used
+        /// when the boundary node IDs are dense enough.
+        vector<uint32_t> snarl_into_dense;
+        int64_t dense_min_id = 0;
         
-        /// Map of node traversals to the snarls they point into
+        /// Map of node traversals to the snarls they point into, used when the
+        /// boundary node IDs are too sparse for the dense table
         unordered_map<pair<int64_t, bool>, const Snarl*> snarl_into;
         
         /// Converts Snarl to the form used as keys in internal data structures
         inline key_t key_form(const Snarl* snarl);
         
+        /// Finds the position in the snarl array of a Snarl, which may or may
+        /// not be owned by this SnarlManager. Returns NO_SNARL if we don't
+        /// have it.
+        uint32_t number_of(const Snarl* snarl);
+        
+        /// Walks the contents of a Snarl, optionally descending into children
+        void for_each_content(const Snarl* snarl, VG& graph, bool include_boundary_nodes, bool deep,
+                              const function<void(Node*)>& node_lambda,
+                              const function<void(Edge*)>& edge_lambda);
+        
         /// Builds tree indexes after Snarls have been added
         void build_indexes();
     };
@@ -13,6 +13,8 @@
 #include "gcsa.h"
 #include "alignment.hpp"
 #include "genotypekit.hpp"
+#include "xg.hpp"
+#include "stream.hpp"
 using namespace std;
 namespace vg{
 
@@ -84,53 +86,150 @@ namespace vg{
           
 class DepthMap {
     /**
-    *  Map <node_id : offset : depth>
-    *  or
-    *  Map <SnarlTraversal : support count>
+    *  Per-base read depth for every node of a graph, kept in one flat array
+    *  of 16-bit counters that saturate instead of wrapping. Node sequences
+    *  are laid end to end (in XG sequence order, or in ID order for a VG),
+    *  so finding a base's counter is an offset lookup and an add.
+    *  Counters can be incremented from many threads at once.
     */
 public:
-  int8_t* depths;
-  uint64_t size;
-  map<int64_t, uint64_t> node_pos;
-  vg::VG* g_graph;
-  inline DepthMap(int64_t sz) { depths = new int8_t[sz]; };
   inline DepthMap() {};
   inline DepthMap(vg::VG* graph){
-    g_graph = graph;
-    int64_t tot_size = 0;
-    std::function<void(Node*)> count_size = [&](Node* n){
-        #pragma omp critical
-        {
-            node_pos[n->id()] = tot_size;
-            tot_size += n->sequence().length();
-        }
-    };
-    graph->for_each_node(count_size);
-    size = tot_size;
-    depths = new int8_t(size);
+    // Lay the nodes out in ID order, with a prefix sum over the whole ID
+    // range so missing IDs just have length 0
+    min_id = graph->min_node_id();
+    int64_t max_id = graph->max_node_id();
+    node_offsets.assign(max_id - min_id + 2, 0);
+    for (size_t i = 0; i < graph->graph.node_size(); i++) {
+        const Node& n = graph->graph.node(i);
+        node_offsets[n.id() - min_id + 1] = n.sequence().size();
+    }
+    for (size_t i = 1; i < node_offsets.size(); i++) {
+        node_offsets[i] += node_offsets[i - 1];
+    }
+    depths.assign(node_offsets.back(), 0);
+  };
+  inline DepthMap(const xg::XG* index){
+    // XG already has all the sequence laid out end to end
+    xindex = index;
+    depths.assign(index->seq_length, 0);
+  };
+  
+  /// Number of bases tracked
+  inline size_t size() const { return depths.size(); };
+  
+  /// Length of the given node
+  inline size_t node_length(int64_t node_id) const {
+    if (xindex != nullptr) {
+        return xindex->node_length(node_id);
+    }
+    if (node_id < min_id || node_id - min_id + 1 >= node_offsets.size()) {
+        return 0;
+    }
+    return node_offsets[node_id - min_id + 1] - node_offsets[node_id - min_id];
+  };
+  
+  /// Where the counter for a forward-strand offset in a node lives
+  inline size_t index_of(int64_t node_id, int64_t offset) const {
+    if (xindex != nullptr) {
+        return xindex->node_start(node_id) + offset;
+    }
+    assert(offset >= 0 && offset < node_length(node_id));
+    return node_offsets[node_id - min_id] + offset;
   };
-  inline int8_t get_depth(int64_t node_id, int64_t offset) { return depths[node_id + offset]; };
-  inline void set_depth(int64_t node_id, int64_t offset, int8_t d) { depths[node_id + offset] = d; };
+  
+  inline uint16_t get_depth(int64_t node_id, int64_t offset) const { return depths[index_of(node_id, offset)]; };
+  inline void set_depth(int64_t node_id, int64_t offset, uint16_t d) { depths[index_of(node_id, offset)] = d; };
+  
+  /// Add one to the depth at a base, stopping at the largest count we can hold. Thread safe.
   inline void increment_depth(int64_t node_id, int64_t offset) {
-    
-    depths[node_pos [node_id] + offset] += 1;
-};
+    uint16_t* counter = &depths[index_of(node_id, offset)];
+    uint16_t seen = *counter;
+    while (seen != numeric_limits<uint16_t>::max()) {
+        uint16_t was = __sync_val_compare_and_swap(counter, seen, (uint16_t) (seen + 1));
+        if (was == seen) {
+            break;
+        }
+        seen = was;
+    }
+  };
+  
+  /// Count every aligned (match or mismatch) base of a path. Thread safe.
   inline void fill_depth(const vg::Path& p){
     for (int i = 0; i < p.mapping_size(); i++){
-        Mapping m = p.mapping(i);
-        Position p = m.position();
-        int64_t nodeid = p.node_id();
-        int offset = p.offset();
+        const Mapping& m = p.mapping(i);
+        int64_t nodeid = m.position().node_id();
+        bool is_reverse = m.position().is_reverse();
+        int64_t length = node_length(nodeid);
+        int64_t offset = m.position().offset();
         for (int j = 0; j < m.edit_size(); j++){
-            Edit e = m.edit(j);
-            if (e.from_length() == e.to_length() && e.sequence().empty()){
+            const Edit& e = m.edit(j);
+            if (e.from_length() == e.to_length()){
                 for (int x = 0; x < e.from_length(); ++x){
-                    increment_depth(nodeid, offset + x);
+                    // Counters are on the forward strand
+                    increment_depth(nodeid, is_reverse ? length - 1 - (offset + x) : offset + x);
                 }
             }
+            offset += e.from_length();
+        }
+    }
+  };
+  
+  /// Count the aligned bases of every read in a GAM stream, in parallel
+  inline void fill_depth(istream& gam_stream){
+    function<void(Alignment&)> lambda = [&](Alignment& aln) {
+        fill_depth(aln.path());
+    };
+    stream::for_each_parallel(gam_stream, lambda);
+  };
+  
+  /// Mean depth over [start, end) of a node's forward strand
+  inline double mean_depth(int64_t node_id, int64_t start, int64_t end) const {
+    if (end <= start) {
+        return 0.0;
+    }
+    size_t first = index_of(node_id, start);
+    uint64_t total = 0;
+    for (size_t i = first; i < first + (end - start); i++) {
+        total += depths[i];
+    }
+    return (double) total / (end - start);
+  };
+  
+  /// Mean depth in consecutive windows of the given size along a path of
+  /// whole-node mappings (like a reference path), for scanning for depth
+  /// changes at breakpoints. The last window may be short.
+  inline vector<double> windowed_depth(const vg::Path& path, size_t window) const {
+    vector<double> means;
+    uint64_t total = 0;
+    size_t in_window = 0;
+    for (int i = 0; i < path.mapping_size(); i++) {
+        int64_t nodeid = path.mapping(i).position().node_id();
+        bool is_reverse = path.mapping(i).position().is_reverse();
+        size_t length = node_length(nodeid);
+        size_t first = length ? index_of(nodeid, 0) : 0;
+        for (size_t j = 0; j < length; j++) {
+            total += depths[first + (is_reverse ? length - 1 - j : j)];
+            if (++in_window == window) {
+                means.push_back((double) total / window);
+                total = 0;
+                in_window = 0;
+            }
         }
     }
+    if (in_window) {
+        means.push_back((double) total / in_window);
+    }
+    return means;
   };
+  
+private:
+  vector<uint16_t> depths;
+  // Start of each node's counters by ID - min_id, plus the total at the end (VG layout)
+  vector<uint64_t> node_offsets;
+  int64_t min_id = 0;
+  // XG to get the layout from instead, if set
+  const xg::XG* xindex = nullptr;
 
 };
 
@@ -0,0 +1,82 @@
+#include "stage_profiler.hpp"
+
+namespace vg {
+
+using namespace std;
+
+bool StageProfiler::enabled = false;
+vector<unique_ptr<StageProfiler::ThreadRecord>> StageProfiler::records;
+mutex StageProfiler::records_mutex;
+
+StageProfiler::ThreadRecord& StageProfiler::local() {
+    thread_local ThreadRecord* record = nullptr;
+    if (record == nullptr) {
+        lock_guard<mutex> lock(records_mutex);
+        records.emplace_back(new ThreadRecord());
+        record = records.back().get();
+    }
+    return *record;
+}
+
+void StageProfiler::record(Stage stage, uint64_t nanoseconds) {
+    ThreadRecord& here = local();
+    here.runs[stage]++;
+    here.nanoseconds[stage] += nanoseconds;
+    size_t bin = 0;
+    while (nanoseconds > 1 && bin + 1 < HISTOGRAM_BINS) {
+        nanoseconds >>= 1;
+        bin++;
+    }
+    here.histogram[stage][bin]++;
+}
+
+void StageProfiler::count(Event event, uint64_t n) {
+    local().events[event] += n;
+}
+
+void StageProfiler::write_json(ostream& out) {
+    static const char* stage_names[NUM_STAGES] = {"mems", "cluster", "subgraph", "align", "rescue", "mapq"};
+    static const char* event_names[NUM_EVENTS] = {"reads", "mems_found", "clusters_found",
+                                                  "rescues_attempted", "rescues_succeeded"};
+    
+    lock_guard<mutex> lock(records_mutex);
+    
+    ThreadRecord total;
+    for (auto& record : records) {
+        for (size_t i = 0; i < NUM_STAGES; i++) {
+            total.runs[i] += record->runs[i];
+            total.nanoseconds[i] += record->nanoseconds[i];
+            for (size_t j = 0; j < HISTOGRAM_BINS; j++) {
+                total.histogram[i][j] += record->histogram[i][j];
+            }
+        }
+        for (size_t i = 0; i < NUM_EVENTS; i++) {
+            total.events[i] += record->events[i];
+        }
+    }
+    
+    out << "{\"threads\": " << records.size() << ", \"stages\": {";
+    for (size_t i = 0; i < NUM_STAGES; i++) {
+        out << (i ? ", " : "") << "\"" << stage_names[i] << "\": {"
+            << "\"runs\": " << total.runs[i]
+            << ", \"seconds\": " << total.nanoseconds[i] / 1e9
+            << ", \"mean_us\": " << (total.runs[i] ? total.nanoseconds[i] / 1e3 / total.runs[i] : 0)
+            << ", \"log2_ns_histogram\": [";
+        // leave off the empty tail of the histogram
+        size_t used_bins = HISTOGRAM_BINS;
+        while (used_bins > 0 && total.histogram[i][used_bins - 1] == 0) {
+            used_bins--;
+        }
+        for (size_t j = 0; j < used_bins; j++) {
+            out << (j ? ", " : "") << total.histogram[i][j];
+        }
+        out << "]}";
+    }
+    out << "}, \"events\": {";
+    for (size_t i = 0; i < NUM_EVENTS; i++) {
+        out << (i ? ", " : "") << "\"" << event_names[i] << "\": " << total.events[i];
+    }
+    out << "}}" << endl;
+}
+
+}
@@ -0,0 +1,118 @@
+#ifndef VG_STAGE_PROFILER_HPP_INCLUDED
+#define VG_STAGE_PROFILER_HPP_INCLUDED
+
+/** \file
+ * Per-thread timings and event counts for the stages of read mapping, summed
+ * over all threads and dumped as JSON on request (vg map --profile).
+ *
+ * Nothing is recorded unless StageProfiler::enabled is set, so the cost when
+ * profiling is off is one branch per stage. Building with
+ * -DVG_NO_STAGE_PROFILE compiles the PROFILE_STAGE and PROFILE_COUNT macros
+ * out entirely.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Registry of per-thread stage timers and event counters. Each thread writes
+ * only its own record, so recording takes no locks.
+ */
+class StageProfiler {
+public:
+    /// The stages of mapping a read that get timed
+    enum Stage {
+        MEMS,
+        CLUSTER,
+        SUBGRAPH,
+        ALIGN,
+        RESCUE,
+        MAPQ,
+        NUM_STAGES
+    };
+    
+    /// The events during mapping that get counted
+    enum Event {
+        READS,
+        MEMS_FOUND,
+        CLUSTERS_FOUND,
+        RESCUES_ATTEMPTED,
+        RESCUES_SUCCEEDED,
+        NUM_EVENTS
+    };
+    
+    /// Stage run times are also binned by the floor of their log2 in
+    /// nanoseconds
+    static const size_t HISTOGRAM_BINS = 40;
+    
+    /// Set this before mapping starts to turn recording on
+    static bool enabled;
+    
+    /// Record one run of a stage on this thread
+    static void record(Stage stage, uint64_t nanoseconds);
+    
+    /// Count events on this thread
+    static void count(Event event, uint64_t n = 1);
+    
+    /// Sum the records of all threads and write them as a JSON object. Must
+    /// not be called while other threads are recording.
+    static void write_json(ostream& out);
+    
+    /// Times its own lifetime as one run of a stage
+    class Scope {
+    public:
+        Scope(Stage stage) : stage(stage) {
+            if (enabled) {
+                start = chrono::steady_clock::now();
+            }
+        }
+        ~Scope() {
+            if (enabled) {
+                record(stage, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+            }
+        }
+    private:
+        Stage stage;
+        chrono::steady_clock::time_point start;
+    };
+    
+private:
+    struct ThreadRecord {
+        uint64_t runs[NUM_STAGES] = {};
+        uint64_t nanoseconds[NUM_STAGES] = {};
+        uint64_t histogram[NUM_STAGES][HISTOGRAM_BINS] = {};
+        uint64_t events[NUM_EVENTS] = {};
+    };
+    
+    /// Get this thread's record, registering it on first use
+    static ThreadRecord& local();
+    
+    /// Every thread's record. Records live until exit, so they can be summed
+    /// after the threads that wrote them are gone.
+    static vector<unique_ptr<ThreadRecord>> records;
+    static mutex records_mutex;
+};
+
+}
+
+#ifdef VG_NO_STAGE_PROFILE
+#define PROFILE_STAGE(stage)
+#define PROFILE_COUNT(event, n)
+#else
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+/// Time the rest of the enclosing scope as a run of the given StageProfiler::Stage
+#define PROFILE_STAGE(stage) ::vg::StageProfiler::Scope PROFILE_CONCAT(stage_profile_scope_, __LINE__)(::vg::StageProfiler::stage)
+/// Count n of the given StageProfiler::Event
+#define PROFILE_COUNT(event, n) do { if (::vg::StageProfiler::enabled) ::vg::StageProfiler::count(::vg::StageProfiler::event, (n)); } while (0)
+#endif
+
+#endif
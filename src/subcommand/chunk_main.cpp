@@ -31,7 +31,9 @@ void help_chunk(char** argv) {
          << "options:" << endl
          << "    -x, --xg-name FILE       use this xg index to chunk subgraphs" << endl
          << "    -a, --gam-index FILE     chunk this gam index (made with vg index -N) instead of the graph" << endl
-         << "    -g, --gam-and-graph      when used in combination with -a, both gam and graph will be chunked" << endl 
+         << "    -A, --gam-file FILE      chunk this gam (- for stdin) by reading it once and routing each read to\n"
+         << "                             every chunk it touches, instead of querying a gam index" << endl
+         << "    -g, --gam-and-graph      when used in combination with -a or -A, both gam and graph will be chunked" << endl 
          << "path chunking:" << endl
          << "    -p, --path TARGET        write the chunk in the specified (0-based inclusive)\n"
          << "                             path range TARGET=path[:pos1[-pos2]]" << endl
@@ -64,6 +66,7 @@ int main_chunk(int argc, char** argv) {
 
     string xg_file;
     string gam_file;
+    string gam_stream_file;
     bool gam_and_graph = false;
     string region_string;
     string path_list_file;
@@ -88,6 +91,7 @@ int main_chunk(int argc, char** argv) {
             {"help", no_argument, 0, 'h'},
             {"xg-name", required_argument, 0, 'x'},
             {"gam-name", required_argument, 0, 'a'},
+            {"gam-file", required_argument, 0, 'A'},
             {"gam-and-graph", no_argument, 0, 'g'},
             {"path", required_argument, 0, 'p'},
             {"path-names", required_argument, 0, 'P'},
@@ -106,7 +110,7 @@ int main_chunk(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:a:gp:P:s:o:e:E:b:c:r:R:Tft:",
+        c = getopt_long (argc, argv, "hx:a:A:gp:P:s:o:e:E:b:c:r:R:Tft:",
                 long_options, &option_index);
 
 
@@ -124,6 +128,10 @@ int main_chunk(int argc, char** argv) {
         case 'a':
             gam_file = optarg;
             break;
+
+        case 'A':
+            gam_stream_file = optarg;
+            break;
             
         case 'g':
             gam_and_graph = true;
@@ -207,9 +215,13 @@ int main_chunk(int argc, char** argv) {
         cerr << "error:[vg chunk] at most one of {-p, -P, -e, -r, -R} required to specify input regions" << endl;
         return 1;
     }
-    // need -a if using -f
-    if (fully_contained && gam_file.empty()) {
-        cerr << "error:[vg chunk] gam file must be specified with -a when using -f" << endl;
+    // need -a or -A if using -f
+    if (fully_contained && gam_file.empty() && gam_stream_file.empty()) {
+        cerr << "error:[vg chunk] gam file must be specified with -a or -A when using -f" << endl;
+        return 1;
+    }
+    if (!gam_file.empty() && !gam_stream_file.empty()) {
+        cerr << "error:[vg chunk] at most one of -a and -A can be used" << endl;
         return 1;
     }
 
@@ -217,7 +229,8 @@ int main_chunk(int argc, char** argv) {
     // needs to be chunked, even if only gam output is requested,
     // because we use the graph to get the nodes we're looking for.
     // but we only write the subgraphs to disk if chunk_graph is true. 
-    bool chunk_gam = !gam_file.empty();
+    bool stream_gam = !gam_stream_file.empty();
+    bool chunk_gam = !gam_file.empty() || stream_gam;
     bool chunk_graph = gam_and_graph || !chunk_gam;
 
     // Load our index
@@ -232,7 +245,7 @@ int main_chunk(int argc, char** argv) {
 
     // This holds the RocksDB index that has all our reads, indexed by the nodes they visit.
     Index gam_index;
-    if (chunk_gam) {
+    if (chunk_gam && !stream_gam) {
         gam_index.open_read_only(gam_file);
     }
     
@@ -366,6 +379,10 @@ int main_chunk(int argc, char** argv) {
         chunker.xg = &xindex;
     }
 
+    // when streaming the gam, we remember which nodes each chunk has and
+    // route all the reads after the graph chunks are done
+    vector<vector<vg::id_t>> chunk_node_ids(stream_gam ? num_regions : 0);
+
     
     // extract chunks in parallel
 #pragma omp parallel for
@@ -435,7 +452,17 @@ int main_chunk(int argc, char** argv) {
         }
         
         // optional gam chunking
-        if (chunk_gam) {
+        if (stream_gam) {
+            if (subgraph != NULL) {
+                subgraph->for_each_node([&](Node* node) {
+                    chunk_node_ids[i].push_back(node->id());
+                });
+            } else {
+                for (vg::id_t id = region.start; id <= region.end; ++id) {
+                    chunk_node_ids[i].push_back(id);
+                }
+            }
+        } else if (chunk_gam) {
             string gam_name = chunk_name(i, output_regions[i], ".gam");
             ofstream out_gam_file(gam_name);
             if (!out_gam_file) {
@@ -466,6 +493,17 @@ int main_chunk(int argc, char** argv) {
 
         delete subgraph;
     }
+
+    // route every read to its chunks in one pass over the gam
+    if (stream_gam) {
+        vector<string> gam_names(num_regions);
+        for (int i = 0; i < num_regions; ++i) {
+            gam_names[i] = chunk_name(i, output_regions[i], ".gam");
+        }
+        get_input_file(gam_stream_file, [&](istream& gam_stream) {
+                chunkers[0].route_gam_to_chunks(gam_stream, chunk_node_ids, gam_names, fully_contained);
+            });
+    }
         
     // write a bed file if asked giving a more explicit linking of chunks to files
     if (!out_bed_file.empty()) {
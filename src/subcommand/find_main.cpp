@@ -545,16 +545,26 @@ int main_find(int argc, char** argv) {
             vgg.serialize_to_ostream(cout);
         }
         if(!haplotype_alignments.empty()) {
-            // What should we do with each alignment?
-            function<void(Alignment&)> lambda = [&xindex](Alignment& aln) {
-                // Count the amtches to the path. The path might be empty, in
+            // We query the paths in batches, so that the xg index can share
+            // work between paths with common prefixes and search in parallel.
+            const size_t batch_size = 100000;
+            vector<Path> batch;
+            auto flush_batch = [&xindex, &batch]() {
+                // Count the matches to the paths. A path might be empty, in
                 // which case it will yield the biggest size_t you can have.
-                size_t matches = xindex.count_matches(aln.path());
-
-                // We do this single-threaded, at least for now, so we don't
-                // need to worry about coordinating output, and we can just
-                // spit out the counts as bare numbers.
-                cout << matches << endl;
+                // The counts come back in input order, so we can just spit
+                // them out as bare numbers.
+                for (auto& matches : xindex.count_matches(batch)) {
+                    cout << matches << "\n";
+                }
+                batch.clear();
+            };
+            // What should we do with each alignment?
+            function<void(Alignment&)> lambda = [&batch, &flush_batch, &batch_size](Alignment& aln) {
+                batch.push_back(aln.path());
+                if (batch.size() >= batch_size) {
+                    flush_batch();
+                }
             };
             if (haplotype_alignments == "-") {
                 stream::for_each(std::cin, lambda);
@@ -567,6 +577,8 @@ int main_find(int argc, char** argv) {
                 }
                 stream::for_each(in, lambda);
             }
+            flush_batch();
+            cout << flush;
 
         }
         if (extract_threads) {
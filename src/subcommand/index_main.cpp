@@ -458,9 +458,9 @@ int main_index(int argc, char** argv) {
                 // How many bases is it?
                 size_t path_length = index.path_length(path_name);
                 
-                // We're going to extract it and index it, so we don't keep
-                // making queries against it for every sample.
-                PathIndex path_index(index.path(path_name));
+                // We're going to index it, so we don't keep making queries
+                // against it for every sample.
+                CompactPathIndex path_index(index, path_name);
 
                 // Allocate some threads to store phase threads
                 vector<xg::XG::thread_t> active_phase_threads{num_phases};
@@ -565,25 +565,25 @@ int main_index(int argc, char** argv) {
                     // the-end reference position.
                     size_t ref_pos = nonvariant_starts[phase_number];
                     
-                    // Get an iterator to the next node visit to add
-                    PathIndex::iterator next_to_add = path_index.find_position(ref_pos);
+                    // Get the number of the next node visit to add
+                    size_t next_to_add = path_index.occurrence_at(ref_pos);
                     
-                    while(ref_pos < end && next_to_add != path_index.end()) {
+                    while(ref_pos < end && next_to_add < path_index.size()) {
                         // While there is intervening reference
                         // sequence, add it to our phase.
 
                         // What node side is the node that covers here?
-                        NodeSide ref_side = next_to_add->second;
+                        NodeSide ref_side = path_index.occurrence_side(next_to_add);
 
                         // Stick it in the phase path
                         append_mapping(phase_number, node_side_to_thread_mapping(ref_side));
 
                         // Advance to what's after that mapping, pulling node
                         // length from the path index
-                        ref_pos += path_index.node_length(next_to_add);
+                        ref_pos += path_index.occurrence_length(next_to_add);
                         
-                        // Budge the iterator over so we don't need to do
-                        // another tree query.
+                        // Budge over to the next visit so we don't need to do
+                        // another query.
                         next_to_add++;
                     }
                     nonvariant_starts[phase_number] = ref_pos;
@@ -720,7 +720,7 @@ int main_index(int argc, char** argv) {
                                     auto first_ref_node = ref_path_iter->second.mapping(0).position().node_id();
                                     
                                     // Find the first place it starts in the ref path
-                                    first_ref_base = path_index.by_id.at(first_ref_node).first;
+                                    first_ref_base = path_index.first_position(first_ref_node);
                                 } else if (alt_path_iter != alt_paths.end() && alt_path_iter->second.mapping_size() != 0)  {
                                     // We have an alt path, so we can look at
                                     // the ref node before it and go one after
@@ -746,13 +746,13 @@ int main_index(int argc, char** argv) {
                                             continue;
                                         }
 
-                                        if (path_index.by_id.count(other_id) == 0) {
+                                        if (!path_index.path_contains_node(other_id)) {
                                             // Skip nodes that aren't in the reference path
                                             continue;
                                         }
 
                                         // Look up where the node starts in the reference
-                                        auto start = path_index.by_id.at(other_id).first;
+                                        auto start = path_index.first_position(other_id);
                                         // There plus the length of the node will be the first ref base in our site
                                         first_ref_base = max(first_ref_base, start + index.node_length(other_id));
                                         
@@ -14,6 +14,7 @@
 
 #include "../vg.hpp"
 #include "../vg_set.hpp"
+#include "../kmer_counter.hpp"
 
 using namespace std;
 using namespace vg;
@@ -35,11 +36,16 @@ void help_kmers(char** argv) {
         << "                          kmer, starting position, previous characters," << endl
         << "                          successive characters, successive positions." << endl
         << "                          Forward and reverse strand kmers are reported." << endl
-        << "    -B, --gcsa-binary     Write the GCSA graph in binary format." << endl
+        << "    -B, --gcsa-binary     Write the GCSA graph (or with -c, the counts) in binary format." << endl
         << "    -F, --forward-only    When producing GCSA2 output, don't describe the reverse strand" << endl
         << "    -P, --path-only       Only consider kmers if they occur in a path embedded in the graph" << endl
         << "    -H, --head-id N       use the specified ID for the GCSA2 head sentinel node" << endl
         << "    -T, --tail-id N       use the specified ID for the GCSA2 tail sentinel node" << endl
+        << "    -c, --count           count distinct kmers. Output is: kmer count id pos," << endl
+        << "                          giving the lowest position the kmer occurs at" << endl
+        << "    -m, --min-count N     with -c, only report kmers occurring at least N times (default 1)" << endl
+        << "    -M, --memory-mb N     with -c, use about N MB of memory, spilling kmers to disk" << endl
+        << "                          (default 1024)" << endl
         << "    -p, --progress        show progress" << endl;
 }
 
@@ -63,6 +69,9 @@ int main_kmers(int argc, char** argv) {
     int64_t tail_id = 0;
     bool forward_only = false;
     bool gcsa_binary = false;
+    bool count_kmers = false;
+    size_t min_count = 1;
+    size_t memory_mb = 1024;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -84,11 +93,14 @@ int main_kmers(int argc, char** argv) {
             {"forward-only", no_argument, 0, 'F'},
             {"gcsa-binary", no_argument, 0, 'B'},
             {"path-only", no_argument, 0, 'P'},
+            {"count", no_argument, 0, 'c'},
+            {"min-count", required_argument, 0, 'm'},
+            {"memory-mb", required_argument, 0, 'M'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hk:j:pt:e:gdnH:T:FBP",
+        c = getopt_long (argc, argv, "hk:j:pt:e:gdnH:T:FBPcm:M:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -151,6 +163,18 @@ int main_kmers(int argc, char** argv) {
                 gcsa_binary = true;
                 break;
 
+            case 'c':
+                count_kmers = true;
+                break;
+
+            case 'm':
+                min_count = atoll(optarg);
+                break;
+
+            case 'M':
+                memory_mb = atoll(optarg);
+                break;
+
             case 'h':
             case '?':
                 help_kmers(argv);
@@ -186,6 +210,31 @@ int main_kmers(int argc, char** argv) {
         } else {
             graphs.write_gcsa_kmers_binary(cout, kmer_size, path_only, forward_only, head_id, tail_id);
         }
+    } else if (count_kmers) {
+        if (kmer_size <= 0) {
+            cerr << "error:[vg kmers] Counting kmers (-c) requires a kmer size (-k)." << endl;
+            exit(1);
+        }
+        KmerCounter counter(kmer_size, memory_mb * 1024 * 1024);
+        function<void(string&, list<NodeTraversal>::iterator, int, list<NodeTraversal>&, VG& graph)>
+            lambda = [&](string& kmer, list<NodeTraversal>::iterator n, int p, list<NodeTraversal>& path, VG& graph) {
+                // Positions are encoded as in the normal output
+                int sign = (*n).backward ? -1 : 1;
+                counter.add(kmer, (*n).node->id() * sign, p * sign);
+            };
+        // Every occurrence has to be seen to be counted
+        graphs.for_each_kmer_parallel(lambda, kmer_size, path_only, edge_max, kmer_stride, true, allow_negs);
+
+        if (gcsa_binary) {
+            KmerCounter::write_binary_header(cout, kmer_size);
+        }
+        counter.for_each_count([&](const KmerCount& count) {
+            if (gcsa_binary) {
+                KmerCounter::write_binary(cout, count);
+            } else {
+                cout << count.kmer << '\t' << count.count << '\t' << count.node_id << '\t' << count.offset << '\n';
+            }
+        }, min_count);
     } else {
         function<void(string&, list<NodeTraversal>::iterator, int, list<NodeTraversal>&, VG& graph)>
             lambda = [](string& kmer, list<NodeTraversal>::iterator n, int p, list<NodeTraversal>& path, VG& graph) {
@@ -3,6 +3,7 @@
 #include "../utility.hpp"
 #include "../mapper.hpp"
 #include "../stream.hpp"
+#include "../stage_profiler.hpp"
 
 using namespace vg;
 using namespace vg::subcommand;
@@ -34,13 +35,16 @@ void help_map(char** argv) {
          << "    -m, --acyclic-graph     improves runtime when the graph is acyclic" << endl
          << "    -w, --band-width INT    band width for long read alignment [256]" << endl
          << "    -J, --band-jump INT     the maximum jump we can see between bands (maximum length variant we can detect) [{-w}]" << endl
+         << "    --long-read-chain       seed reads longer than {-w} once, chain the seeds and align between them" << endl
          << "    -I, --fragment STR      fragment length distribution specification STR=m:μ:σ:o:d [10000:0:0:0:1]" << endl
          << "                            max, mean, stdev, orientation (1=same, 0=flip), direction (1=forward, 0=backward)" << endl
          << "    -U, --fixed-frag-model  don't learn the pair fragment model online, use {-I} without update" << endl
          << "    -p, --print-frag-model  suppress alignment output and print the fragment model on stdout as per {-I} format" << endl
          << "    -F, --frag-calc INT     update the fragment model every INT perfect pairs [10]" << endl
+         << "    --frag-model-in FILE    start from the fragment model and pairs saved in FILE by --frag-model-out" << endl
+         << "    --frag-model-out FILE   save the fragment model and the pairs it was learned from to FILE" << endl
          << "    -S, --fragment-x FLOAT  calculate max fragment size as frag_mean+frag_sd*FLOAT [10]" << endl
-         << "    -O, --mate-rescues INT  attempt up to INT mate rescues per pair [64]" << endl
+         << "    -O, --mate-rescues INT  rescue mates off the best INT pairs of each read pair [0]" << endl
          << "scoring:" << endl
          << "    -q, --match INT         use this match score [1]" << endl
          << "    -z, --mismatch INT      use this mismatch penalty [4]" << endl
@@ -62,7 +66,9 @@ void help_map(char** argv) {
          << "    -j, --output-json       output JSON rather than an alignment stream (helpful for debugging)" << endl
          << "    -Z, --buffer-size INT   buffer this many alignments together before outputting in GAM [100]" << endl
          << "    -X, --compare           realign GAM input (-G), writing alignment with \"correct\" field set to overlap with input" << endl
-         << "    -v, --refpos-table      for efficient testing output a table of name, chr, pos, mq, score" << endl
+         << "    -v, --refpos-table      for efficient testing output a table of name, chr, pos, mq, score (, haplotypes)" << endl
+         << "    --haplotype-count       annotate alignments with the number of xg haplotype threads consistent with them" << endl
+         << "    --profile FILE          write per-stage timings and event counts to FILE as JSON" << endl
          << "    -K, --keep-secondary    produce alignments for secondary input alignments in addition to primary ones" << endl
          << "    -M, --max-multimaps INT produce up to INT alignments for each read [1]" << endl
          << "    -B, --band-multi INT    consider this many alignments of each band in banded alignment [4]" << endl
@@ -100,6 +106,7 @@ int main_map(int argc, char** argv) {
     int band_width = 256;
     int band_multimaps = 4;
     int max_band_jump = -1;
+    bool long_read_chaining = false;
     bool always_rescue = false;
     bool top_pairs_only = false;
     int max_mem_length = 0;
@@ -138,12 +145,16 @@ int main_map(int argc, char** argv) {
     int kmer_size = 0; // if we set to positive, we'd revert to the old kmer based mapper
     int kmer_stride = 0;
     int pair_window = 64; // unused
-    int mate_rescues = 64;
+    int mate_rescues = 0;
     bool fixed_fragment_model = false;
     bool print_fragment_model = false;
     int fragment_model_update = 10;
+    string frag_model_in_file;
+    string frag_model_out_file;
     bool acyclic_graph = false;
     bool refpos_table = false;
+    bool haplotype_count = false;
+    string profile_file;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -206,11 +217,16 @@ int main_map(int argc, char** argv) {
                 {"frag-calc", required_argument, 0, 'F'},
                 {"id-mq-weight", required_argument, 0, '7'},
                 {"refpos-table", no_argument, 0, 'v'},
+                {"haplotype-count", no_argument, 0, '8'},
+                {"profile", required_argument, 0, '9'},
+                {"long-read-chain", no_argument, 0, '0'},
+                {"frag-model-in", required_argument, 0, '1'},
+                {"frag-model-out", required_argument, 0, '2'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "s:J:Q:d:x:g:T:N:R:c:M:t:G:jb:Kf:iw:P:Dk:Y:r:W:6aH:Z:q:z:o:y:Au:B:I:S:l:e:C:V:O:L:n:E:X:UpF:m7:v",
+        c = getopt_long (argc, argv, "s:J:Q:d:x:g:T:N:R:c:M:t:G:jb:Kf:iw:P:Dk:Y:r:W:6aH:Z:q:z:o:y:Au:B:I:S:l:e:C:V:O:L:n:E:X:UpF:m7:v89:01:2:",
                          long_options, &option_index);
 
 
@@ -342,6 +358,10 @@ int main_map(int argc, char** argv) {
             max_band_jump = atoi(optarg);
             break;
 
+        case '0':
+            long_read_chaining = true;
+            break;
+
         case 'P':
             min_score = atof(optarg);
             break;
@@ -403,6 +423,14 @@ int main_map(int argc, char** argv) {
             refpos_table = true;
             break;
 
+        case '8':
+            haplotype_count = true;
+            break;
+
+        case '9':
+            profile_file = optarg;
+            break;
+
         case 'I':
         {
             vector<string> parts = split_delims(string(optarg), ":");
@@ -441,6 +469,14 @@ int main_map(int argc, char** argv) {
             fragment_model_update = atoi(optarg);
             break;
 
+        case '1':
+            frag_model_in_file = optarg;
+            break;
+
+        case '2':
+            frag_model_out_file = optarg;
+            break;
+
         case 'h':
         case '?':
             /* getopt_long already printed an error message. */
@@ -459,6 +495,35 @@ int main_map(int argc, char** argv) {
         return 1;
     }
 
+    ofstream profile_out;
+    if (!profile_file.empty()) {
+        profile_out.open(profile_file);
+        if (!profile_out) {
+            cerr << "error:[vg map] could not open " << profile_file << " for writing." << endl;
+            return 1;
+        }
+        StageProfiler::enabled = true;
+    }
+
+    string frag_model;
+    if (!frag_model_in_file.empty()) {
+        ifstream frag_model_in(frag_model_in_file);
+        if (!frag_model_in) {
+            cerr << "error:[vg map] could not open " << frag_model_in_file << " for reading." << endl;
+            return 1;
+        }
+        frag_model.assign(istreambuf_iterator<char>(frag_model_in), istreambuf_iterator<char>());
+    }
+
+    ofstream frag_model_out;
+    if (!frag_model_out_file.empty()) {
+        frag_model_out.open(frag_model_out_file);
+        if (!frag_model_out) {
+            cerr << "error:[vg map] could not open " << frag_model_out_file << " for writing." << endl;
+            return 1;
+        }
+    }
+
     if (!qual.empty() && (seq.length() != qual.length())) {
         cerr << "error:[vg map] Sequence and base quality string must be the same length." << endl;
         return 1;
@@ -547,7 +612,8 @@ int main_map(int argc, char** argv) {
     auto output_alignments = [&output_buffer,
                               &output_json,
                               &buffer_size,
-                              &refpos_table](vector<Alignment>& alignments) {
+                              &refpos_table,
+                              &haplotype_count](vector<Alignment>& alignments) {
         // for(auto& alignment : alignments){
         //     cerr << "This is in output_alignments" << alignment.DebugString() << endl;
         // }
@@ -566,11 +632,18 @@ int main_map(int argc, char** argv) {
                     refpos = alignment.refpos(0);
                 }
 #pragma omp critical (cout)
-                cout << alignment.name() << "\t"
-                     << refpos.name() << "\t"
-                     << refpos.offset() << "\t"
-                     << alignment.mapping_quality() << "\t"
-                     << alignment.score() << "\n";
+                {
+                    cout << alignment.name() << "\t"
+                         << refpos.name() << "\t"
+                         << refpos.offset() << "\t"
+                         << alignment.mapping_quality() << "\t"
+                         << alignment.score();
+                    if (haplotype_count) {
+                        // Tack the haplotype count on as an extra column
+                        cout << "\t" << alignment.haplotype_count();
+                    }
+                    cout << "\n";
+                }
             }
         } else {
             // Otherwise write them through the buffer for our thread
@@ -631,12 +704,21 @@ int main_map(int argc, char** argv) {
             m->frag_stats.cached_fragment_direction = fragment_direction;
         }
         m->frag_stats.fragment_model_update_interval = fragment_model_update;
+        if (!frag_model_in_file.empty()) {
+            stringstream frag_model_in(frag_model);
+            if (!m->frag_stats.load_fragment_model(frag_model_in)) {
+                cerr << "error:[vg map] could not read a fragment model from " << frag_model_in_file << endl;
+                return 1;
+            }
+        }
         m->max_mapping_quality = max_mapping_quality;
         m->use_cluster_mq = use_cluster_mq;
         m->mate_rescues = mate_rescues;
         m->max_band_jump = max_band_jump > -1 ? max_band_jump : band_width;
+        m->long_read_chaining = long_read_chaining;
         m->identity_weight = identity_weight;
         m->assume_acyclic = acyclic_graph;
+        m->annotate_haplotype_counts = haplotype_count;
         mapper[i] = m;
     }
 
@@ -1006,6 +1088,15 @@ int main_map(int argc, char** argv) {
         }
     }
 
+    if (!frag_model_out_file.empty()) {
+        // pool the pairs that every thread learned from into one model
+        FragmentLengthStatistics pooled = mapper[0]->frag_stats;
+        for (int i = 1; i < thread_count; ++i) {
+            pooled.merge(mapper[i]->frag_stats);
+        }
+        pooled.save_fragment_model(frag_model_out);
+    }
+
     // clean up
     for (int i = 0; i < thread_count; ++i) {
         delete mapper[i];
@@ -1026,6 +1117,10 @@ int main_map(int argc, char** argv) {
 
     cout.flush();
 
+    if (StageProfiler::enabled) {
+        StageProfiler::write_json(profile_out);
+    }
+
     return 0;
 
 }
@@ -28,6 +28,7 @@ void help_mod(char** argv) {
          << "    -Q, --include-gt FILE   merge only the alleles in called genotypes into the graph" << endl
          << "    -Z, --translation FILE  write the translation generated by editing with -i to FILE" << endl
          << "    -P, --label-paths       don't edit with -i alignments, just use them for labeling the graph" << endl
+         << "    -Y, --no-aln-paths      don't embed the -i alignments as paths when editing with them" << endl
          << "    -c, --compact-ids       should we sort and compact the id space? (default false)" << endl
          << "    -C, --compact-ranks     compact mapping ranks in paths" << endl
          << "    -z, --sort              sort the graph using an approximate topological sort" << endl
@@ -93,6 +94,7 @@ int main_mod(int argc, char** argv) {
     string loci_file;
     bool called_genotypes_only = false;
     bool label_paths = false;
+    bool embed_aln_paths = true;
     bool compact_ids = false;
     bool prune_complex = false;
     int path_length = 0;
@@ -155,6 +157,7 @@ int main_mod(int argc, char** argv) {
             {"markers", no_argument, 0, 'm'},
             {"threads", no_argument, 0, 't'},
             {"label-paths", no_argument, 0, 'P'},
+            {"no-aln-paths", no_argument, 0, 'Y'},
             {"simplify", no_argument, 0, 's'},
             {"unchop", no_argument, 0, 'u'},
             {"normalize", no_argument, 0, 'n'},
@@ -186,7 +189,7 @@ int main_mod(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hk:oi:q:Q:cpl:e:mt:SX:KPsunzNAf:CDFr:Ig:x:RTU:Bbd:Ow:L:y:Z:Eav:G:",
+        c = getopt_long (argc, argv, "hk:oi:q:Q:cpl:e:mt:SX:KPYsunzNAf:CDFr:Ig:x:RTU:Bbd:Ow:L:y:Z:Eav:G:",
                 long_options, &option_index);
 
 
@@ -294,6 +297,10 @@ int main_mod(int argc, char** argv) {
             label_paths = true;
             break;
 
+        case 'Y':
+            embed_aln_paths = false;
+            break;
+
         case 'D':
             drop_paths = true;
             break;
@@ -721,12 +728,32 @@ int main_mod(int argc, char** argv) {
         *graph = g;
     }
 
-    if (!aln_file.empty()) {
+    if (!aln_file.empty() && aln_file != "-" && !label_paths) {
+        // edit straight from the file, streaming it once to find the
+        // breakpoints and again to add the new material
+        ofstream out;
+        if (!translation_file.empty()) {
+            out.open(translation_file);
+        }
+        vector<Translation> buffer;
+        graph->edit(aln_file, [&](Translation& trans) {
+                if (out.is_open()) {
+                    buffer.push_back(trans);
+                    stream::write_buffered(out, buffer, 1000);
+                }
+            }, embed_aln_paths);
+        if (out.is_open()) {
+            stream::write_buffered(out, buffer, 0);
+            out.close();
+        }
+    } else if (!aln_file.empty()) {
         // read in the alignments and save their paths
         vector<Path> paths;
-        function<void(Alignment&)> lambda = [&graph, &paths](Alignment& aln) {
+        function<void(Alignment&)> lambda = [&graph, &paths, &embed_aln_paths, &label_paths](Alignment& aln) {
             Path path = simplify(aln.path());
-            path.set_name(aln.name());
+            if (embed_aln_paths || label_paths) {
+                path.set_name(aln.name());
+            }
             paths.push_back(path);
         };
         if (aln_file == "-") {
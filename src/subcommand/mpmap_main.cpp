@@ -14,6 +14,7 @@
 #include "../alignment.hpp"
 #include "../multipath_mapper.hpp"
 #include "../gssw_aligner.hpp"
+#include "../stage_profiler.hpp"
 
 //#define debug_mpmap
 
@@ -61,7 +62,8 @@ void help_mpmap(char** argv) {
     << "  -A, --no-qual-adjust      do not perform base quality adjusted alignments" << endl
     << "computational parameters:" << endl
     << "  -t, --threads INT         number of compute threads to use" << endl
-    << "  -Z, --buffer-size INT     buffer this many alignments together (per compute thread) before outputting to stdout [100]" << endl;
+    << "  -Z, --buffer-size INT     buffer this many alignments together (per compute thread) before outputting to stdout [100]" << endl
+    << "  --profile FILE            write per-stage timings and event counts to FILE as JSON" << endl;
     
 }
 
@@ -103,6 +105,7 @@ int main_mpmap(int argc, char** argv) {
     double suboptimal_path_ratio = 10000.0;
     bool single_path_alignment_mode = false;
     int max_mapq = 60;
+    string profile_file;
     
     int c;
     optind = 2; // force optind past command positional argument
@@ -140,11 +143,12 @@ int main_mpmap(int argc, char** argv) {
             {"no-qual-adjust", no_argument, 0, 'A'},
             {"threads", required_argument, 0, 't'},
             {"buffer-size", required_argument, 0, 'Z'},
+            {"profile", required_argument, 0, '1'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:g:b:f:iG:Ss:u:a:v:Q:p:M:r:W:k:c:d:C:R:q:z:o:y:L:mAt:Z:",
+        c = getopt_long (argc, argv, "hx:g:b:f:iG:Ss:u:a:v:Q:p:M:r:W:k:c:d:C:R:q:z:o:y:L:mAt:Z:1:",
                          long_options, &option_index);
 
 
@@ -333,6 +337,10 @@ int main_mpmap(int argc, char** argv) {
                 buffer_size = atoi(optarg);
                 break;
                 
+            case '1':
+                profile_file = optarg;
+                break;
+                
             case 'h':
             case '?':
             default:
@@ -417,6 +425,16 @@ int main_mpmap(int argc, char** argv) {
         exit(1);
     }
     
+    ofstream profile_out;
+    if (!profile_file.empty()) {
+        profile_out.open(profile_file);
+        if (!profile_out) {
+            cerr << "error:[vg mpmap] Could not open profile file " << profile_file << " for writing." << endl;
+            exit(1);
+        }
+        StageProfiler::enabled = true;
+    }
+    
     // adjust parameters that produce irrelevant extra work in single path mode
     
     if (single_path_alignment_mode) {
@@ -597,6 +615,10 @@ int main_mpmap(int argc, char** argv) {
     }
     cout.flush();
     
+    if (StageProfiler::enabled) {
+        StageProfiler::write_json(profile_out);
+    }
+    
     delete snarl_manager;
     
     return 0;
@@ -2,6 +2,7 @@
 #include "../vg.hpp"
 #include "../utility.hpp"
 #include "../mapper.hpp"
+#include "../mem_overlay.hpp"
 #include "../stream.hpp"
 
 using namespace vg;
@@ -51,6 +52,8 @@ void help_msga(char** argv) {
          << "    -Q, --idx-prune-subs N  prune subgraphs shorter than this length from input graph to GCSA (default: off)" << endl
          << "    -m, --node-max N        chop nodes to be shorter than this length (default: 2* --idx-kmer-size)" << endl
          << "    -X, --idx-doublings N   use this many doublings when building the GCSA indexes (default: 2)" << endl
+         << "    --overlay FLOAT         rebuild the GCSA indexes only once FLOAT times the indexed length has been added," << endl
+         << "                            matching new sequence with an in-memory k-mer table until then (default: 0, always rebuild)" << endl
          << "graph normalization:" << endl
          << "    -N, --normalize         normalize the graph after assembly" << endl
          << "    -Z, --circularize       the input sequences are from circular genomes, circularize them after inclusion" << endl
@@ -123,6 +126,7 @@ int main_msga(int argc, char** argv) {
     int min_banded_mq = 0;
     bool use_fast_reseed = true;
     bool show_align_progress = false;
+    double overlay_factor = 0;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -170,11 +174,12 @@ int main_msga(int argc, char** argv) {
                 {"try-at-least", required_argument, 0, 'l'},
                 {"drop-chain", required_argument, 0, 'C'},
                 {"align-progress", no_argument, 0, 'S'},
+                {"overlay", required_argument, 0, '1'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hf:n:s:g:b:K:X:w:DAc:P:E:Q:NY:H:t:m:M:q:OI:i:o:y:ZW:z:k:L:e:r:u:l:C:F:SJ:B:",
+        c = getopt_long (argc, argv, "hf:n:s:g:b:K:X:w:DAc:P:E:Q:NY:H:t:m:M:q:OI:i:o:y:ZW:z:k:L:e:r:u:l:C:F:SJ:B:1:",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -343,6 +348,10 @@ int main_msga(int argc, char** argv) {
             full_length_bonus = atoi(optarg);
             break;
 
+        case '1':
+            overlay_factor = atof(optarg);
+            break;
+
         case 'h':
         case '?':
             help_msga(argv);
@@ -474,48 +483,110 @@ int main_msga(int argc, char** argv) {
     gcsa::GCSA* gcsaidx = nullptr;
     gcsa::LCPArray* lcpidx = nullptr;
     xg::XG* xgidx = nullptr;
+    // the XG index of the graph the GCSA2 index was built from, and the
+    // overlay that lets us map to the current graph with it, if we use one
+    xg::XG* base_xgidx = nullptr;
+    MEMOverlay* overlay = nullptr;
     size_t iter = 0;
     
     // Configure GCSA temp directory to the system temp directory
     gcsa::TempFile::setDirectory(find_temp_dir());
 
-    auto rebuild = [&](VG* graph) {
-        if (mapper) delete mapper;
-        if (xgidx) delete xgidx;
-        if (gcsaidx) delete gcsaidx;
-        if (lcpidx) delete lcpidx;
-    
-        //stringstream s; s << iter++ << ".vg";
+    // a fingerprint of everything the GCSA2 index depends on, so that we can
+    // tell when adding a sequence left the graph as it was
+    auto gcsa_fingerprint = [&](VG* graph) {
+        size_t h = 0;
+        for (size_t i = 0; i < graph->graph.node_size(); ++i) {
+            const Node& node = graph->graph.node(i);
+            hash_combine(h, node.id());
+            hash_combine(h, node.sequence());
+        }
+        for (size_t i = 0; i < graph->graph.edge_size(); ++i) {
+            const Edge& edge = graph->graph.edge(i);
+            hash_combine(h, make_tuple(edge.from(), edge.to(), edge.from_start(), edge.to_end()));
+        }
+        return make_tuple((size_t) graph->graph.node_size(), (size_t) graph->graph.edge_size(), h);
+    };
+
+    // the fingerprint of the graph that the current GCSA2 index was built from
+    tuple<size_t, size_t, size_t> gcsa_graph_fingerprint;
+
+    // put the graph in the order we serialize and index it in
+    auto prepare_graph = [&](VG* graph) {
         graph->sort();
         graph->sync_paths();
         graph->graph.clear_path();
         graph->paths.to_graph(graph->graph);
         graph->rebuild_indexes();
+    };
+
+    auto rebuild = [&](VG* graph) {
+        if (mapper) delete mapper;
+    
+        //stringstream s; s << iter++ << ".vg";
+        prepare_graph(graph);
 
         if (debug) cerr << "building xg index" << endl;
+        xg::XG* last_xgidx = xgidx;
         xgidx = new xg::XG(graph->graph);
 
-        if (debug) cerr << "building GCSA2 index" << endl;
-        // Configure GCSA2 verbosity so it doesn't spit out loads of extra info
-        if(!debug) gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
-        
-        // Configure its temp directory to the system temp directory
-        gcsa::TempFile::setDirectory(find_temp_dir());
-
-        if (edge_max) {
-            VG gcsa_graph = *graph; // copy the graph
-            // remove complex components
-            gcsa_graph.prune_complex_with_head_tail(idx_kmer_size, edge_max);
-            if (subgraph_prune) gcsa_graph.prune_short_subgraphs(subgraph_prune);
-            // then index
-            gcsa_graph.build_gcsa_lcp(gcsaidx, lcpidx, idx_kmer_size, idx_path_only, false, doubling_steps);
-        } else {
-            // if no complexity reduction is requested, just build the index
-            graph->build_gcsa_lcp(gcsaidx, lcpidx, idx_kmer_size, idx_path_only, false, doubling_steps);
+        // the GCSA2 index is by far the most expensive to build, and only
+        // depends on the paths if we're indexing paths only, so keep it if the
+        // last sequence added nothing new to the graph
+        auto fingerprint = gcsa_fingerprint(graph);
+        bool keep_gcsa = gcsaidx && lcpidx && !idx_path_only && fingerprint == gcsa_graph_fingerprint;
+        if (keep_gcsa) {
+            if (debug) cerr << "graph is unchanged, keeping GCSA2 index" << endl;
+        }
+        // or if not much has been added since, and the overlay can make up the difference
+        if (overlay) {
+            overlay->update(xgidx);
+            if (!keep_gcsa && overlay->added_length() <= overlay_factor * base_xgidx->seq_length) {
+                if (debug) cerr << "overlaying " << overlay->added_length() << "bp of new sequence on GCSA2 index" << endl;
+                keep_gcsa = true;
+            }
         }
+        if (!keep_gcsa) {
+            if (overlay) {
+                delete overlay;
+                overlay = nullptr;
+            }
+            if (base_xgidx && base_xgidx != last_xgidx) delete base_xgidx;
+            base_xgidx = nullptr;
+            if (gcsaidx) delete gcsaidx;
+            if (lcpidx) delete lcpidx;
+
+            if (debug) cerr << "building GCSA2 index" << endl;
+            // Configure GCSA2 verbosity so it doesn't spit out loads of extra info
+            if(!debug) gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+            
+            // Configure its temp directory to the system temp directory
+            gcsa::TempFile::setDirectory(find_temp_dir());
+
+            if (edge_max) {
+                VG gcsa_graph = *graph; // copy the graph
+                // remove complex components
+                gcsa_graph.prune_complex_with_head_tail(idx_kmer_size, edge_max);
+                if (subgraph_prune) gcsa_graph.prune_short_subgraphs(subgraph_prune);
+                // then index
+                gcsa_graph.build_gcsa_lcp(gcsaidx, lcpidx, idx_kmer_size, idx_path_only, false, doubling_steps);
+            } else {
+                // if no complexity reduction is requested, just build the index
+                graph->build_gcsa_lcp(gcsaidx, lcpidx, idx_kmer_size, idx_path_only, false, doubling_steps);
+            }
+            gcsa_graph_fingerprint = fingerprint;
+            if (overlay_factor > 0) {
+                // compact_ids() leaves the graph with IDs 1 to the node count
+                base_xgidx = xgidx;
+                overlay = new MEMOverlay(base_xgidx, gcsaidx, base_xgidx->node_count, min(idx_kmer_size, 32));
+                overlay->update(xgidx);
+            }
+        }
+        if (last_xgidx && last_xgidx != base_xgidx) delete last_xgidx;
         mapper = new Mapper(xgidx, gcsaidx, lcpidx);
         { // set mapper variables
             mapper->hit_max = hit_max;
+            mapper->mem_overlay = (overlay && xgidx != base_xgidx) ? overlay : nullptr;
             mapper->max_multimaps = max_multimaps;
             mapper->min_multimaps = min_multimaps;
             mapper->maybe_mq_threshold = maybe_mq_threshold;
@@ -550,6 +621,8 @@ int main_msga(int argc, char** argv) {
 
     // set up the graph for mapping
     rebuild(graph);
+    // set when the graph has changed since the indexes were last built
+    bool indexes_stale = false;
 
     // todo restructure so that we are trying to map everything
     // add alignment score/bp bounds to catch when we get a good alignment
@@ -560,14 +633,6 @@ int main_msga(int argc, char** argv) {
         int iter = 0;
         auto& seq = strings[name];
         //cerr << "doing... " << name << endl;
-#ifdef debug
-        {
-            graph->serialize_to_file("msga-pre-" + name + ".vg");
-            ofstream db_out("msga-pre-" + name + ".xg");
-            xgidx->serialize(db_out);
-            db_out.close();
-        }
-#endif
         while (incomplete && iter++ < iter_max) {
             stringstream s; s << iter; string iterstr = s.str();
             if (debug) cerr << name << ": adding to graph" << iter << endl;
@@ -576,6 +641,18 @@ int main_msga(int argc, char** argv) {
             // align to the graph
             if (debug) cerr << name << ": aligning sequence of " << seq.size() << "bp against " <<
                 graph->node_count() << " nodes" << endl;
+            if (indexes_stale) {
+                rebuild(graph);
+                indexes_stale = false;
+            }
+#ifdef debug
+            {
+                graph->serialize_to_file("msga-pre-" + name + ".vg");
+                ofstream db_out("msga-pre-" + name + ".xg");
+                xgidx->serialize(db_out);
+                db_out.close();
+            }
+#endif
             Alignment aln = simplify(mapper->align(seq, 0, 0, 0, band_width));
             aln.set_name(name);
             if (aln.path().mapping_size()) {
@@ -635,9 +712,10 @@ int main_msga(int argc, char** argv) {
             // update the paths
             graph->graph.clear_path();
             graph->paths.to_graph(graph->graph);
-            // and rebuild the indexes
-            rebuild(graph);
-            //graph->serialize_to_file(name + "-post-index.vg");
+            graph->rebuild_indexes();
+            // the mapping indexes need to be rebuilt before we align again,
+            // but if this was the last sequence we never have to
+            indexes_stale = true;
 
             // verfy validity of path
             bool is_valid = graph->is_valid();
@@ -686,6 +764,12 @@ int main_msga(int argc, char** argv) {
     //          }
     //      };
 
+    // the last sequence's edit left the graph unsorted, since we didn't need
+    // to index it again
+    if (indexes_stale) {
+        prepare_graph(graph);
+    }
+
     if (normalize) {
         if (debug) cerr << "normalizing graph" << endl;
         graph->remove_non_path();
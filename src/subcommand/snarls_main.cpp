@@ -25,6 +25,9 @@ void help_snarl(char** argv) {
          << "options:" << endl
          << "    -b, --superbubbles    describe (in text) the superbubbles of the graph" << endl
          << "    -u, --ultrabubbles    describe (in text) the ultrabubbles of the graph" << endl
+         << "    -c, --by-component    write each weakly connected component's snarls as soon as it is" << endl
+         << "                          decomposed, without indexing the whole graph (component order varies)" << endl
+         << "    -T, --threads N       number of threads to use for decomposing components [all available]" << endl
          << "traversals:" << endl
          << "    -p, --pathnames       output variant paths as SnarlTraversals to STDOUT" << endl
          << "    -r, --traversals FILE output SnarlTraversals for ultrabubbles." << endl
@@ -53,6 +56,7 @@ int main_snarl(int argc, char** argv) {
     bool filter_trivial_bubbles = false;
     bool sort_snarls = false;
     bool fill_path_names = false;
+    bool by_component = false;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -68,12 +72,14 @@ int main_snarl(int argc, char** argv) {
                 {"max-nodes", required_argument, 0, 'm'},
                 {"filter-trivial", no_argument, 0, 't'},
                 {"sort-snarls", no_argument, 0, 's'},
+                {"by-component", no_argument, 0, 'c'},
+                {"threads", required_argument, 0, 'T'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
 
-        c = getopt_long (argc, argv, "bsur:ltopm:h?",
+        c = getopt_long (argc, argv, "bsur:ltopm:cT:h?",
                          long_options, &option_index);
 
         /* Detect the end of the options. */
@@ -118,6 +124,14 @@ int main_snarl(int argc, char** argv) {
             fill_path_names = true;
             break;
             
+        case 'c':
+            by_component = true;
+            break;
+            
+        case 'T':
+            omp_set_num_threads(atoi(optarg));
+            break;
+            
         case 'h':
         case '?':
             /* getopt_long already printed an error message. */
@@ -138,6 +152,11 @@ int main_snarl(int argc, char** argv) {
             return 1;
         }
     }
+    
+    if (by_component && (!traversal_file.empty() || fill_path_names || sort_snarls)) {
+        cerr << "error:[vg snarl]: -c cannot be combined with -r, -p, or -s" << endl;
+        return 1;
+    }
 
     // Prepare traversal output stream
     ofstream trav_stream;
@@ -179,7 +198,22 @@ int main_snarl(int argc, char** argv) {
     }
     
     // The only implemented snarl finder:
-    SnarlFinder* snarl_finder = new CactusUltrabubbleFinder(*graph, "", filter_trivial_bubbles);
+    CactusUltrabubbleFinder* snarl_finder = new CactusUltrabubbleFinder(*graph, "", filter_trivial_bubbles);
+    
+    if (by_component) {
+        // Stream out each component's snarl tree as soon as it's done,
+        // without ever holding all of the snarls at once. Snarls within a
+        // component come parents first.
+        snarl_finder->for_each_component_snarls([&](size_t component_number, vector<Snarl>& snarls) {
+            if (!snarls.empty()) {
+                stream::write_buffered(cout, snarls, 0);
+            }
+        });
+        
+        delete snarl_finder;
+        delete graph;
+        return 0;
+    }
     
     // Load up all the snarls
     SnarlManager snarl_manager = snarl_finder->find_snarls();
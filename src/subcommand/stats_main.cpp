@@ -20,6 +20,79 @@ using namespace std;
 using namespace vg;
 using namespace vg::subcommand;
 
+/// Statistics over a set of alignments. Each thread accumulates its own, and
+/// they are summed up once all the alignments have been seen.
+struct AlignmentStats {
+    size_t total_alignments = 0;
+    size_t total_aligned = 0;
+    size_t total_primary = 0;
+    size_t total_secondary = 0;
+
+    // Inserted bases also counts softclips
+    size_t total_insertions = 0;
+    size_t total_inserted_bases = 0;
+    size_t total_deletions = 0;
+    size_t total_deleted_bases = 0;
+    size_t total_substitutions = 0;
+    size_t total_substituted_bases = 0;
+    size_t total_softclips = 0;
+    size_t total_softclipped_bases = 0;
+
+    // In verbose mode we want to report details of insertions, deletions,
+    // and substitutions, and soft clips.
+    vector<pair<vg::id_t, Edit>> insertions;
+    vector<pair<vg::id_t, Edit>> deletions;
+    vector<pair<vg::id_t, Edit>> substitutions;
+    vector<pair<vg::id_t, Edit>> softclips;
+
+    // Reads supporting each allele of each site
+    map<string, map<string, size_t>> reads_on_allele;
+
+    // Distributions over aligned primary reads, from value to count. Add new
+    // ones before DISTRIBUTION_COUNT and name them in distribution_names.
+    enum Distribution {IDENTITY, MAPQ, SOFTCLIP, FRAGMENT_LENGTH, DISTRIBUTION_COUNT};
+    static const char* distribution_names[DISTRIBUTION_COUNT];
+    map<int64_t, size_t> distributions[DISTRIBUTION_COUNT];
+
+    AlignmentStats& operator+=(const AlignmentStats& other) {
+        total_alignments += other.total_alignments;
+        total_aligned += other.total_aligned;
+        total_primary += other.total_primary;
+        total_secondary += other.total_secondary;
+        total_insertions += other.total_insertions;
+        total_inserted_bases += other.total_inserted_bases;
+        total_deletions += other.total_deletions;
+        total_deleted_bases += other.total_deleted_bases;
+        total_substitutions += other.total_substitutions;
+        total_substituted_bases += other.total_substituted_bases;
+        total_softclips += other.total_softclips;
+        total_softclipped_bases += other.total_softclipped_bases;
+
+        insertions.insert(insertions.end(), other.insertions.begin(), other.insertions.end());
+        deletions.insert(deletions.end(), other.deletions.begin(), other.deletions.end());
+        substitutions.insert(substitutions.end(), other.substitutions.begin(), other.substitutions.end());
+        softclips.insert(softclips.end(), other.softclips.begin(), other.softclips.end());
+
+        for (auto& site_and_alleles : other.reads_on_allele) {
+            for (auto& allele_and_count : site_and_alleles.second) {
+                reads_on_allele[site_and_alleles.first][allele_and_count.first] += allele_and_count.second;
+            }
+        }
+
+        for (size_t i = 0; i < DISTRIBUTION_COUNT; i++) {
+            for (auto& value_and_count : other.distributions[i]) {
+                distributions[i][value_and_count.first] += value_and_count.second;
+            }
+        }
+
+        return *this;
+    }
+};
+
+const char* AlignmentStats::distribution_names[AlignmentStats::DISTRIBUTION_COUNT] = {
+    "Identity (%)", "Mapping quality", "Softclipped bases", "Fragment length"
+};
+
 void help_stats(char** argv) {
     cerr << "usage: " << argv[0] << " stats [options] <graph.vg>" << endl
          << "options:" << endl
@@ -37,6 +110,8 @@ void help_stats(char** argv) {
          << "    -d, --to-head         show distance to head for each provided node" << endl
          << "    -t, --to-tail         show distance to head for each provided node" << endl
          << "    -a, --alignments FILE compute stats for reads aligned to the graph" << endl
+         << "    -D, --distributions   with -a, also report the identity, MAPQ, softclip and" << endl
+         << "                          fragment length distributions of aligned primary reads" << endl
          << "    -r, --node-id-range   X:Y where X and Y are the smallest and largest "
         "node id in the graph, respectively" << endl
          << "    -o, --overlap PATH    for each overlapping path mapping in the graph write a table:" << endl
@@ -71,6 +146,7 @@ int main_stats(int argc, char** argv) {
     // What alignments GAM file should we read and compute stats on with the
     // graph?
     string alignments_filename;
+    bool show_distributions = false;
     vector<string> paths_to_overlap;
     bool overlap_all_paths = false;
 
@@ -93,6 +169,7 @@ int main_stats(int argc, char** argv) {
             {"to-tail", no_argument, 0, 't'},
             {"node", required_argument, 0, 'n'},
             {"alignments", required_argument, 0, 'a'},
+            {"distributions", no_argument, 0, 'D'},
             {"is-acyclic", no_argument, 0, 'A'},
             {"node-id-range", no_argument, 0, 'r'},
             {"verbose", no_argument, 0, 'v'},
@@ -102,7 +179,7 @@ int main_stats(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hzlsHTScdtn:NEa:vAro:O",
+        c = getopt_long (argc, argv, "hzlsHTScdtn:NEa:DvAro:O",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -167,6 +244,10 @@ int main_stats(int argc, char** argv) {
             alignments_filename = optarg;
             break;
 
+        case 'D':
+            show_distributions = true;
+            break;
+
         case 'r':
             stats_range = true;
             break;
@@ -450,59 +531,44 @@ int main_stats(int argc, char** argv) {
         });
 
 
-        // These are the general stats we will compute.
-        size_t total_alignments = 0;
-        size_t total_aligned = 0;
-        size_t total_primary = 0;
-        size_t total_secondary = 0;
-
         // These are for counting significantly allele-biased hets
         size_t total_hets = 0;
         size_t significantly_biased_hets = 0;
 
-        // These are for tracking which nodes are covered and which are not
-        map<vg::id_t, size_t> node_visit_counts;
-
-        // And for counting indels
-        // Inserted bases also counts softclips
-        size_t total_insertions = 0;
-        size_t total_inserted_bases = 0;
-        size_t total_deletions = 0;
-        size_t total_deleted_bases = 0;
-        // And substitutions
-        size_t total_substitutions = 0;
-        size_t total_substituted_bases = 0;
-        // And softclips
-        size_t total_softclips = 0;
-        size_t total_softclipped_bases = 0;
-
-        // In verbose mode we want to report details of insertions, deletions,
-        // and substitutions, and soft clips.
-        vector<pair<vg::id_t, Edit>> insertions;
-        vector<pair<vg::id_t, Edit>> deletions;
-        vector<pair<vg::id_t, Edit>> substitutions;
-        vector<pair<vg::id_t, Edit>> softclips;
+        // Number the nodes densely, so visits can be counted in flat arrays
+        // rather than maps.
+        hash_map<vg::id_t, size_t> node_rank;
+        for (size_t i = 0; i < graph->graph.node_size(); i++) {
+            node_rank[graph->graph.node(i).id()] = i;
+        }
+
+        // Visits to each node, indexed by the node's rank. This is shared by
+        // all the threads, since a copy per thread would be as big as the
+        // graph.
+        vector<size_t> node_visit_counts(graph->graph.node_size(), 0);
+
+        // Each thread accumulates the rest of its own stats, which we merge
+        // once all the reads have been seen.
+        int thread_count = get_thread_count();
+        vector<AlignmentStats> thread_stats(thread_count);
 
         function<void(Alignment&)> lambda = [&](Alignment& aln) {
             int tid = omp_get_thread_num();
+            AlignmentStats& stats = thread_stats[tid];
 
             // We ought to be able to do many stats on the alignments.
 
             // Now do all the non-mapping stats
-            #pragma omp critical (total_alignments)
-            total_alignments++;
+            stats.total_alignments++;
             if(aln.is_secondary()) {
-                #pragma omp critical (total_secondary)
-                total_secondary++;
+                stats.total_secondary++;
             } else {
-                #pragma omp critical (total_primary)
-                total_primary++;
+                stats.total_primary++;
                 if(aln.score() > 0) {
                     // We only count aligned primary reads in "total aligned";
                     // the primary can't be unaligned if the secondary is
                     // aligned.
-                    #pragma omp critical (total_aligned)
-                    total_aligned++;
+                    stats.total_aligned++;
                 }
 
                 // Which sites and alleles does this read support. TODO: if we hit
@@ -511,6 +577,9 @@ int main_stats(int argc, char** argv) {
                 // like we do now.
                 set<pair<string, string>> alleles_supported;
 
+                // How many bases were soft clipped off this read
+                size_t read_softclipped_bases = 0;
+
                 for(size_t i = 0; i < aln.path().mapping_size(); i++) {
                     // For every mapping...
                     auto& mapping = aln.path().mapping(i);
@@ -524,8 +593,11 @@ int main_stats(int argc, char** argv) {
                     }
 
                     // Record that there was a visit to this node.
-                    #pragma omp critical (node_visit_counts)
-                    node_visit_counts[node_id]++;
+                    auto rank = node_rank.find(node_id);
+                    if (rank != node_rank.end()) {
+                        #pragma omp atomic update
+                        node_visit_counts[rank->second]++;
+                    }
 
                     for(size_t j = 0; j < mapping.edit_size(); j++) {
                         // Go through edits and look for each type.
@@ -534,50 +606,39 @@ int main_stats(int argc, char** argv) {
                         if(edit.to_length() > edit.from_length()) {
                             if((j == 0 && i == 0) || (j == mapping.edit_size() - 1 && i == aln.path().mapping_size() - 1)) {
                                 // We're at the very end of the path, so this is a soft clip.
-                                #pragma omp critical (total_softclipped_bases)
-                                total_softclipped_bases += edit.to_length() - edit.from_length();
-                                #pragma omp critical (total_softclips)
-                                total_softclips++;
+                                stats.total_softclipped_bases += edit.to_length() - edit.from_length();
+                                stats.total_softclips++;
+                                read_softclipped_bases += edit.to_length() - edit.from_length();
                                 if(verbose) {
                                     // Record the actual insertion
-                                    #pragma omp critical (softclips)
-                                    softclips.push_back(make_pair(node_id, edit));
+                                    stats.softclips.push_back(make_pair(node_id, edit));
                                 }
                             } else {
                                 // Record this insertion
-                                #pragma omp critical (total_inserted_bases)
-                                total_inserted_bases += edit.to_length() - edit.from_length();
-                                #pragma omp critical (total_insertions)
-                                total_insertions++;
+                                stats.total_inserted_bases += edit.to_length() - edit.from_length();
+                                stats.total_insertions++;
                                 if(verbose) {
                                     // Record the actual insertion
-                                    #pragma omp critical (insertions)
-                                    insertions.push_back(make_pair(node_id, edit));
+                                    stats.insertions.push_back(make_pair(node_id, edit));
                                 }
                             }
 
                         } else if(edit.from_length() > edit.to_length()) {
                             // Record this deletion
-                            #pragma omp critical (total_deleted_bases)
-                            total_deleted_bases += edit.from_length() - edit.to_length();
-                            #pragma omp critical (total_deletions)
-                            total_deletions++;
+                            stats.total_deleted_bases += edit.from_length() - edit.to_length();
+                            stats.total_deletions++;
                             if(verbose) {
                                 // Record the actual deletion
-                                #pragma omp critical (deletions)
-                                deletions.push_back(make_pair(node_id, edit));
+                                stats.deletions.push_back(make_pair(node_id, edit));
                             }
                         } else if(!edit.sequence().empty()) {
                             // Record this substitution
                             // TODO: a substitution might also occur as part of a deletion/insertion above!
-                            #pragma omp critical (total_substituted_bases)
-                            total_substituted_bases += edit.from_length();
-                            #pragma omp critical (total_substitutions)
-                            total_substitutions++;
+                            stats.total_substituted_bases += edit.from_length();
+                            stats.total_substitutions++;
                             if(verbose) {
                                 // Record the actual substitution
-                                #pragma omp critical (substitutions)
-                                substitutions.push_back(make_pair(node_id, edit));
+                                stats.substitutions.push_back(make_pair(node_id, edit));
                             }
                         }
 
@@ -587,8 +648,17 @@ int main_stats(int argc, char** argv) {
                 for(auto& site_and_allele : alleles_supported) {
                     // This read is informative for an allele of a site.
                     // Up the reads on that allele of that site.
-                    #pragma omp critical (reads_on_allele)
-                    reads_on_allele[site_and_allele.first][site_and_allele.second]++;
+                    stats.reads_on_allele[site_and_allele.first][site_and_allele.second]++;
+                }
+
+                if (show_distributions && aln.score() > 0) {
+                    // Bin the aligned primary reads by their properties
+                    stats.distributions[AlignmentStats::IDENTITY][(int64_t) (aln.identity() * 100)]++;
+                    stats.distributions[AlignmentStats::MAPQ][aln.mapping_quality()]++;
+                    stats.distributions[AlignmentStats::SOFTCLIP][read_softclipped_bases]++;
+                    if (aln.fragment_size() > 0) {
+                        stats.distributions[AlignmentStats::FRAGMENT_LENGTH][aln.fragment(0).length()]++;
+                    }
                 }
             }
 
@@ -597,6 +667,17 @@ int main_stats(int argc, char** argv) {
         // Actually go through all the reads and count stuff up.
         stream::for_each_parallel(alignment_stream, lambda);
 
+        // Reduce the per-thread stats into the first thread's
+        AlignmentStats& stats = thread_stats[0];
+        for (size_t i = 1; i < thread_stats.size(); i++) {
+            stats += thread_stats[i];
+        }
+        for (auto& site_and_alleles : stats.reads_on_allele) {
+            for (auto& allele_and_count : site_and_alleles.second) {
+                reads_on_allele[site_and_alleles.first][allele_and_count.first] += allele_and_count.second;
+            }
+        }
+
         // Calculate stats about the reads per allele data
         for(auto& site_and_alleles : reads_on_allele) {
             // For every site
@@ -654,60 +735,55 @@ int main_stats(int argc, char** argv) {
         // as many times as their nodes are touched. Also note that we ignore
         // edge effects and a read that stops before the end of a node will
         // visit the whole node.
-        graph->for_each_node_parallel([&](Node* node) {
+        for (size_t i = 0; i < graph->graph.node_size(); i++) {
             // For every node
-            if(!node_visit_counts.count(node->id()) || node_visit_counts.at(node->id()) == 0) {
+            const Node& node = graph->graph.node(i);
+            if(node_visit_counts[i] == 0) {
                 // If we never visited it with a read, count it.
-                #pragma omp critical (unvisited_nodes)
                 unvisited_nodes++;
-                #pragma omp critical (unvisited_node_bases)
-                unvisited_node_bases += node->sequence().size();
+                unvisited_node_bases += node.sequence().size();
                 if(verbose) {
-                    #pragma omp critical (unvisited_ids)
-                    unvisited_ids.insert(node->id());
+                    unvisited_ids.insert(node.id());
                 }
-            } else if(node_visit_counts.at(node->id()) == 1) {
+            } else if(node_visit_counts[i] == 1) {
                 // If we visited it with only one read, count it.
-                #pragma omp critical (single_visited_nodes)
                 single_visited_nodes++;
-                #pragma omp critical (single_visited_node_bases)
-                single_visited_node_bases += node->sequence().size();
+                single_visited_node_bases += node.sequence().size();
                 if(verbose) {
-                    #pragma omp critical (single_visited_ids)
-                    single_visited_ids.insert(node->id());
+                    single_visited_ids.insert(node.id());
                 }
             }
-        });
+        }
 
-        cout << "Total alignments: " << total_alignments << endl;
-        cout << "Total primary: " << total_primary << endl;
-        cout << "Total secondary: " << total_secondary << endl;
-        cout << "Total aligned: " << total_aligned << endl;
+        cout << "Total alignments: " << stats.total_alignments << endl;
+        cout << "Total primary: " << stats.total_primary << endl;
+        cout << "Total secondary: " << stats.total_secondary << endl;
+        cout << "Total aligned: " << stats.total_aligned << endl;
 
-        cout << "Insertions: " << total_inserted_bases << " bp in " << total_insertions << " read events" << endl;
+        cout << "Insertions: " << stats.total_inserted_bases << " bp in " << stats.total_insertions << " read events" << endl;
         if(verbose) {
-            for(auto& id_and_edit : insertions) {
+            for(auto& id_and_edit : stats.insertions) {
                 cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.sequence()
                     << " on " << id_and_edit.first << endl;
             }
         }
-        cout << "Deletions: " << total_deleted_bases << " bp in " << total_deletions << " read events" << endl;
+        cout << "Deletions: " << stats.total_deleted_bases << " bp in " << stats.total_deletions << " read events" << endl;
         if(verbose) {
-            for(auto& id_and_edit : deletions) {
+            for(auto& id_and_edit : stats.deletions) {
                 cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.to_length()
                     << " on " << id_and_edit.first << endl;
             }
         }
-        cout << "Substitutions: " << total_substituted_bases << " bp in " << total_substitutions << " read events" << endl;
+        cout << "Substitutions: " << stats.total_substituted_bases << " bp in " << stats.total_substitutions << " read events" << endl;
         if(verbose) {
-            for(auto& id_and_edit : substitutions) {
+            for(auto& id_and_edit : stats.substitutions) {
                 cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.sequence()
                     << " on " << id_and_edit.first << endl;
             }
         }
-        cout << "Softclips: " << total_softclipped_bases << " bp in " << total_softclips << " read events" << endl;
+        cout << "Softclips: " << stats.total_softclipped_bases << " bp in " << stats.total_softclips << " read events" << endl;
         if(verbose) {
-            for(auto& id_and_edit : softclips) {
+            for(auto& id_and_edit : stats.softclips) {
                 cout << "\t" << id_and_edit.second.from_length() << " -> " << id_and_edit.second.sequence()
                     << " on " << id_and_edit.first << endl;
             }
@@ -735,6 +811,15 @@ int main_stats(int argc, char** argv) {
         }
         cout << endl;
 
+        if (show_distributions) {
+            for (size_t i = 0; i < AlignmentStats::DISTRIBUTION_COUNT; i++) {
+                cout << AlignmentStats::distribution_names[i] << " distribution:" << endl;
+                for (auto& value_and_count : stats.distributions[i]) {
+                    cout << "\t" << value_and_count.first << "\t" << value_and_count.second << endl;
+                }
+            }
+        }
+
 
     }
 
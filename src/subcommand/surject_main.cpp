@@ -37,7 +37,9 @@ void help_surject(char** argv) {
         << "    -b, --bam-output        write BAM to stdout" << endl
         << "    -s, --sam-output        write SAM to stdout" << endl
         << "    -C, --compression N     level for compression [0-9]" << endl
-        << "    -w, --window N          use N nodes on either side of the alignment to surject (default 5)" << endl;
+        << "    -w, --window N          use N nodes on either side of the alignment to surject (default 5)" << endl
+        << "    -R, --always-realign    realign every read, even those that already follow the path" << endl
+        << "    -v, --verbose           report how many reads were projected and how many realigned" << endl;
 }
 
 int main_surject(int argc, char** argv) {
@@ -58,6 +60,8 @@ int main_surject(int argc, char** argv) {
     int window = 5;
     string fasta_filename;
     int context_depth = 3;
+    bool always_realign = false;
+    bool verbose = false;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -78,11 +82,13 @@ int main_surject(int argc, char** argv) {
             {"compress", required_argument, 0, 'C'},
             {"window", required_argument, 0, 'w'},
             {"context-depth", required_argument, 0, 'n'},
+            {"always-realign", no_argument, 0, 'R'},
+            {"verbose", no_argument, 0, 'v'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:p:i:P:cbsH:C:t:w:f:n:",
+        c = getopt_long (argc, argv, "hx:p:i:P:cbsH:C:t:w:f:n:Rv",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -145,6 +151,14 @@ int main_surject(int argc, char** argv) {
             context_depth = atoi(optarg);
             break;
 
+        case 'R':
+            always_realign = true;
+            break;
+
+        case 'v':
+            verbose = true;
+            break;
+
         case 'h':
         case '?':
             help_surject(argv);
@@ -199,6 +213,7 @@ int main_surject(int argc, char** argv) {
     for (int i = 0; i < thread_count; ++i) {
         Mapper* m = new Mapper(xgidx, nullptr, nullptr);
         m->context_depth = context_depth;
+        m->fast_surject = !always_realign;
         mapper[i] = m;
     }
 
@@ -363,6 +378,22 @@ int main_surject(int argc, char** argv) {
         }
     }
     cout.flush();
+    
+    if (verbose) {
+        size_t projected = 0;
+        size_t realigned = 0;
+        for (Mapper* m : mapper) {
+            projected += m->surjections_projected;
+            realigned += m->surjections_realigned;
+        }
+        cerr << "[vg surject] " << projected << " alignments projected onto paths, "
+             << realigned << " realigned" << endl;
+    }
+    
+    for (Mapper* m : mapper) {
+        delete m;
+    }
+    delete xgidx;
 
     return 0;
 }
@@ -14,6 +14,8 @@
 
 #include "../vg.hpp"
 #include "../translator.hpp"
+#include "../stream.hpp"
+#include "../utility.hpp"
 
 using namespace std;
 using namespace vg;
@@ -29,7 +31,30 @@ void help_translate(char** argv) {
          << "    -l, --loci FILE       project the input locus descriptions into the from-graph" << endl
          << "    -m, --mapping JSON    print the from-mapping corresponding to the given JSON mapping" << endl
          << "    -P, --position JSON   print the from-position corresponding to the given JSON position" << endl
-         << "    -o, --overlay FILE    overlay this translation on top of the one we are given" << endl;
+         << "    -o, --overlay FILE    overlay this translation on top of the one we are given" << endl
+         << "    -t, --threads N       translate in parallel with N threads; output then comes in no particular order [1]" << endl;
+}
+
+// Translate everything in the file, writing the results to stdout from
+// per-thread buffers. In parallel, the results come out in no particular
+// order; otherwise they keep the input order.
+template<typename T>
+void translate_file(const string& filename, const function<T(const T&)>& translate, bool in_parallel) {
+    vector<vector<T>> buffers(get_thread_count());
+    function<void(T&)> lambda = [&](T& item) {
+        auto& buffer = buffers[omp_get_thread_num()];
+        buffer.push_back(translate(item));
+        stream::write_buffered(cout, buffer, 100);
+    };
+    ifstream in(filename);
+    if (in_parallel) {
+        stream::for_each_parallel(in, lambda);
+    } else {
+        stream::for_each(in, lambda);
+    }
+    for (auto& buffer : buffers) {
+        stream::write_buffered(cout, buffer, 0);
+    }
 }
 
 int main_translate(int argc, char** argv) {
@@ -45,6 +70,7 @@ int main_translate(int argc, char** argv) {
     string aln_file;
     string loci_file;
     string overlay_file;
+    int threads = 1;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -58,11 +84,12 @@ int main_translate(int argc, char** argv) {
             {"alns", required_argument, 0, 'a'},
             {"loci", required_argument, 0, 'l'},
             {"overlay", required_argument, 0, 'o'},
+            {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hp:m:P:a:o:l:",
+        c = getopt_long (argc, argv, "hp:m:P:a:o:l:t:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -95,6 +122,10 @@ int main_translate(int argc, char** argv) {
             overlay_file = optarg;
             break;
 
+        case 't':
+            threads = atoi(optarg);
+            break;
+
         case 'h':
         case '?':
             help_translate(argv);
@@ -106,6 +137,11 @@ int main_translate(int argc, char** argv) {
         }
     }
 
+    bool in_parallel = threads > 1;
+    if (in_parallel) {
+        omp_set_num_threads(threads);
+    }
+
     Translator* translator;
     get_input_file(optind, argc, argv, [&](istream& in) {
         translator = new Translator(in);
@@ -126,43 +162,23 @@ int main_translate(int argc, char** argv) {
     }
 
     if (!path_file.empty()) {
-        vector<Path> buffer;
-        function<void(Path&)> lambda = [&](Path& path) {
-            buffer.push_back(translator->translate(path));
-            stream::write_buffered(cout, buffer, 100);
-        };
-        ifstream path_in(path_file);
-        stream::for_each(path_in, lambda);
-        stream::write_buffered(cout, buffer, 0);
+        translate_file<Path>(path_file, [&](const Path& path) {
+                return translator->translate(path);
+            }, in_parallel);
     } else if (!aln_file.empty()) {
-        vector<Alignment> buffer;
-        function<void(Alignment&)> lambda = [&](Alignment& aln) {
-            buffer.push_back(translator->translate(aln));
-            stream::write_buffered(cout, buffer, 100);
-        };
-        ifstream aln_in(aln_file);
-        stream::for_each(aln_in, lambda);
-        stream::write_buffered(cout, buffer, 0);
+        translate_file<Alignment>(aln_file, [&](const Alignment& aln) {
+                return translator->translate(aln);
+            }, in_parallel);
     } else if (!loci_file.empty()) {
-        vector<Locus> buffer;
-        function<void(Locus&)> lambda = [&](Locus& locus) {
-            buffer.push_back(translator->translate(locus));
-            stream::write_buffered(cout, buffer, 100);
-        };
-        ifstream loci_in(loci_file);
-        stream::for_each(loci_in, lambda);
-        stream::write_buffered(cout, buffer, 0);
+        translate_file<Locus>(loci_file, [&](const Locus& locus) {
+                return translator->translate(locus);
+            }, in_parallel);
     }
 
     if (!overlay_file.empty()) {
-        vector<Translation> buffer;
-        function<void(Translation&)> lambda = [&](Translation& trans) {
-            buffer.push_back(translator->overlay(trans));
-            stream::write_buffered(cout, buffer, 100);
-        };
-        ifstream overlay_in(overlay_file);
-        stream::for_each(overlay_in, lambda);
-        stream::write_buffered(cout, buffer, 0);
+        translate_file<Translation>(overlay_file, [&](const Translation& trans) {
+                return translator->overlay(trans);
+            }, in_parallel);
     }
 
     return 0;
@@ -39,6 +39,8 @@ void help_vectorize(char** argv){
          << "  -p --mem-positions Add the positions to the MEM sketch of a given read based on the GCSA" << endl
          << "  -H --mem-hit-max N Ignore MEMs with this many hits when extracting poisitions" << endl
          << "  -i --identity-hot  Output a score vector based on percent identity and coverage" << endl
+         << "  -C --csr           Write the vectors (1-hot, a-hot, or identity-hot) as one binary CSR matrix" << endl
+         << "  -t --threads N     Vectorize alignments in parallel using N threads; rows then come out in no particular order [1]" << endl
          << endl;
 }
 
@@ -60,6 +62,8 @@ int main_vectorize(int argc, char** argv){
     bool mem_positions = false;
     bool mem_hit_max = 0;
     int max_mem_length = 0;
+    bool output_csr = false;
+    int threads = 1;
 
     if (argc <= 2) {
         help_vectorize(argv);
@@ -86,11 +90,12 @@ int main_vectorize(int argc, char** argv){
             {"identity-hot", no_argument, 0, 'i'},
             {"aln-label", required_argument, 0, 'l'},
             {"reads", required_argument, 0, 'r'},
+            {"csr", no_argument, 0, 'C'},
             {0, 0, 0, 0}
 
         };
         int option_index = 0;
-        c = getopt_long (argc, argv, "AaihwM:fmpx:g:l:H:",
+        c = getopt_long (argc, argv, "AaihwM:fmpx:g:l:H:Ct:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -173,6 +178,12 @@ int main_vectorize(int argc, char** argv){
         case 'M':
             wabbit_mapping_file = optarg;
             break;
+        case 'C':
+            output_csr = true;
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
         default:
             abort();
         }
@@ -218,33 +229,51 @@ int main_vectorize(int argc, char** argv){
         }
     }
 
+    if (output_csr && (mem_sketch || output_wabbit || format)) {
+        cerr << "[vg vectorize] error : CSR output can't be combined with -m, -w, -f, or -A" << endl;
+        return 1;
+    }
+
     Vectorizer vz(xg_index);
 
     //Generate a 1-hot coverage vector for graph entities.
-    function<void(Alignment&)> lambda = [&vz, &mapper, use_identity_hot, output_wabbit, aln_label, mem_sketch, mem_positions, format, a_hot, max_mem_length](Alignment& a){
+    // With -t, output goes out a whole line at a time, and the wabbit class
+    // map and CSR rows are shared, so all of that happens in the (cout)
+    // critical section; the vectorizing itself runs in parallel.
+    function<void(Alignment&)> lambda = [&vz, &mapper, use_identity_hot, output_wabbit, output_csr, aln_label, mem_sketch, mem_positions, format, a_hot, max_mem_length](Alignment& a){
         //vz.add_bv(vz.alignment_to_onehot(a));
         //vz.add_name(a.name());
-        if (a_hot) {
+        if (output_csr) {
+            vector<pair<size_t, double>> row = a_hot ? vz.alignment_to_sparse_a_hot(a) :
+                use_identity_hot ? vz.alignment_to_sparse_identity_hot(a) : vz.alignment_to_sparse_onehot(a);
+#pragma omp critical (cout)
+            vz.add_sparse_row(aln_label == "" ? a.name() : aln_label, row);
+        }
+        else if (a_hot) {
             vector<int> v = vz.alignment_to_a_hot(a);
             if (output_wabbit){
+#pragma omp critical (cout)
                 cout << vz.wabbitize(aln_label == "" ? a.name() : aln_label, v) << endl;
             }
             else if (format){
-                cout << a.name() << "\t" << vz.format(v) << endl;
+                string line = a.name() + "\t" + vz.format(v);
+#pragma omp critical (cout)
+                cout << line << endl;
             } else{
+#pragma omp critical (cout)
                 cout << v << endl;
             }
         }
         else if (use_identity_hot){
             vector<double> v = vz.alignment_to_identity_hot(a);
             if (output_wabbit){
+#pragma omp critical (cout)
                 cout << vz.wabbitize(aln_label == "" ? a.name() : aln_label, v) << endl;
             }
-            else if (format){
-                cout << a.name() << "\t" << vz.format(v) << endl;
-            }
             else {
-                cout << vz.format(v) << endl;
+                string line = format ? a.name() + "\t" + vz.format(v) : vz.format(v);
+#pragma omp critical (cout)
+                cout << line << endl;
             }
 
         } else if (mem_sketch) {
@@ -278,19 +307,34 @@ int main_vectorize(int argc, char** argv){
         } else {
             bit_vector v = vz.alignment_to_onehot(a);
             if (output_wabbit){
+#pragma omp critical (cout)
                 cout << vz.wabbitize(aln_label == "" ? a.name() : aln_label, v) << endl;
             } else if (format) {
-                cout << a.name() << "\t" << vz.format(v) << endl;
+                string line = a.name() + "\t" + vz.format(v);
+#pragma omp critical (cout)
+                cout << line << endl;
             } else{
+#pragma omp critical (cout)
                 cout << v << endl;
             }
         }
     };
     
     get_input_file(optind, argc, argv, [&](istream& in) {
-        stream::for_each(in, lambda);
+        if (threads > 1 && !mem_sketch) {
+            // MEM sketches write their output piece by piece, so they stay serial
+            omp_set_num_threads(threads);
+            stream::for_each_parallel(in, lambda);
+        } else {
+            // Unnamed rows can only be matched back to reads by their order
+            stream::for_each(in, lambda);
+        }
     });
 
+    if (output_csr) {
+        vz.emit_csr(cout);
+    }
+
     string mapping_str = vz.output_wabbit_map();
     if (output_wabbit){
         if (!wabbit_mapping_file.empty()){
@@ -415,9 +415,8 @@ int main_view(int argc, char** argv) {
     string file_name = get_input_file_name(optind, argc, argv);
     if (input_type == "vg") {
         if (output_type == "stream") {
-            function<void(Graph&)> lambda = [&](Graph& g) { cout << pb2json(g) << endl; };
             get_input_file(file_name, [&](istream& in) {
-                stream::for_each(in, lambda);
+                pb2json_stream<Graph>(in, cout);
             });
             return 0;
         } else {
@@ -456,10 +455,10 @@ int main_view(int argc, char** argv) {
                         // are out of spec, but they can be in files.
                         a.set_identity(0);
                     }
-                    cout << pb2json(a) << "\n";
                 };
+                // Convert in parallel, keeping the input order
                 get_input_file(file_name, [&](istream& in) {
-                    stream::for_each(in, lambda);
+                    pb2json_stream<Alignment>(in, cout, lambda);
                 });
             } else if (output_type == "fastq") {
                 function<void(Alignment&)> lambda = [](Alignment& a) {
@@ -25,36 +25,135 @@ void Translator::load(const vector<Translation>& trans) {
 }
 
 void Translator::build_position_table(void) {
-    //map<pos_t, Translation*> pos_to_trans;
-    for (auto& t : translations) {
-        // map from the new positions to the corresponding translations
-        pos_to_trans[make_pos_t(t.to().mapping(0).position())] = &t;
+    // Find where each translation starts in the to-graph, ordered by node,
+    // strand, and offset. When two translations start at the same position
+    // the later one wins.
+    vector<tuple<id_t, bool, size_t, uint32_t>> starts;
+    for (uint32_t i = 0; i < translations.size(); ++i) {
+        auto& t = translations[i];
+        if (!t.to().mapping_size()) continue;
+        auto& position = t.to().mapping(0).position();
+        starts.emplace_back(position.node_id(), position.is_reverse(), position.offset(), i);
+    }
+    std::stable_sort(starts.begin(), starts.end(),
+                     [](const tuple<id_t, bool, size_t, uint32_t>& a, const tuple<id_t, bool, size_t, uint32_t>& b) {
+                         return make_tuple(get<0>(a), get<1>(a), get<2>(a)) < make_tuple(get<0>(b), get<1>(b), get<2>(b));
+                     });
+
+    node_rank_dense.clear();
+    node_rank.clear();
+    interval_start.clear();
+    interval_offset.clear();
+    interval_translation.clear();
+
+    // Count the distinct nodes, to decide between the dense and hashed node
+    // ranks
+    size_t node_count = 0;
+    for (size_t i = 0; i < starts.size(); ++i) {
+        if (i == 0 || get<0>(starts[i]) != get<0>(starts[i - 1])) ++node_count;
+    }
+    min_node_id = starts.empty() ? 0 : get<0>(starts.front());
+    id_t max_node_id = starts.empty() ? 0 : get<0>(starts.back());
+    bool dense = !starts.empty() && (size_t)(max_node_id - min_node_id) < 16 * node_count;
+    if (dense) {
+        node_rank_dense.resize(max_node_id - min_node_id + 1, 0);
+    }
+
+    interval_start.reserve(2 * node_count + 1);
+    uint32_t rank = 0;
+    for (size_t i = 0; i < starts.size(); ++i) {
+        id_t node_id = get<0>(starts[i]);
+        bool is_reverse = get<1>(starts[i]);
+        if (i + 1 < starts.size() && node_id == get<0>(starts[i + 1])
+            && is_reverse == get<1>(starts[i + 1]) && get<2>(starts[i]) == get<2>(starts[i + 1])) {
+            // superseded by a later translation at the same position
+            continue;
+        }
+        if (interval_start.empty() || node_id != get<0>(starts[i - 1])) {
+            // first interval on a new node; close off the previous node
+            while (interval_start.size() < 2 * rank) {
+                interval_start.push_back(interval_offset.size());
+            }
+            ++rank;
+            if (dense) {
+                node_rank_dense[node_id - min_node_id] = rank;
+            } else {
+                node_rank[node_id] = rank;
+            }
+        }
+        // open the strands up to this one
+        while (interval_start.size() <= 2 * (rank - 1) + is_reverse) {
+            interval_start.push_back(interval_offset.size());
+        }
+        interval_offset.push_back(get<2>(starts[i]));
+        interval_translation.push_back(get<3>(starts[i]));
+    }
+    while (interval_start.size() < 2 * rank + 1) {
+        interval_start.push_back(interval_offset.size());
+    }
+
+    translation_is_match.resize(translations.size());
+    for (size_t i = 0; i < translations.size(); ++i) {
+        translation_is_match[i] = is_match(translations[i]);
     }
 }
 
-Translation Translator::get_translation(const Position& position) {
-    auto pos = make_pos_t(position);
-    // check that the node is in the translation
-    pos_t node_only = pos;
-    get_offset(node_only) = 0;
-    get_is_rev(node_only) = position.is_reverse();
-    Translation translation;
-    if (pos_to_trans.find(node_only) == pos_to_trans.end()) {
-        cerr << "WARNING: node " << id(pos) << " is not in the translation table" << endl;
+const Translation* Translator::find_translation(const Position& position) const {
+    uint32_t rank = 0;
+    if (!node_rank_dense.empty()) {
+        if (position.node_id() >= min_node_id
+            && position.node_id() - min_node_id < (id_t)node_rank_dense.size()) {
+            rank = node_rank_dense[position.node_id() - min_node_id];
+        }
     } else {
-        auto t = pos_to_trans.upper_bound(pos); --t;
-        translation = *t->second;
+        auto found = node_rank.find(position.node_id());
+        if (found != node_rank.end()) {
+            rank = found->second;
+        }
+    }
+    if (rank == 0) {
+        return nullptr;
+    }
+    size_t slot = 2 * (rank - 1) + position.is_reverse();
+    auto begin = interval_offset.begin() + interval_start[slot];
+    auto end = interval_offset.begin() + interval_start[slot + 1];
+    // the last interval starting at or before the offset
+    auto found = std::upper_bound(begin, end, (size_t)position.offset());
+    if (found == begin) {
+        return nullptr;
+    }
+    --found;
+    return &translations[interval_translation[found - interval_offset.begin()]];
+}
+
+const Translation* Translator::find_translation_or_warn(const Position& position) const {
+    const Translation* translation = find_translation(position);
+    if (translation == nullptr) {
+        cerr << "WARNING: node " << position.node_id() << " is not in the translation table" << endl;
     }
     return translation;
 }
 
+Translation Translator::get_translation(const Position& position) {
+    const Translation* translation = find_translation_or_warn(position);
+    return translation == nullptr ? Translation() : *translation;
+}
+
 Position Translator::translate(const Position& position) {
-    return translate(position, get_translation(position));
+    const Translation* translation = find_translation_or_warn(position);
+    if (translation == nullptr) {
+        return position;
+    }
+    return translate(position, *translation, translation_is_match[translation - translations.data()]);
 }
 
 Position Translator::translate(const Position& position, const Translation& translation) {
+    return translate(position, translation, is_match(translation));
+}
+
+Position Translator::translate(const Position& position, const Translation& translation, bool match) const {
     // what kind of translation is it?
-    if (is_match(translation)) {
+    if (match) {
         if (position.offset() >= mapping_from_length(translation.to().mapping(0))) {
             cerr << "ERROR: to-position offset is greater than translation length "
                  << mapping_from_length(translation.to().mapping(0)) << endl;
@@ -73,9 +172,12 @@ Position Translator::translate(const Position& position, const Translation& tran
 Mapping Translator::translate(const Mapping& mapping) {
     Mapping translated = mapping;
     if (!mapping.has_position()) return mapping;
-    Translation translation = get_translation(mapping.position());
-    *translated.mutable_position() = translate(mapping.position(), translation);
-    if (is_match(translation)) {
+    const Translation* found = find_translation_or_warn(mapping.position());
+    if (found == nullptr) return mapping;
+    const Translation& translation = *found;
+    bool match = translation_is_match[found - translations.data()];
+    *translated.mutable_position() = translate(mapping.position(), translation, match);
+    if (match) {
         return translated;
     } else {
         auto seq = translation.from().mapping(0).edit(0).sequence();
@@ -22,17 +22,23 @@ using namespace std;
 
 /**
  * Class to map paths into a base graph found via a set of Translations
+ *
+ * Translations are indexed by the node, strand, and offset where their to
+ * paths start, in flat per-node interval tables, so lookups don't go through
+ * an ordered map. A built Translator is safe to use from many threads.
  */
 class Translator {
 public:
 
     vector<Translation> translations;
-    map<pos_t, Translation*> pos_to_trans;
     Translator(void);
     Translator(istream& in);
     Translator(const vector<Translation>& trans);
     void load(const vector<Translation>& trans);
     void build_position_table(void);
+    /// Get the Translation whose to path covers the given position, or
+    /// nullptr if the position's node and strand aren't translated.
+    const Translation* find_translation(const Position& position) const;
     Translation get_translation(const Position& position);
     Position translate(const Position& position);
     Position translate(const Position& position, const Translation& translation);    
@@ -41,6 +47,29 @@ public:
     Alignment translate(const Alignment& aln);
     Locus translate(const Locus& locus);
     Translation overlay(const Translation& trans);
+
+private:
+    /// Get the Translation covering the position, warning if there is none
+    const Translation* find_translation_or_warn(const Position& position) const;
+    /// Translate a position we already have the covering Translation for
+    Position translate(const Position& position, const Translation& translation, bool match) const;
+
+    /// Smallest node ID with a translation
+    id_t min_node_id = 0;
+    /// Rank (plus 1) among the translated nodes of each node ID, counting
+    /// from min_node_id; 0 for untranslated nodes. Empty if the node IDs are
+    /// too sparse, in which case node_rank is used.
+    vector<uint32_t> node_rank_dense;
+    hash_map<id_t, uint32_t> node_rank;
+    /// The intervals for the node of rank r on strand s run from
+    /// interval_start[2 * r + s] up to interval_start[2 * r + s + 1]
+    vector<size_t> interval_start;
+    /// Offset on the node where each interval starts, ascending per strand
+    vector<size_t> interval_offset;
+    /// Index in translations of each interval's Translation
+    vector<uint32_t> interval_translation;
+    /// Whether each Translation is a simple match, computed once at load
+    vector<bool> translation_is_match;
 };
 
 bool is_match(const Translation& translation);
@@ -35,6 +35,10 @@ TEST_CASE("FeatureSet can load and save a BED record", "[featureset][simplify]")
     REQUIRE(loaded[0].feature_name == "record");
     REQUIRE(loaded[0].extra_data.size() == 0);
     
+    // Only the path with the record has features
+    REQUIRE(features.has_features("seq1"));
+    REQUIRE(!features.has_features("seq2"));
+    
     // Run through the save
     features.save_bed(out);
     
@@ -290,5 +290,51 @@ P	21	path12	3	+	1M)";
         REQUIRE(res.str().compare("1 5 6 12 7 9 11 8 10 4 19 13 16 18 14 17 15 2 22 28 23 25 27 24 26 20 35 29 32 34 30 33 31 21 3") == 0);
     }
 }
+
+TEST_CASE("fast linear sort puts a DAG in topological order", "[flow_sort]") {
+    const string graph_gfa = R"(H	VN:Z:0.1
+S	1	G
+L	1	+	2	+	0M
+L	1	+	4	+	0M
+S	2	T
+L	2	+	3	+	0M
+S	3	G
+S	4	C
+L	4	+	5	+	0M
+S	5	C
+L	5	+	2	+	0M
+L	5	+	6	+	0M
+S	6	T
+L	6	+	3	+	0M
+P	1	ref	1	+	1M
+P	2	ref	2	+	1M
+P	3	ref	3	+	1M
+P	1	path1	1	+	1M
+P	4	path1	2	+	1M
+P	5	path1	3	+	1M
+P	2	path1	4	+	1M)";
+
+    VG vg;
+    stringstream in(graph_gfa);
+    vg.from_gfa(in);
+
+    FlowSort flow_sort(vg);
+    flow_sort.fast_linear_sort("ref");
+
+    // Every node is placed exactly once
+    REQUIRE(vg.graph.node_size() == 6);
+    map<id_t, int> rank;
+    for (int i = 0; i < vg.graph.node_size(); ++i) {
+        rank[vg.graph.node(i).id()] = i;
+    }
+    REQUIRE(rank.size() == 6);
+
+    // And every edge points forward
+    for (int i = 0; i < vg.graph.edge_size(); ++i) {
+        const Edge& edge = vg.graph.edge(i);
+        REQUIRE(rank[edge.from()] < rank[edge.to()]);
+    }
+}
+
+}
 }
-}
\ No newline at end of file
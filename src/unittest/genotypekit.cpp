@@ -189,6 +189,74 @@ TEST_CASE("sites can be found with Cactus", "[genotype]") {
 
 }
 
+TEST_CASE("sites can be found with Cactus in each connected component", "[genotype]") {
+    
+    // Two copies of a simple bubble that don't touch each other
+    const string graph_json = R"(
+    
+    {
+        "node": [
+            {"id": 1, "sequence": "G"},
+            {"id": 2, "sequence": "A"},
+            {"id": 3, "sequence": "T"},
+            {"id": 4, "sequence": "GGG"},
+            {"id": 5, "sequence": "G"},
+            {"id": 6, "sequence": "A"},
+            {"id": 7, "sequence": "T"},
+            {"id": 8, "sequence": "GGG"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 1, "to": 3},
+            {"from": 2, "to": 4},
+            {"from": 3, "to": 4},
+            {"from": 5, "to": 6},
+            {"from": 5, "to": 7},
+            {"from": 6, "to": 8},
+            {"from": 7, "to": 8}
+        ]
+    }
+    
+    )";
+    
+    VG graph;
+    Graph chunk;
+    json2pb(chunk, graph_json.c_str(), graph_json.size());
+    graph.merge(chunk);
+    
+    CactusUltrabubbleFinder finder(graph);
+    
+    SECTION("find_snarls finds a top-level site in each component") {
+        SnarlManager manager = finder.find_snarls();
+        
+        auto sites = manager.top_level_snarls();
+        REQUIRE(sites.size() == 2);
+        
+        set<pair<id_t, id_t>> bounds;
+        for (const Snarl* site : sites) {
+            bounds.insert(make_pair(min(site->start().node_id(), site->end().node_id()),
+                                    max(site->start().node_id(), site->end().node_id())));
+            REQUIRE(manager.children_of(site).empty());
+        }
+        REQUIRE(bounds.count(make_pair(1, 4)));
+        REQUIRE(bounds.count(make_pair(5, 8)));
+    }
+    
+    SECTION("for_each_component_snarls reports each component once") {
+        set<size_t> seen_components;
+        size_t snarl_count = 0;
+        finder.for_each_component_snarls([&](size_t component_number, vector<Snarl>& snarls) {
+            REQUIRE(seen_components.count(component_number) == 0);
+            seen_components.insert(component_number);
+            REQUIRE(snarls.size() == 1);
+            snarl_count += snarls.size();
+        });
+        
+        REQUIRE(seen_components.size() == 2);
+        REQUIRE(snarl_count == 2);
+    }
+}
+
 TEST_CASE("fixed priors can be assigned to genotypes", "[genotype]") {
     
     GenotypePriorCalculator* calculator = new FixedGenotypePriorCalculator();
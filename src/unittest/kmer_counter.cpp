@@ -0,0 +1,107 @@
+/** \file
+ * unittest/kmer_counter.cpp: tests for counting k-mers in bounded memory
+ */
+
+#include "catch.hpp"
+#include "../kmer_counter.hpp"
+
+#include <map>
+
+namespace vg
+{
+namespace unittest
+{
+
+TEST_CASE("KmerCounter counts k-mers added from many threads", "[kmers]") {
+
+    // ACG occurs at offsets 0, 4 and 10, CGT at 1 and 5, and TAC at 3 and 9,
+    // with every other 3-mer occurring once.
+    string sequence = "ACGTACGTTTACG";
+    size_t copies = 100;
+
+    // A budget this small makes every thread spill many times
+    KmerCounter counter(3, 64, 4);
+
+#pragma omp parallel for
+    for (size_t copy = 0; copy < copies; copy++) {
+        for (size_t i = 0; i + 3 <= sequence.size(); i++) {
+            counter.add(sequence.substr(i, 3), copy + 1, i);
+        }
+    }
+
+    SECTION("All occurrences are counted at their lowest position") {
+        map<string, KmerCount> counts;
+        counter.for_each_count([&](const KmerCount& count) {
+            REQUIRE(counts.count(count.kmer) == 0);
+            counts[count.kmer] = count;
+        });
+
+        REQUIRE(counts.size() == 7);
+        REQUIRE(counts["ACG"].count == 3 * copies);
+        REQUIRE(counts["ACG"].node_id == 1);
+        REQUIRE(counts["ACG"].offset == 0);
+        REQUIRE(counts["TAC"].count == 2 * copies);
+        REQUIRE(counts["TAC"].offset == 3);
+        REQUIRE(counts["TTA"].count == copies);
+    }
+
+    SECTION("K-mers below the minimum count are not reported") {
+        vector<string> frequent;
+        counter.for_each_count([&](const KmerCount& count) {
+            frequent.push_back(count.kmer);
+        }, 2 * copies);
+
+        sort(frequent.begin(), frequent.end());
+        REQUIRE(frequent == vector<string>({"ACG", "CGT", "TAC"}));
+    }
+}
+
+TEST_CASE("KmerCounter splits partitions too big to count within its budget", "[kmers]") {
+
+    // Many distinct k-mers, all in one partition, with a budget that can only
+    // hold a few of them at once
+    KmerCounter counter(4, 2048, 1);
+    string bases = "ACGT";
+    size_t expected_total = 0;
+    for (size_t i = 0; i < 256; i++) {
+        string kmer;
+        for (size_t j = 0, code = i; j < 4; j++, code /= 4) {
+            kmer.push_back(bases[code % 4]);
+        }
+        for (size_t copy = 0; copy <= i % 3; copy++) {
+            counter.add(kmer, i + 1, copy);
+            expected_total++;
+        }
+    }
+
+    size_t distinct = 0;
+    size_t total = 0;
+    counter.for_each_count([&](const KmerCount& count) {
+        distinct++;
+        total += count.count;
+        REQUIRE(count.offset == 0);
+    });
+    REQUIRE(distinct == 256);
+    REQUIRE(total == expected_total);
+}
+
+TEST_CASE("KmerCounter finds the lowest position on either strand", "[kmers]") {
+
+    KmerCounter counter(3, 1024, 2);
+    counter.add("ACG", 5, 2);
+    counter.add("ACG", -3, -4);
+    counter.add("ACG", 3, 4);
+    counter.add("ACG", -3, -1);
+
+    vector<KmerCount> counts;
+    counter.for_each_count([&](const KmerCount& count) {
+        counts.push_back(count);
+    });
+    REQUIRE(counts.size() == 1);
+    REQUIRE(counts[0].count == 4);
+    REQUIRE(counts[0].node_id == -3);
+    REQUIRE(counts[0].offset == -1);
+}
+
+}
+}
@@ -296,6 +296,233 @@ TEST_CASE( "Mapper finds optimal mapping for read starting with node-border MEM"
     
 }
 
+TEST_CASE( "FragmentLengthStatistics can be saved and loaded", "[mapping][mapper]" ) {
+    
+    FragmentLengthStatistics saved;
+    saved.fixed_fragment_model = false;
+    saved.fragment_model_update_interval = 1;
+    for (int i = 0; i < 20; i++) {
+        saved.fragment_lengths.push_front(200 + i);
+        saved.fragment_orientations.push_front(false);
+        saved.fragment_directions.push_front(true);
+    }
+    saved.update_cached_model();
+    
+    stringstream model;
+    saved.save_fragment_model(model);
+    
+    FragmentLengthStatistics loaded;
+    REQUIRE(loaded.load_fragment_model(model));
+    REQUIRE(loaded.fragment_model_str() == saved.fragment_model_str());
+    REQUIRE(loaded.fragment_lengths == saved.fragment_lengths);
+    REQUIRE(loaded.fragment_orientations == saved.fragment_orientations);
+    REQUIRE(loaded.fragment_directions == saved.fragment_directions);
+    
+    SECTION( "Pooling models only pools the pairs each one recorded itself" ) {
+        FragmentLengthStatistics pooled = loaded;
+        pooled.merge(loaded);
+        REQUIRE(pooled.fragment_lengths == saved.fragment_lengths);
+        
+        FragmentLengthStatistics other = loaded;
+        other.fragment_lengths.push_front(500);
+        other.fragment_orientations.push_front(false);
+        other.fragment_directions.push_front(true);
+        other.recorded_fragments = 1;
+        pooled.merge(other);
+        REQUIRE(pooled.fragment_lengths.size() == saved.fragment_lengths.size() + 1);
+        REQUIRE(pooled.fragment_lengths.back() == 500);
+    }
+    
+    stringstream garbage("not a model\n");
+    REQUIRE(!loaded.load_fragment_model(garbage));
+}
+
+TEST_CASE( "Surjection projects reads already on the path the same way realignment does", "[mapping][mapper][surject]" ) {
+    
+    string graph_json = R"({
+        "node": [
+            {"id": 1, "sequence": "GATTACA"},
+            {"id": 2, "sequence": "CATTAG"},
+            {"id": 3, "sequence": "GGGCCC"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 2, "to": 3}
+        ],
+        "path": [
+            {"name": "ref", "mapping": [
+                {"position": {"node_id": 1}, "edit": [{"from_length": 7, "to_length": 7}]},
+                {"position": {"node_id": 2}, "edit": [{"from_length": 6, "to_length": 6}]},
+                {"position": {"node_id": 3}, "edit": [{"from_length": 6, "to_length": 6}]}
+            ]},
+            {"name": "alt", "mapping": [
+                {"position": {"node_id": 3}, "edit": [{"from_length": 6, "to_length": 6}]}
+            ]}
+        ]
+    })";
+    
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    xg::XG xg_index(proto_graph);
+    
+    // We never need to find seeds, so we can get away without a GCSA
+    Mapper mapper(&xg_index, nullptr, nullptr);
+    
+    // A read along the whole path with a mismatch in the middle node, carrying
+    // a score and identity from some other graph
+    string read_json = R"({
+        "name": "read",
+        "sequence": "TTACACAGTAGGGGC",
+        "score": 0,
+        "identity": 0.5,
+        "path": {"mapping": [
+            {"position": {"node_id": 1, "offset": 2}, "edit": [{"from_length": 5, "to_length": 5}]},
+            {"position": {"node_id": 2}, "edit": [
+                {"from_length": 2, "to_length": 2},
+                {"from_length": 1, "to_length": 1, "sequence": "G"},
+                {"from_length": 3, "to_length": 3}
+            ]},
+            {"position": {"node_id": 3}, "edit": [{"from_length": 4, "to_length": 4}]}
+        ]}
+    })";
+    Alignment read;
+    json2pb(read, read_json.c_str(), read_json.size());
+    
+    SECTION( "Projection and realignment agree on the score, identity and path position" ) {
+        set<string> path_names{"ref"};
+        
+        string fast_name, slow_name;
+        int64_t fast_pos = -1, slow_pos = -1;
+        bool fast_reverse = true, slow_reverse = true;
+        
+        mapper.fast_surject = true;
+        Alignment fast = mapper.surject_alignment(read, path_names, fast_name, fast_pos, fast_reverse, 5);
+        REQUIRE(mapper.surjections_projected == 1);
+        REQUIRE(mapper.surjections_realigned == 0);
+        
+        mapper.fast_surject = false;
+        Alignment slow = mapper.surject_alignment(read, path_names, slow_name, slow_pos, slow_reverse, 5);
+        REQUIRE(mapper.surjections_realigned == 1);
+        
+        REQUIRE(fast_name == "ref");
+        REQUIRE(fast_name == slow_name);
+        REQUIRE(fast_pos == 2);
+        REQUIRE(fast_pos == slow_pos);
+        REQUIRE(fast_reverse == slow_reverse);
+        
+        REQUIRE(fast.score() == slow.score());
+        REQUIRE(fast.score() > 0);
+        REQUIRE(fast.identity() == Approx(slow.identity()));
+        REQUIRE(fast.identity() == Approx(14.0 / 15.0));
+        
+        REQUIRE(fast.path().mapping_size() == slow.path().mapping_size());
+        for (size_t i = 0; i < fast.path().mapping_size(); i++) {
+            REQUIRE(fast.path().mapping(i).position().node_id() == slow.path().mapping(i).position().node_id());
+            REQUIRE(fast.path().mapping(i).position().offset() == slow.path().mapping(i).position().offset());
+            REQUIRE(fast.path().mapping(i).position().is_reverse() == slow.path().mapping(i).position().is_reverse());
+        }
+    }
+    
+    SECTION( "Projection is not used when another target path touches a later node of the read" ) {
+        set<string> path_names{"ref", "alt"};
+        
+        string path_name;
+        int64_t path_pos = -1;
+        bool path_reverse = false;
+        
+        mapper.fast_surject = true;
+        mapper.surject_alignment(read, path_names, path_name, path_pos, path_reverse, 5);
+        REQUIRE(mapper.surjections_projected == 0);
+        REQUIRE(mapper.surjections_realigned == 1);
+    }
+}
+
+TEST_CASE( "Batched pair rescue rescues the same mates as rescuing each pair on its own", "[mapping][mapper][rescue]" ) {
+    
+    // A 1 kbp linear graph with a made up but fixed sequence
+    string ref;
+    uint32_t state = 12345;
+    for (size_t i = 0; i < 1000; i++) {
+        state = state * 1103515245 + 12345;
+        ref.push_back("ACGT"[(state >> 16) % 4]);
+    }
+    VG graph;
+    graph.create_node(ref);
+    graph.dice_nodes(32);
+    graph.sort();
+    graph.compact_ids();
+    xg::XG xg_index(graph.graph);
+    
+    // Rescue never needs to find seeds, so we can get away without a GCSA
+    Mapper mapper(&xg_index, nullptr, nullptr);
+    // Fragments of about 300 bp, with the mates facing each other
+    mapper.frag_stats.fragment_size = 1000;
+    mapper.frag_stats.cached_fragment_length_mean = 300;
+    mapper.frag_stats.cached_fragment_length_stdev = 10;
+    mapper.frag_stats.cached_fragment_orientation = false;
+    mapper.frag_stats.cached_fragment_direction = true;
+    
+    // Make a forward read aligned perfectly at the given offset
+    auto aligned_read = [&](const string& name, size_t start) {
+        Alignment aln;
+        aln.set_name(name);
+        aln.set_sequence(ref.substr(start, 50));
+        aln = mapper.align_maybe_flip(aln, graph.graph, false, true);
+        aln.set_name(name);
+        return aln;
+    };
+    // Make an unaligned read of the reverse strand at the given offset
+    auto unaligned_read = [&](const string& name, size_t start) {
+        Alignment aln;
+        aln.set_name(name);
+        aln.set_sequence(reverse_complement(ref.substr(start, 50)));
+        return aln;
+    };
+    
+    pair<Alignment, Alignment> lost(aligned_read("a", 100), unaligned_read("b", 350));
+    // The same read pair with the second mate aligned badly somewhere else
+    pair<Alignment, Alignment> misplaced = lost;
+    misplaced.second = aligned_read("b", 800);
+    misplaced.second.set_sequence(lost.second.sequence());
+    misplaced.second.set_score(10);
+    misplaced.second.set_identity(0.2);
+    // A different read pair aiming for the same place
+    pair<Alignment, Alignment> other(aligned_read("c", 120), unaligned_read("d", 370));
+    
+    REQUIRE(lost.first.score() > 0);
+    
+    vector<pair<Alignment, Alignment>> alone{lost, misplaced, other};
+    for (auto& p : alone) {
+        REQUIRE(mapper.pair_rescue(p.first, p.second, 1, true));
+    }
+    
+    SECTION( "Rescued mates land where they came from" ) {
+        for (auto& p : alone) {
+            REQUIRE(p.second.score() > 50);
+            REQUIRE(p.second.path().mapping_size() > 0);
+            REQUIRE(p.second.path().mapping(0).position().is_reverse());
+        }
+    }
+    
+    SECTION( "A batch of pairs of the same and different reads rescues each the same way" ) {
+        vector<pair<Alignment, Alignment>> batched{lost, misplaced, other};
+        vector<pair<Alignment, Alignment>*> batch;
+        for (auto& p : batched) {
+            batch.push_back(&p);
+        }
+        REQUIRE(mapper.pair_rescue_batch(batch, 1, true));
+        for (size_t i = 0; i < alone.size(); i++) {
+            REQUIRE(pb2json(batched[i].first) == pb2json(alone[i].first));
+            REQUIRE(pb2json(batched[i].second) == pb2json(alone[i].second));
+        }
+    }
+    
+    SECTION( "A batch leaves pairs that don't need rescuing alone" ) {
+        vector<pair<Alignment, Alignment>*> batch{&alone[0]};
+        REQUIRE(!mapper.pair_rescue_batch(batch, 1, true));
+    }
+}
+
 }
 
 }
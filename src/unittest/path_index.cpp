@@ -360,7 +360,54 @@ TEST_CASE("PathIndex translation can divide the last node", "[pathindex]") {
     }
     
 }
-   
+
+TEST_CASE("CompactPathIndex answers position and node queries on an XG path", "[pathindex]") {
+    
+    // Load the graph
+    Graph graph;
+    json2pb(graph, path_index_graph_1.c_str(), path_index_graph_1.size());
+    
+    xg::XG xg_index(graph);
+    
+    CompactPathIndex index(xg_index, "cool", true);
+    
+    SECTION("CompactPathIndex has the right string") {
+        REQUIRE(index.sequence() == "GAGGGTAAACACA");
+        REQUIRE(index.path_length() == 13);
+        REQUIRE(index.size() == 7);
+    }
+    
+    SECTION("CompactPathIndex finds the node at each position") {
+        REQUIRE(index.at_position(0) == NodeSide(1, false));
+        REQUIRE(index.at_position(3) == NodeSide(4, false));
+        REQUIRE(index.at_position(12) == NodeSide(9, false));
+        REQUIRE(index.occurrence_at(13) == index.size());
+        
+        size_t occurrence = index.occurrence_at(9);
+        REQUIRE(index.occurrence_start(occurrence) == 8);
+        REQUIRE(index.occurrence_length(occurrence) == 5);
+    }
+    
+    SECTION("CompactPathIndex finds where each node is") {
+        REQUIRE(index.path_contains_node(5));
+        REQUIRE(!index.path_contains_node(3));
+        REQUIRE(index.first_position(9) == 8);
+        REQUIRE(index.node_positions(4) == vector<size_t>{2});
+        REQUIRE(index.node_positions(7).empty());
+    }
+    
+    SECTION("CompactPathIndex rounds ranges out to node boundaries") {
+        REQUIRE(index.round_outward(3, 6) == make_pair((size_t) 2, (size_t) 6));
+        REQUIRE(index.round_outward(9, 10) == make_pair((size_t) 8, (size_t) 13));
+    }
+    
+    SECTION("CompactPathIndex keeps rounded ranges on the path") {
+        REQUIRE(index.round_outward(9, 20) == make_pair((size_t) 8, (size_t) 13));
+        REQUIRE(index.round_outward(13, 13) == make_pair((size_t) 13, (size_t) 13));
+        REQUIRE(index.round_outward(15, 20) == make_pair((size_t) 13, (size_t) 13));
+    }
+}
+
 }
 }
         
@@ -705,5 +705,91 @@ namespace vg {
                 
             }  
         }
+        
+        TEST_CASE( "SnarlManager can be serialized and loaded",
+                  "[sites][bubbles][snarls]" ) {
+            
+            VG graph;
+            
+            Node* n1 = graph.create_node("GCA");
+            Node* n2 = graph.create_node("T");
+            Node* n3 = graph.create_node("G");
+            Node* n4 = graph.create_node("CTGA");
+            Node* n5 = graph.create_node("GCA");
+            Node* n6 = graph.create_node("T");
+            Node* n7 = graph.create_node("G");
+            Node* n8 = graph.create_node("CTGA");
+            
+            graph.create_edge(n1, n2);
+            graph.create_edge(n1, n8);
+            graph.create_edge(n2, n3);
+            graph.create_edge(n2, n6);
+            graph.create_edge(n3, n4);
+            graph.create_edge(n3, n5);
+            graph.create_edge(n4, n5);
+            graph.create_edge(n5, n7);
+            graph.create_edge(n6, n7);
+            graph.create_edge(n7, n8);
+            
+            CactusUltrabubbleFinder bubble_finder(graph, "");
+            SnarlManager snarl_manager = bubble_finder.find_snarls();
+            
+            stringstream serialized;
+            size_t bytes = snarl_manager.serialize(serialized);
+            REQUIRE(bytes == serialized.str().size());
+            
+            SnarlManager loaded;
+            loaded.load(serialized);
+            
+            SECTION( "The loaded tree has the same shape") {
+                REQUIRE(loaded.top_level_snarls().size() == 1);
+                const Snarl* top = loaded.top_level_snarls()[0];
+                REQUIRE(*top == *snarl_manager.top_level_snarls()[0]);
+                REQUIRE(loaded.is_root(top));
+                
+                auto middle = loaded.children_of(top);
+                REQUIRE(middle.size() == 1);
+                REQUIRE(loaded.parent_of(middle[0]) == top);
+                
+                auto bottom = loaded.children_of(middle[0]);
+                REQUIRE(bottom.size() == 1);
+                REQUIRE(loaded.is_leaf(bottom[0]));
+                REQUIRE(loaded.parent_of(bottom[0]) == middle[0]);
+                REQUIRE(*bottom[0] == *snarl_manager.children_of(snarl_manager.children_of(snarl_manager.top_level_snarls()[0])[0])[0]);
+            }
+            
+            SECTION( "The loaded boundary index finds the same snarls") {
+                for (id_t id = 1; id <= 8; id++) {
+                    for (bool reverse : {false, true}) {
+                        const Snarl* original = snarl_manager.into_which_snarl(id, reverse);
+                        const Snarl* reloaded = loaded.into_which_snarl(id, reverse);
+                        REQUIRE((original == nullptr) == (reloaded == nullptr));
+                        if (original != nullptr) {
+                            REQUIRE(*original == *reloaded);
+                        }
+                    }
+                }
+            }
+            
+            SECTION( "Content iteration visits the same nodes and edges as deep_contents") {
+                const Snarl* top = loaded.top_level_snarls()[0];
+                auto contents = loaded.deep_contents(top, graph, true);
+                
+                size_t node_visits = 0;
+                size_t edge_visits = 0;
+                loaded.for_each_deep_content(top, graph, true, [&](Node* node) {
+                    REQUIRE(contents.first.count(node));
+                    node_visits++;
+                }, [&](Edge* edge) {
+                    REQUIRE(contents.second.count(edge));
+                    edge_visits++;
+                });
+                
+                REQUIRE(node_visits == 8);
+                REQUIRE(node_visits == contents.first.size());
+                REQUIRE(edge_visits == 10);
+                REQUIRE(edge_visits == contents.second.size());
+            }
+        }
     }
 }
@@ -0,0 +1,81 @@
+/** \file
+ * unittest/srpe.cpp: tests for the structural variant caller's read depth map
+ */
+
+#include "catch.hpp"
+#include "srpe.hpp"
+#include "../json2pb.h"
+
+namespace vg
+{
+namespace unittest
+{
+
+TEST_CASE("DepthMap counts aligned bases on both strands", "[srpe][depth]") {
+    
+    VG graph;
+    Node* n1 = graph.create_node("GATT");
+    Node* n2 = graph.create_node("ACA");
+    graph.create_edge(n1, n2);
+    
+    DepthMap depth(&graph);
+    REQUIRE(depth.size() == 7);
+    
+    // A read over the last two bases of node 1 and the first two of node 2,
+    // with a mismatch and then a deletion
+    const string forward_json = R"(
+        {"mapping": [
+            {"position": {"node_id": 1, "offset": 2}, "edit": [{"from_length": 2, "to_length": 2}]},
+            {"position": {"node_id": 2}, "edit": [{"from_length": 1, "to_length": 1, "sequence": "G"}, {"from_length": 1}, {"from_length": 1, "to_length": 1}]}
+        ]}
+    )";
+    Path forward;
+    json2pb(forward, forward_json.c_str(), forward_json.size());
+    
+    // The same first node bases, read on the reverse strand
+    const string reverse_json = R"(
+        {"mapping": [
+            {"position": {"node_id": 1, "offset": 0, "is_reverse": true}, "edit": [{"from_length": 2, "to_length": 2}]}
+        ]}
+    )";
+    Path reverse;
+    json2pb(reverse, reverse_json.c_str(), reverse_json.size());
+    
+    depth.fill_depth(forward);
+    depth.fill_depth(reverse);
+    
+    SECTION("Matches and mismatches are counted but deletions are not") {
+        REQUIRE(depth.get_depth(1, 0) == 0);
+        REQUIRE(depth.get_depth(1, 1) == 0);
+        REQUIRE(depth.get_depth(1, 2) == 2);
+        REQUIRE(depth.get_depth(1, 3) == 2);
+        REQUIRE(depth.get_depth(2, 0) == 1);
+        REQUIRE(depth.get_depth(2, 1) == 0);
+        REQUIRE(depth.get_depth(2, 2) == 1);
+    }
+    
+    SECTION("Windowed depth follows the path") {
+        Path ref;
+        Mapping* m = ref.add_mapping();
+        m->mutable_position()->set_node_id(1);
+        m = ref.add_mapping();
+        m->mutable_position()->set_node_id(2);
+        
+        vector<double> windows = depth.windowed_depth(ref, 4);
+        REQUIRE(windows.size() == 2);
+        REQUIRE(windows[0] == 1.0);
+        REQUIRE(windows[1] == Approx(2.0 / 3.0));
+        
+        REQUIRE(depth.mean_depth(1, 2, 4) == 2.0);
+    }
+    
+    SECTION("Counters saturate instead of wrapping") {
+        depth.set_depth(2, 1, numeric_limits<uint16_t>::max() - 1);
+        depth.increment_depth(2, 1);
+        depth.increment_depth(2, 1);
+        REQUIRE(depth.get_depth(2, 1) == numeric_limits<uint16_t>::max());
+    }
+}
+
+}
+}
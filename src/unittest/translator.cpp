@@ -0,0 +1,91 @@
+/** \file
+ * unittest/translator.cpp: tests for projecting positions through graph translations
+ */
+
+#include "catch.hpp"
+#include "translator.hpp"
+#include "../json2pb.h"
+
+namespace vg
+{
+namespace unittest
+{
+
+// Make a Translation for a perfect match of the given length
+static Translation match_translation(id_t from_id, bool from_rev, size_t from_offset,
+                                     id_t to_id, bool to_rev, size_t length) {
+    Translation trans;
+    Mapping* from_mapping = trans.mutable_from()->add_mapping();
+    *from_mapping->mutable_position() = make_position(from_id, from_rev, from_offset);
+    Edit* from_edit = from_mapping->add_edit();
+    from_edit->set_from_length(length);
+    from_edit->set_to_length(length);
+    Mapping* to_mapping = trans.mutable_to()->add_mapping();
+    *to_mapping->mutable_position() = make_position(to_id, to_rev, 0);
+    Edit* to_edit = to_mapping->add_edit();
+    to_edit->set_from_length(length);
+    to_edit->set_to_length(length);
+    return trans;
+}
+
+TEST_CASE("Translator finds the translation covering a position", "[translator]") {
+
+    // Node 1 (GATTACA) was divided into 2 (GAT) and 3 (TACA), and node 4 (5
+    // bp) was kept.
+    vector<Translation> translations {
+        match_translation(1, false, 0, 2, false, 3),
+        match_translation(1, false, 3, 3, false, 4),
+        match_translation(4, false, 0, 4, false, 5),
+        match_translation(1, true, 4, 2, true, 3),
+        match_translation(1, true, 0, 3, true, 4)
+    };
+    Translator translator(translations);
+
+    SECTION("Forward positions project onto the old node") {
+        Position translated = translator.translate(make_position(3, false, 2));
+        REQUIRE(translated.node_id() == 1);
+        REQUIRE(!translated.is_reverse());
+        REQUIRE(translated.offset() == 5);
+    }
+
+    SECTION("Reverse positions project onto the old node's reverse strand") {
+        Position translated = translator.translate(make_position(2, true, 1));
+        REQUIRE(translated.node_id() == 1);
+        REQUIRE(translated.is_reverse());
+        REQUIRE(translated.offset() == 5);
+    }
+
+    SECTION("Untranslated nodes have no translation") {
+        REQUIRE(translator.find_translation(make_position(9, false, 0)) == nullptr);
+        REQUIRE(translator.find_translation(make_position(4, true, 0)) == nullptr);
+    }
+
+    SECTION("Mappings translate with their edits intact") {
+        Mapping mapping;
+        *mapping.mutable_position() = make_position(4, false, 1);
+        Edit* edit = mapping.add_edit();
+        edit->set_from_length(3);
+        edit->set_to_length(3);
+        Mapping translated = translator.translate(mapping);
+        REQUIRE(translated.position().node_id() == 4);
+        REQUIRE(translated.position().offset() == 1);
+        REQUIRE(mapping_from_length(translated) == 3);
+    }
+}
+
+TEST_CASE("Translator handles sparse node IDs", "[translator]") {
+
+    vector<Translation> translations {
+        match_translation(10, false, 0, 5, false, 4),
+        match_translation(10, false, 4, 5000000, false, 6)
+    };
+    Translator translator(translations);
+
+    Position translated = translator.translate(make_position(5000000, false, 3));
+    REQUIRE(translated.node_id() == 10);
+    REQUIRE(translated.offset() == 7);
+    REQUIRE(translator.find_translation(make_position(6, false, 0)) == nullptr);
+}
+
+}
+}
@@ -444,4 +444,125 @@ TEST_CASE("Target to alignment extraction", "[xg-target-to-aln]") {
         }
     }
 
+TEST_CASE("Batch thread insertion into a DAG gives the right gPBWT", "[xg][gpbwt]") {
+
+    string graph_json = R"(
+    {"node":[{"id":1,"sequence":"G"},
+    {"id":2,"sequence":"A"},
+    {"id":3,"sequence":"T"},
+    {"id":4,"sequence":"GGG"},
+    {"id":5,"sequence":"T"},
+    {"id":6,"sequence":"A"}],
+    "edge":[{"from":1,"to":2},
+    {"from":1,"to":6},
+    {"from":2,"to":3},
+    {"from":2,"to":4},
+    {"from":3,"to":5},
+    {"from":4,"to":5},
+    {"from":5,"to":6}]}
+    )";
+
+    // Load the JSON
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+
+    // Build the xg index
+    xg::XG xg_index(proto_graph);
+    
+    vector<xg::XG::thread_t> threads {
+        {{1, false}, {2, false}, {3, false}, {5, false}, {6, false}},
+        {{1, false}, {2, false}, {4, false}, {5, false}},
+        {{2, false}, {3, false}, {5, false}},
+        {{1, false}, {6, false}},
+        {{1, false}, {2, false}, {3, false}, {5, false}, {6, false}}
+    };
+    xg_index.insert_threads_into_dag(threads, {"a", "b", "c", "d", "e"});
+    
+    SECTION("Whole threads are found as often as they were inserted") {
+        REQUIRE(xg_index.count_matches(threads[0]) == 2);
+        REQUIRE(xg_index.count_matches(threads[1]) == 1);
+        REQUIRE(xg_index.count_matches(threads[3]) == 1);
+    }
+    
+    SECTION("Subthreads are found in every thread containing them") {
+        REQUIRE(xg_index.count_matches(threads[2]) == 3);
+        REQUIRE(xg_index.count_matches(xg::XG::thread_t{{5, false}, {6, false}}) == 2);
+        REQUIRE(xg_index.count_matches(xg::XG::thread_t{{1, false}, {2, false}}) == 3);
+        REQUIRE(xg_index.count_matches(xg::XG::thread_t{{1, false}, {6, false}}) == 1);
+    }
+    
+    SECTION("Threads are found in reverse") {
+        REQUIRE(xg_index.count_matches(xg::XG::thread_t{{5, true}, {3, true}, {2, true}}) == 3);
+        REQUIRE(xg_index.count_matches(xg::XG::thread_t{{6, true}, {1, true}}) == 1);
+    }
+    
+    SECTION("Paths not taken by any thread are not found") {
+        REQUIRE(xg_index.count_matches(xg::XG::thread_t{{4, false}, {5, false}, {6, false}}) == 0);
+        REQUIRE(xg_index.count_matches(xg::XG::thread_t{{2, false}, {4, false}, {5, false}, {6, false}}) == 0);
+    }
+    
+    SECTION("Batched queries agree with one-at-a-time queries") {
+        vector<xg::XG::thread_t> queries {
+            {{1, false}, {2, false}, {3, false}, {5, false}, {6, false}},
+            {{1, false}, {2, false}},
+            {{1, false}, {2, false}, {4, false}},
+            {{4, false}, {5, false}, {6, false}},
+            {{1, false}, {2, false}, {3, false}},
+            {{5, true}, {3, true}, {2, true}},
+            {{1, false}, {2, false}, {4, false}, {5, false}, {6, false}},
+            {{1, false}, {2, false}}
+        };
+        
+        vector<size_t> counts = xg_index.count_matches(queries);
+        REQUIRE(counts.size() == queries.size());
+        for (size_t i = 0; i < queries.size(); i++) {
+            REQUIRE(counts[i] == xg_index.count_matches(queries[i]));
+        }
+    }
+    
+    SECTION("Paths split within a node count as one visit, and paths revisiting a node do not") {
+        // An alignment through 1, 2, 4 and 5, with node 4 split across two mappings
+        Path split;
+        for (auto& visit : vector<vector<int64_t>>{{1, 0, 1}, {2, 0, 1}, {4, 0, 1}, {4, 1, 2}, {5, 0, 1}}) {
+            Mapping* mapping = split.add_mapping();
+            mapping->mutable_position()->set_node_id(visit[0]);
+            mapping->mutable_position()->set_offset(visit[1]);
+            Edit* edit = mapping->add_edit();
+            edit->set_from_length(visit[2]);
+            edit->set_to_length(visit[2]);
+        }
+        
+        // A path through 1, then 2 twice, as whole-node mappings
+        Path revisit;
+        for (int64_t id : {1, 2, 2, 3}) {
+            Mapping* mapping = revisit.add_mapping();
+            mapping->mutable_position()->set_node_id(id);
+        }
+        
+        auto split_thread = xg::XG::path_to_thread(split);
+        REQUIRE(split_thread.size() == 4);
+        REQUIRE(split_thread[2].node_id == 4);
+        REQUIRE(split_thread[3].node_id == 5);
+        REQUIRE(xg::XG::path_to_thread(revisit).size() == 4);
+        
+        vector<size_t> counts = xg_index.count_matches(vector<Path>{split, revisit});
+        REQUIRE(counts.size() == 2);
+        REQUIRE(counts[0] == 1);
+        REQUIRE(counts[1] == 0);
+        REQUIRE(xg_index.count_matches(split) == counts[0]);
+        REQUIRE(xg_index.count_matches(revisit) == counts[1]);
+    }
+    
+    SECTION("Threads can be extracted again") {
+        auto extracted = xg_index.extract_threads(false);
+        size_t total = 0;
+        for (auto& named : extracted) {
+            total += named.second.size();
+        }
+        REQUIRE(total == threads.size());
+    }
+
+}
+
+
 }
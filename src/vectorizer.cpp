@@ -1,4 +1,5 @@
 #include "vectorizer.hpp"
+#include <algorithm>
 
 using namespace std;
 using namespace vg;
@@ -70,150 +71,168 @@ void Vectorizer::add_name(string n){
 
 
 
-vector<int> Vectorizer::alignment_to_a_hot(Alignment a){
-    int64_t entity_size = my_xg->node_count + my_xg->edge_count;
-    vector<int> ret(entity_size, 0);
-    Path path = a.path();
+size_t Vectorizer::entity_count(){
+    return my_xg->node_count + my_xg->edge_count;
+}
+
+void Vectorizer::finish_sparse(vector<pair<size_t, double>>& entries){
+    // stable, so later entries for the same index stay after earlier ones
+    std::stable_sort(entries.begin(), entries.end(), [](const pair<size_t, double>& x, const pair<size_t, double>& y){
+        return x.first < y.first;
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); i++){
+        if (i + 1 < entries.size() && entries[i + 1].first == entries[i].first){
+            // overwritten later
+            continue;
+        }
+        if (entries[i].second != 0.0){
+            entries[kept++] = entries[i];
+        }
+    }
+    entries.resize(kept);
+}
+
+vector<pair<size_t, double>> Vectorizer::alignment_to_sparse_a_hot(const Alignment& a){
+    vector<pair<size_t, double>> ret;
+    const Path& path = a.path();
     for (int i = 0; i < path.mapping_size(); i++){
-        Mapping mapping = path.mapping(i);
+        const Mapping& mapping = path.mapping(i);
         if(! mapping.has_position()){
             continue;
         }
-        Position pos = mapping.position();
-        int64_t node_id = pos.node_id();
+        int64_t node_id = mapping.position().node_id();
+        // Entities are indexed from 1
         int64_t key = my_xg->node_rank_as_entity(node_id);
-        // Okay, solved the previous out of range errors:
-        // We have to use an entity-space that is |nodes + edges + 1|
-        // as nodes are indexed from 1, not from 0.
-        //TODO: this means we may one day have to do the same bump up
-        // by one for edges, as I assume they are also indexed starting at 1.
-        //cerr << key << " - " << entity_size << endl;
 
         //Find edge by current / previous node ID
         // we can check the orientation, though it shouldn't **really** matter
         // whether we catch them in the forward or reverse direction.
         if (i > 0){
-            Mapping prev_mapping = path.mapping(i - 1);
-            Position prev_pos = prev_mapping.position();
-            int64_t prev_node_id = prev_pos.node_id();
+            int64_t prev_node_id = path.mapping(i - 1).position().node_id();
             if (my_xg->has_edge(prev_node_id, false, node_id, false)){
                 int64_t edge_key = my_xg->edge_rank_as_entity(prev_node_id, false, node_id, false);
                 vector<size_t> edge_paths = my_xg->paths_of_entity(edge_key);
-                if (edge_paths.size() > 0){
-                    ret[edge_key - 1] = 1;
-                }
-                else{
-                    ret[edge_key - 1] = 2;
-                }
+                ret.push_back(make_pair(edge_key - 1, edge_paths.size() > 0 ? 1.0 : 2.0));
             }
         }
         //Check if the node of interest is on a path
         vector<size_t> node_paths = my_xg->paths_of_node(node_id);
-        if (node_paths.size() > 0){
-            ret[key - 1] = 2;
-        }
-        else{
-            ret[key - 1] = 1;
-        }
-
+        ret.push_back(make_pair(key - 1, node_paths.size() > 0 ? 2.0 : 1.0));
     }
-
+    finish_sparse(ret);
     return ret;
-
 }
 
-vector<double> Vectorizer::alignment_to_identity_hot(Alignment a){
-    int64_t entity_size = my_xg->node_count + my_xg->edge_count;
-    vector<double> ret(entity_size, 0.0);
-
-    Path path = a.path();
+vector<pair<size_t, double>> Vectorizer::alignment_to_sparse_identity_hot(const Alignment& a){
+    vector<pair<size_t, double>> ret;
+    const Path& path = a.path();
     for (int i = 0; i < path.mapping_size(); i ++){
-        Mapping mapping = path.mapping(i);
+        const Mapping& mapping = path.mapping(i);
         if(! mapping.has_position()){
             continue;
         }
-        Position pos = mapping.position();
-        int64_t node_id = pos.node_id();
+        int64_t node_id = mapping.position().node_id();
         int64_t key = my_xg->node_rank_as_entity(node_id);
 
         //Calculate % identity by walking the edits and counting matches.
-        double pct_id = 0.0;
         double match_len = 0.0;
         double total_len = 0.0;
-
         for (int j = 0; j < mapping.edit_size(); j++){
-            Edit e = mapping.edit(j);
+            const Edit& e = mapping.edit(j);
             total_len += e.from_length();
             if (e.from_length() == e.to_length() && e.sequence() == ""){
                 match_len += (double) e.to_length();
             }
-            else if (e.from_length() == e.to_length() && e.sequence() != ""){
-                // TODO if we map but don't match exactly, add half the average length to match_length
-                //match_len += (double) (0.5 * ((double) e.to_length()));
-            }
-            else{
-                
-            }
-            
+            // TODO if we map but don't match exactly, add half the average length to match_length
         }
-        pct_id = (match_len == 0.0 && total_len == 0.0) ? 0.0 : (match_len / total_len);
-        ret[key - 1] = pct_id;
+        double pct_id = (match_len == 0.0 && total_len == 0.0) ? 0.0 : (match_len / total_len);
+        ret.push_back(make_pair(key - 1, pct_id));
 
         if (i > 0){
-            Mapping prev_mapping = path.mapping(i - 1);
-            Position prev_pos = prev_mapping.position();
-            int64_t prev_node_id = prev_pos.node_id();
+            int64_t prev_node_id = path.mapping(i - 1).position().node_id();
             if (my_xg->has_edge(prev_node_id, false, node_id, false)){
                 int64_t edge_key = my_xg->edge_rank_as_entity(prev_node_id, false, node_id, false);
-                ret[edge_key - 1] = 1.0;
+                ret.push_back(make_pair(edge_key - 1, 1.0));
             }
         }
     }
+    finish_sparse(ret);
     return ret;
 }
 
-bit_vector Vectorizer::alignment_to_onehot(Alignment a){
-    // Make a vector as large as the | |nodes| + |edges| | space
-    // TODO handle edges
-    int64_t entity_size = my_xg->node_count + my_xg->edge_count;
-    bit_vector ret(entity_size, 0);
-    Path path = a.path();
+vector<pair<size_t, double>> Vectorizer::alignment_to_sparse_onehot(const Alignment& a){
+    vector<pair<size_t, double>> ret;
+    const Path& path = a.path();
     for (int i = 0; i < path.mapping_size(); i++){
-        Mapping mapping = path.mapping(i);
+        const Mapping& mapping = path.mapping(i);
         if(! mapping.has_position()){
             continue;
         }
-
-        Position pos = mapping.position();
-        int64_t node_id = pos.node_id();
+        int64_t node_id = mapping.position().node_id();
         int64_t key = my_xg->node_rank_as_entity(node_id);
-        // Okay, solved the previous out of range errors:
-        // We have to use an entity-space that is |nodes + edges + 1|
-        // as nodes are indexed from 1, not from 0.
-        //TODO: this means we may one day have to do the same bump up
-        // by one for edges, as I assume they are also indexed starting at 1.
-        //cerr << key << " - " << entity_size << endl;
 
-        //Find edge by current / previous node ID
-        // we can check the orientation, though it shouldn't **really** matter
-        // whether we catch them in the forward or reverse direction.
         if (i > 0){
-            Mapping prev_mapping = path.mapping(i - 1);
-            Position prev_pos = prev_mapping.position();
-            int64_t prev_node_id = prev_pos.node_id();
+            int64_t prev_node_id = path.mapping(i - 1).position().node_id();
             if (my_xg->has_edge(prev_node_id, false, node_id, false)){
                 int64_t edge_key = my_xg->edge_rank_as_entity(prev_node_id, false, node_id, false);
-                ret[edge_key - 1] = 1;
+                ret.push_back(make_pair(edge_key - 1, 1.0));
             }
         }
-        //Find entity rank of edge
+        ret.push_back(make_pair(key - 1, 1.0));
+    }
+    finish_sparse(ret);
+    return ret;
+}
 
-        ret[key - 1] = 1;
+vector<int> Vectorizer::alignment_to_a_hot(Alignment a){
+    vector<int> ret(entity_count(), 0);
+    for (auto& entry : alignment_to_sparse_a_hot(a)){
+        ret[entry.first] = (int) entry.second;
     }
+    return ret;
+}
 
+vector<double> Vectorizer::alignment_to_identity_hot(Alignment a){
+    vector<double> ret(entity_count(), 0.0);
+    for (auto& entry : alignment_to_sparse_identity_hot(a)){
+        ret[entry.first] = entry.second;
+    }
     return ret;
 }
 
+bit_vector Vectorizer::alignment_to_onehot(Alignment a){
+    // Make a vector as large as the | |nodes| + |edges| | space
+    bit_vector ret(entity_count(), 0);
+    for (auto& entry : alignment_to_sparse_onehot(a)){
+        ret[entry.first] = 1;
+    }
+    return ret;
+}
+
+void Vectorizer::add_sparse_row(const string& name, const vector<pair<size_t, double>>& row){
+    for (auto& entry : row){
+        csr_indices.push_back(entry.first);
+        csr_data.push_back(entry.second);
+    }
+    csr_indptr.push_back(csr_indices.size());
+    csr_names.push_back(name);
+}
+
+void Vectorizer::emit_csr(ostream& out){
+    out.write("vgcsr001", 8);
+    uint64_t dims[3] = {csr_names.size(), entity_count(), csr_indices.size()};
+    out.write((const char*) dims, sizeof(dims));
+    out.write((const char*) csr_indptr.data(), csr_indptr.size() * sizeof(uint64_t));
+    out.write((const char*) csr_indices.data(), csr_indices.size() * sizeof(uint32_t));
+    out.write((const char*) csr_data.data(), csr_data.size() * sizeof(float));
+    for (auto& name : csr_names){
+        uint32_t length = name.size();
+        out.write((const char*) &length, sizeof(length));
+        out.write(name.data(), length);
+    }
+}
+
 vector<double> Vectorizer::alignment_to_custom_score(Alignment a, std::function<double(Alignment)> lambda ){
     vector<double> ret;
     
@@ -32,6 +32,32 @@ class Vectorizer{
     vector<double> alignment_to_custom_score(Alignment a, std::function<double(Alignment)> lambda);
     vector<double> alignment_to_identity_hot(Alignment a);
     string output_wabbit_map();
+
+    /**
+    * Sparse versions of the above: only the nonzero entries, as
+    * (entity index, value) pairs sorted by index. Cost depends on the
+    * length of the alignment rather than on the size of the graph.
+    */
+    vector<pair<size_t, double>> alignment_to_sparse_onehot(const Alignment& a);
+    vector<pair<size_t, double>> alignment_to_sparse_a_hot(const Alignment& a);
+    vector<pair<size_t, double>> alignment_to_sparse_identity_hot(const Alignment& a);
+
+    /// Number of entries in a dense vector (nodes + edges)
+    size_t entity_count();
+
+    /// Save a sparse row and its name for emit_csr. Not thread safe.
+    void add_sparse_row(const string& name, const vector<pair<size_t, double>>& row);
+
+    /**
+    * Write the saved rows as a binary CSR matrix, all in host byte order:
+    *   char[8]  magic "vgcsr001"
+    *   uint64   rows, columns, nonzeros
+    *   uint64   indptr[rows + 1]
+    *   uint32   indices[nonzeros]
+    *   float32  data[nonzeros]
+    *   rows x (uint32 length, char[length] name)
+    */
+    void emit_csr(ostream& out);
     template<typename T> string format(T v){
         stringstream sout;
         for (int i = 0; i < v.size(); i++){
@@ -68,6 +94,16 @@ class Vectorizer{
     //bool output_wabbit = false;
     unordered_map<string, int> wabbit_map;
 
+    // rows saved up for CSR output
+    vector<uint64_t> csr_indptr{0};
+    vector<uint32_t> csr_indices;
+    vector<float> csr_data;
+    vector<string> csr_names;
+
+    // Sort sparse entries by index, keeping the last value set for each
+    // index like writing into a dense vector would, and drop zeros
+    void finish_sparse(vector<pair<size_t, double>>& entries);
+
 };
 
 #endif
@@ -4731,6 +4731,111 @@ vector<Translation> VG::edit(const vector<Path>& paths_to_add) {
     // Rebuild path ranks, aux mapping, etc. by compacting the path ranks
     paths.compact_ranks();
 
+    ensure_path_edges();
+
+    // execute a semi partial order sort on the nodes
+    sort();
+
+    // make the translation
+    return make_translation(node_translation, added_nodes, orig_node_sizes);
+}
+
+void VG::edit(const string& gam_filename,
+              const function<void(Translation&)>& translation_callback,
+              bool save_paths) {
+
+    // First pass: collect the breakpoints. Each thread keeps its own buffer
+    // of breakpoint positions, which it sorts and deduplicates whenever it
+    // doubles in size, so the buffers stay proportional to the number of
+    // distinct breakpoints rather than the number of alignments.
+    vector<vector<pos_t>> thread_breakpoints;
+    vector<size_t> compact_at;
+#pragma omp parallel
+    {
+#pragma omp single
+        {
+            thread_breakpoints.resize(omp_get_num_threads());
+            compact_at.resize(omp_get_num_threads(), 1 << 16);
+        }
+    }
+    auto compact = [](vector<pos_t>& buffer) {
+        std::sort(buffer.begin(), buffer.end());
+        buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+    };
+
+    {
+        ifstream in(gam_filename);
+        if (!in) {
+            cerr << "[vg] error: could not open alignments in " << gam_filename << endl;
+            exit(1);
+        }
+        function<void(Alignment&)> lambda = [&](Alignment& aln) {
+            int tid = omp_get_thread_num();
+            auto& buffer = thread_breakpoints[tid];
+            map<id_t, set<pos_t>> breakpoints;
+            find_breakpoints(simplify(aln.path()), breakpoints);
+            for (auto& node_breakpoints : breakpoints) {
+                buffer.insert(buffer.end(), node_breakpoints.second.begin(), node_breakpoints.second.end());
+            }
+            if (buffer.size() >= compact_at[tid]) {
+                compact(buffer);
+                compact_at[tid] = max(compact_at[tid], 2 * buffer.size());
+            }
+        };
+        stream::for_each_parallel(in, lambda);
+    }
+
+    // Merge the per-thread buffers, freeing each as we go
+    map<id_t, set<pos_t>> breakpoints;
+    for (auto& buffer : thread_breakpoints) {
+        compact(buffer);
+        for (auto& pos : buffer) {
+            breakpoints[id(pos)].insert(pos);
+        }
+        vector<pos_t>().swap(buffer);
+    }
+    breakpoints = forwardize_breakpoints(breakpoints);
+
+    paths.clear_mapping_ranks();
+
+    map<id_t, size_t> orig_node_sizes;
+    for_each_node([&](Node* node) {
+            orig_node_sizes[node->id()] = node->sequence().size();
+        });
+
+    // Divide every node that needs it in one pass
+    auto node_translation = ensure_breakpoints(breakpoints);
+    breakpoints.clear();
+
+    // Second pass: add the novel sequence and edges. This modifies the graph,
+    // so it runs in file order, which also keeps the new node IDs stable.
+    map<pair<pos_t, string>, vector<Node*>> added_seqs;
+    map<Node*, Path> added_nodes;
+    {
+        ifstream in(gam_filename);
+        function<void(Alignment&)> lambda = [&](Alignment& aln) {
+            Path path = simplify(aln.path());
+            if (save_paths) {
+                path.set_name(aln.name());
+            } else {
+                path.clear_name();
+            }
+            add_nodes_and_edges(path, node_translation, added_seqs, added_nodes, orig_node_sizes);
+        };
+        stream::for_each(in, lambda);
+    }
+    added_seqs.clear();
+
+    paths.compact_ranks();
+
+    ensure_path_edges();
+
+    sort();
+
+    for_each_translation(node_translation, added_nodes, orig_node_sizes, translation_callback);
+}
+
+void VG::ensure_path_edges(void) {
     // something is off about this check.
     // with the paths sorted, let's double-check that the edges are here
     paths.for_each([&](const Path& path) {
@@ -4748,12 +4853,6 @@ vector<Translation> VG::edit(const vector<Path>& paths_to_add) {
                 }
             }
         });
-
-    // execute a semi partial order sort on the nodes
-    sort();
-
-    // make the translation
-    return make_translation(node_translation, added_nodes, orig_node_sizes);
 }
 
 // The not quite as robust but actually efficient way to edit the graph.
@@ -4846,6 +4945,17 @@ vector<Translation> VG::make_translation(const map<pos_t, Node*>& node_translati
                                          const map<Node*, Path>& added_nodes,
                                          const map<id_t, size_t>& orig_node_sizes) {
     vector<Translation> translation;
+    for_each_translation(node_translation, added_nodes, orig_node_sizes, [&](Translation& trans) {
+            translation.push_back(trans);
+        });
+    return translation;
+}
+
+void VG::for_each_translation(const map<pos_t, Node*>& node_translation,
+                              const map<Node*, Path>& added_nodes,
+                              const map<id_t, size_t>& orig_node_sizes,
+                              const function<void(Translation&)>& lambda) {
+    vector<Translation> translation;
     // invert the translation
     map<Node*, pos_t> inv_node_trans;
     for (auto& t : node_translation) {
@@ -4918,8 +5028,10 @@ vector<Translation> VG::make_translation(const map<pos_t, Node*>& node_translati
                           < make_pos_t(t2.from().mapping(0).position());
                   }
               });
-    // append the reverse complement of the translation
-    vector<Translation> reverse_translation;
+    for (auto& trans : translation) {
+        lambda(trans);
+    }
+    // follow with the reverse complement of the translation
     auto get_curr_node_length = [&](id_t id) {
         return get_node(id)->sequence().size();
     };
@@ -4932,13 +5044,11 @@ vector<Translation> VG::make_translation(const map<pos_t, Node*>& node_translati
         return f->second;
     };
     for (auto& trans : translation) {
-        reverse_translation.emplace_back();
-        auto& rev_trans = reverse_translation.back();
+        Translation rev_trans;
         *rev_trans.mutable_to() = simplify(reverse_complement_path(trans.to(), get_curr_node_length));
         *rev_trans.mutable_from() = simplify(reverse_complement_path(trans.from(), get_orig_node_length));
+        lambda(rev_trans);
     }
-    translation.insert(translation.end(), reverse_translation.begin(), reverse_translation.end());
-    return translation;
 }
 
 map<id_t, set<pos_t>> VG::forwardize_breakpoints(const map<id_t, set<pos_t>>& breakpoints) {
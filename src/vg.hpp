@@ -449,7 +449,24 @@ public:
     /// this method sorts the graph and rebuilds the path index, so it should
     /// not be called in a loop.
     vector<Translation> edit(const vector<Path>& paths);
+
+    /// %Edit the graph to include the paths of all the alignments in a GAM
+    /// file, without holding the alignments in memory. The file is read twice:
+    /// first in parallel to collect breakpoints into per-thread sorted
+    /// buffers, which are merged so every node is divided in one pass; then
+    /// serially to add the novel sequences and edges, deduplicated as in
+    /// edit(). If save_paths is set, each alignment's path is embedded under
+    /// its read name. The Translations (same contents as edit() returns) are
+    /// passed to the callback one at a time instead of being collected. Like
+    /// edit(), this sorts the graph.
+    void edit(const string& gam_filename,
+              const function<void(Translation&)>& translation_callback,
+              bool save_paths = true);
     
+    /// Create any edges that are missing between consecutive mappings of the
+    /// graph's paths.
+    void ensure_path_edges(void);
+
     /// %Edit the graph to include all the sequences and edges added by the
     /// given path. Returns a vector of Translations, one per original-node
     /// fragment. Completely novel nodes are not mentioned, and nodes with no
@@ -514,6 +531,13 @@ public:
     vector<Translation> make_translation(const map<pos_t, Node*>& node_translation,
                                          const map<Node*, Path>& added_nodes,
                                          const map<id_t, size_t>& orig_node_sizes);
+    /// Produce the same Translations as make_translation, passing each to the
+    /// callback instead of collecting them; the reverse strand Translations
+    /// are made as they are emitted.
+    void for_each_translation(const map<pos_t, Node*>& node_translation,
+                              const map<Node*, Path>& added_nodes,
+                              const map<id_t, size_t>& orig_node_sizes,
+                              const function<void(Translation&)>& lambda);
 
     /// Add in the given node, by value.
     void add_node(const Node& node);
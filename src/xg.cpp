@@ -1871,6 +1871,14 @@ Path XG::path(const string& name) const {
     
 }
 
+void XG::for_each_path_visit(const string& name, const function<void(int64_t id, bool is_reverse)>& lambda) const {
+    const XGPath& xgpath = *(paths[path_rank(name)-1]);
+    size_t total_nodes = xgpath.ids.size();
+    for (size_t i = 0; i < total_nodes; i++) {
+        lambda(xgpath.ids[i], xgpath.directions[i]);
+    }
+}
+
 size_t XG::path_rank(const string& name) const {
     // find the name in the csa
     string query = start_marker + name + end_marker;
@@ -3096,14 +3104,66 @@ void XG::insert_threads_into_dag(const vector<thread_t>& t, const vector<string>
     int_vector<> tio_iv(t.size()*2+2);
     int thread_count = 0;
     
-    auto emit_destinations = [&](int64_t node_id, bool is_reverse, vector<size_t> destinations) {
+    size_t node_ranks = max_node_rank();
+    
+    // Count the visits to each node, in parallel over threads. Since all the
+    // threads run the same way through a node, the B_s arrays for both of its
+    // sides will hold exactly this many entries (one side gets the forward
+    // visits and the other the reverse ones), which lets us lay out the final
+    // concatenated B_s array before we know what goes into it.
+    vector<size_t> node_visit_count(node_ranks + 1, 0);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < t.size(); i++) {
+        for (auto& mapping : t[i]) {
+            size_t node_rank = id_to_rank(mapping.node_id);
+#pragma omp atomic update
+            node_visit_count[node_rank]++;
+        }
+    }
+    
+#if GPBWT_MODE == MODE_SDSL
+    // Work out where the separator in front of each node's first side goes.
+    // The array starts with a separator for sides 0 and 1, and then each side
+    // is its separator followed by its visits.
+    vector<size_t> node_bs_start(node_ranks + 1, 0);
+    size_t total_visits = 1;
+    for (size_t node_rank = 1; node_rank <= node_ranks; node_rank++) {
+        node_bs_start[node_rank] = total_visits;
+        total_visits += 2 * (1 + node_visit_count[node_rank]);
+    }
+    
+#ifdef VERBOSE_DEBUG
+    cerr << "Allocating giant B_s array of " << total_visits << " bytes..." << endl;
+#endif
+    // We fill this in place instead of going through per-side B_s arrays.
+    string all_bs_arrays(total_visits, 0);
+    all_bs_arrays[0] = BS_SEPARATOR;
+    for (size_t node_rank = 1; node_rank <= node_ranks; node_rank++) {
+        all_bs_arrays[node_bs_start[node_rank]] = BS_SEPARATOR;
+        all_bs_arrays[node_bs_start[node_rank] + 1 + node_visit_count[node_rank]] = BS_SEPARATOR;
+    }
+    
+    // We don't need the per-side arrays at all.
+    vector<string>().swap(bs_arrays);
+#endif
+    
+    auto emit_destinations = [&](int64_t node_id, size_t node_rank, bool is_reverse, const vector<destination_t>& destinations) {
         // We have to take this destination vector and store it in whatever B_s
         // storage we are using.
         
-        int64_t node_side = id_to_rank(node_id) * 2 + is_reverse;
+        assert(destinations.size() == node_visit_count[node_rank]);
         
+#if GPBWT_MODE == MODE_SDSL
+        // Copy all the destinations right into their final place, after the
+        // separator for this side.
+        size_t pos = node_bs_start[node_rank] + (is_reverse ? 1 + destinations.size() : 0) + 1;
+        for (auto& destination : destinations) {
+            all_bs_arrays[pos++] = destination;
+        }
+#elif GPBWT_MODE == MODE_DYNAMIC
         // Copy all the destinations into the succinct B_s storage
-        bs_set(node_side, destinations);
+        bs_set(node_rank * 2 + is_reverse, destinations);
+#endif
         
         // Set the number of total visits to this side.
         h_iv[(node_rank_as_entity(node_id) - 1) * 2 + is_reverse] = destinations.size();
@@ -3113,27 +3173,6 @@ void XG::insert_threads_into_dag(const vector<thread_t>& t, const vector<string>
 #endif
     };
     
-    auto emit_edge_traversal = [&](int64_t node_id, bool from_start, int64_t next_node_id, bool to_end) {
-        // We have to store the fact that we traversed this edge in the specified direction in our succinct storage. 
-        
-        // Find the edge as it actually appears in the graph.
-        Edge canonical = canonicalize(make_edge(node_id, from_start, next_node_id, to_end));
-        
-        // We're departing along this edge, so our orientation cares about
-        // whether we have to take the edge forward or backward when departing.
-        auto edge_rank = edge_rank_as_entity(canonical);
-        assert(edge_rank != numeric_limits<size_t>::max()); // We must actually have the edge
-        int64_t edge_orientation_number = (edge_rank - 1) * 2 +
-            depart_by_reverse(canonical, node_id, from_start);
-                
-#ifdef VERBOSE_DEBUG
-        cerr << "We need to add 1 to the traversals of oriented edge " << edge_orientation_number << endl;
-#endif
-                
-        // Increment the count for the edge
-        h_iv[edge_orientation_number]++; 
-    };
-    
     auto emit_thread_start = [&](int64_t node_id, bool is_reverse) {
         // Record that an (orientation of) a thread starts at this node in this
         // orientation. We have to update our thread start succinct data
@@ -3153,6 +3192,32 @@ void XG::insert_threads_into_dag(const vector<thread_t>& t, const vector<string>
 #endif
         
     };
+    
+    // A visit is a thread number and a mapping index in the thread.
+    using visit_t = pair<size_t, size_t>;
+    
+    // This is what we need to know about an edge we can leave a side by, so
+    // that the sweep below never has to go back to the edge storage.
+    struct departure_t {
+        int64_t next_id;
+        bool next_is_reverse;
+        size_t edge_rank;
+        size_t edge_orientation_number;
+    };
+    
+    // This is what we need to know about the edges of a node. Visits arriving
+    // along edges are ordered by the order of those edges in edges_of(), and
+    // visits leaving get numbered by their departure's index on their side.
+    struct node_edges_t {
+        vector<size_t> incident_edge_ranks;
+        // Indexed by whether we depart from the start (i.e. the node is visited
+        // in reverse).
+        vector<departure_t> departures[2];
+    };
+    
+    // How many nodes should we look up edges for at once, in parallel, ahead
+    // of the sweep?
+    const size_t EDGE_TABLE_BLOCK_SIZE = 65536;
 
     // We want to go through and insert running forward through the DAG, and
     // then again backward through the DAG.
@@ -3160,7 +3225,7 @@ void XG::insert_threads_into_dag(const vector<thread_t>& t, const vector<string>
 
         // First sort out the thread numbers by the node they start at.
         // We know all the threads go the same direction through each node.
-        map<int64_t, list<size_t>> thread_numbers_by_start_node;
+        map<int64_t, vector<size_t>> thread_numbers_by_start_node;
         
         for(size_t i = 0; i < t.size(); i++) {
             if(t[i].size() > 0) {
@@ -3181,141 +3246,197 @@ void XG::insert_threads_into_dag(const vector<thread_t>& t, const vector<string>
         }
         
         // We have this message-passing architecture, where we send groups of
-        // threads along edges to destination nodes. This records, by edge rank of
-        // the traversed edge (with 0 meaning starting there), the group of threads
-        // coming in along that edge, and the offset in each thread that the visit
-        // to the node is at. These are messages passed along the edge from the
-        // earlier node to the later node (since we know threads follow a DAG).
-        map<size_t, list<pair<size_t, size_t>>> edge_to_ordered_threads;
+        // threads along edges to destination nodes. This records, by rank of
+        // the destination node, the visits coming in to it and the rank of the
+        // edge each came in on, in the order they were sent (which is the order
+        // of the visits at the earlier node, since we know threads follow a
+        // DAG).
+        unordered_map<size_t, vector<pair<size_t, visit_t>>> arrivals_by_node_rank;
         
-        for(size_t node_rank = (insert_reverse ? max_node_rank() : 1);
-            node_rank != (insert_reverse ? 0 : max_node_rank() + 1);
-            node_rank += (insert_reverse ? -1 : 1)) {
-            // Then we start at the first node in the DAG
-            
-            int64_t node_id = rank_to_id(node_rank);
-            
-#ifdef VERBOSE_DEBUG
-            if(node_id % 10000 == 1) {
-                cerr << "Processing node " << node_id << endl;
-            }
-#endif
-            
-            // We order the thread visits starting there, and then all the threads
-            // coming in from other places, ordered by edge traversed.
-            // Stores a pair of thread number and mapping index in the thread.
-            list<pair<size_t, size_t>> threads_visiting;
+        // Scratch space for each node we sweep through.
+        vector<visit_t> threads_visiting;
+        vector<destination_t> destinations;
+        
+        for (size_t block_start = 0; block_start < node_ranks; block_start += EDGE_TABLE_BLOCK_SIZE) {
+            size_t block_end = min(node_ranks, block_start + EDGE_TABLE_BLOCK_SIZE);
             
-            if(thread_numbers_by_start_node.count(node_id)) {
-                // Grab the threads starting here
-                for(size_t thread_number : thread_numbers_by_start_node.at(node_id)) {
-                    // For every thread that starts here, say it visits here
-                    // with its first mapping (0 for forward inserts, last one
-                    // for reverse inserts).
-                    threads_visiting.emplace_back(thread_number, insert_reverse ? t[thread_number].size() - 1 : 0);
+            // Get the edges for all the visited nodes in the block in parallel.
+            // This is where all the expensive queries against the edge storage
+            // happen.
+            vector<node_edges_t> block_edges(block_end - block_start);
+#pragma omp parallel for schedule(dynamic, 256)
+            for (size_t i = block_start; i < block_end; i++) {
+                size_t node_rank = insert_reverse ? node_ranks - i : i + 1;
+                if (node_visit_count[node_rank] == 0) {
+                    // Nothing will ever need these edges.
+                    continue;
                 }
-                thread_numbers_by_start_node.erase(node_id);
-            }
-            
-            
-            for(Edge& in_edge : edges_of(node_id)) {
-                // Look at all the edges on the node. Messages will only exist on
-                // the incoming ones.
-                auto edge_rank = edge_rank_as_entity(in_edge);
-                if(edge_to_ordered_threads.count(edge_rank)) {
-                    // We have messages coming along this edge on our start
+                int64_t node_id = rank_to_id(node_rank);
+                auto& node_edges = block_edges[i - block_start];
+                
+                for (Edge& edge : edges_of(node_id)) {
+                    size_t edge_rank = edge_rank_as_entity(edge);
+                    node_edges.incident_edge_ranks.push_back(edge_rank);
                     
-                    // These threads come in next. Splice them in because they
-                    // already have the right mapping indices.
-                    threads_visiting.splice(threads_visiting.end(), edge_to_ordered_threads[edge_rank]);
-                    edge_to_ordered_threads.erase(edge_rank);
+                    for (bool departs_start : {false, true}) {
+                        // Is the edge on this side? This is the same test as
+                        // edges_on_start() and edges_on_end() use, so we keep
+                        // their order.
+                        bool on_side = departs_start ?
+                            ((edge.to() == node_id && !edge.to_end()) || (edge.from() == node_id && edge.from_start())) :
+                            ((edge.to() == node_id && edge.to_end()) || (edge.from() == node_id && !edge.from_start()));
+                        if (!on_side) {
+                            continue;
+                        }
+                        
+                        departure_t departure;
+                        if (edge.from() == node_id && edge.from_start() == departs_start) {
+                            // We read along the edge
+                            departure.next_id = edge.to();
+                            departure.next_is_reverse = edge.to_end();
+                        } else {
+                            // We read against the edge
+                            departure.next_id = edge.from();
+                            departure.next_is_reverse = !edge.from_start();
+                        }
+                        departure.edge_rank = edge_rank;
+                        departure.edge_orientation_number = (edge_rank - 1) * 2 +
+                            depart_by_reverse(canonicalize(edge), node_id, departs_start);
+                        node_edges.departures[departs_start].push_back(departure);
+                    }
                 }
             }
             
-            if(threads_visiting.empty()) {
-                // Nothing visits here, so there's no cool succinct data structures
-                // to generate.
-                continue;
-            }
-            
-            
-            // Some threads visit here! Determine our orientation from the first
-            // and assume it applies to all threads visiting us.
-            auto& first_visit = threads_visiting.front();
-            bool node_is_reverse = t[first_visit.first][first_visit.second].is_reverse;
-            // When we're inserting threads backwards, we need to treat forward
-            // nodes as reverse and visa versa, to leave the correct side.
-            node_is_reverse = node_is_reverse != insert_reverse;
-            
-            // Now we have all the threads coming through this node, and we know
-            // which way they are going.
-
-            // Make a map from outgoing edge rank to the B_s array number (0 for
-            // stop here, 1 reserved as a separator, and 2 through n corresponding
-            // to outgoing edges in order) for this node's outgoing side.
-            map<size_t, size_t> edge_rank_to_local_edge_number;
-            auto outgoing_edges = node_is_reverse ? edges_on_start(node_id) : edges_on_end(node_id);
-            for(size_t i = 0; i < outgoing_edges.size(); i++) {
-                size_t edge_rank = edge_rank_as_entity(outgoing_edges[i]);
-                edge_rank_to_local_edge_number[edge_rank] = i + 2;
-            }
-            
-            // Make a vector we'll fill in with all the B array values (0 for stop,
-            // 2 + edge number for outgoing edge)
-            vector<size_t> destinations;
-            
-            for(auto& visit : threads_visiting) {
-                // Now go through all the path visits, fill in the edge numbers (or 0
-                // for stop) they go to, and stick visits to the next mappings in the
-                // correct message lists.
-                if(insert_reverse ? (visit.second != 0) : (visit.second + 1 < t[visit.first].size())) {
-                    // This visit continues on from here
-                    
-                    // Make a visit to the next mapping on the path
-                    auto next_visit = visit;
-                    next_visit.second += insert_reverse ? -1 : 1;
-                    
-                    // Work out what node that is, and what orientation
-                    auto& next_mapping = t[next_visit.first][next_visit.second];
-                    int64_t next_node_id = next_mapping.node_id;
-                    bool next_is_reverse = next_mapping.is_reverse != insert_reverse;
-                    
-                    // Figure out the rank of the edge we need to take to get
-                    // there. Note that we need to make sure we can handle going
-                    // forward and backward over edges.
-                    Edge canonical = canonicalize(make_edge(node_id, node_is_reverse, next_node_id, next_is_reverse));
-                    size_t next_edge_rank = edge_rank_as_entity(canonical);
-                    
-                    // Look up what local edge number that edge gets and say we follow it.
-                    destinations.push_back(edge_rank_to_local_edge_number.at(next_edge_rank));
-                    
-                    // Send the new mapping along the edge after all the other ones
-                    // we've sent along the edge
-                    edge_to_ordered_threads[next_edge_rank].push_back(next_visit);
-                    
-                    // Say we traverse an edge going from this node in this
-                    // orientation to that node in that orientation.
-                    emit_edge_traversal(node_id, node_is_reverse, next_node_id, next_is_reverse);
-                    
-                } else {
-                    // This visit ends here
+            for (size_t i = block_start; i < block_end; i++) {
+                // Then we start at the first node in the DAG
+                size_t node_rank = insert_reverse ? node_ranks - i : i + 1;
+                if (node_visit_count[node_rank] == 0) {
+                    continue;
+                }
+                int64_t node_id = rank_to_id(node_rank);
+                auto& node_edges = block_edges[i - block_start];
+                
 #ifdef VERBOSE_DEBUG
-                    if(insert_reverse) {
-                        cerr << "A thread ends here because " << visit.second << " is 0 " << endl;
-                    } else {
-                        cerr << "A thread ends here because " << visit.second + 1 << " is >= " << t[visit.first].size() << endl;
+                if(node_id % 10000 == 1) {
+                    cerr << "Processing node " << node_id << endl;
+                }
+#endif
+                
+                // We order the thread visits starting there, and then all the
+                // threads coming in from other places, ordered by edge
+                // traversed.
+                threads_visiting.clear();
+                
+                auto starting = thread_numbers_by_start_node.find(node_id);
+                if (starting != thread_numbers_by_start_node.end()) {
+                    // Grab the threads starting here
+                    for (size_t thread_number : starting->second) {
+                        // For every thread that starts here, say it visits here
+                        // with its first mapping (0 for forward inserts, last one
+                        // for reverse inserts).
+                        threads_visiting.emplace_back(thread_number, insert_reverse ? t[thread_number].size() - 1 : 0);
+                    }
+                    thread_numbers_by_start_node.erase(starting);
+                }
+                
+                auto arriving = arrivals_by_node_rank.find(node_rank);
+                if (arriving != arrivals_by_node_rank.end()) {
+                    // Bucket the arrivals by edge, in edges_of() order. Within
+                    // an edge they stay in the order they were sent.
+                    for (size_t edge_rank : node_edges.incident_edge_ranks) {
+                        for (auto& arrival : arriving->second) {
+                            if (arrival.first == edge_rank) {
+                                threads_visiting.push_back(arrival.second);
+                            }
+                        }
                     }
+                    arrivals_by_node_rank.erase(arriving);
+                }
+                
+                if (threads_visiting.empty()) {
+                    // Nothing visits here, so there's no cool succinct data
+                    // structures to generate.
+                    continue;
+                }
+                
+                // Some threads visit here! Determine our orientation from the first
+                // and assume it applies to all threads visiting us.
+                auto& first_visit = threads_visiting.front();
+                bool node_is_reverse = t[first_visit.first][first_visit.second].is_reverse;
+                // When we're inserting threads backwards, we need to treat forward
+                // nodes as reverse and visa versa, to leave the correct side.
+                node_is_reverse = node_is_reverse != insert_reverse;
+                
+                auto& departures = node_edges.departures[node_is_reverse];
+                
+                // Fill in all the B array values (0 for stop, 2 + edge number
+                // for outgoing edge)
+                destinations.clear();
+                
+                for (auto& visit : threads_visiting) {
+                    // Now go through all the path visits, fill in the edge
+                    // numbers (or 0 for stop) they go to, and send visits to
+                    // the next mappings along to the next nodes.
+                    if (insert_reverse ? (visit.second != 0) : (visit.second + 1 < t[visit.first].size())) {
+                        // This visit continues on from here
+                        
+                        // Make a visit to the next mapping on the path
+                        auto next_visit = visit;
+                        next_visit.second += insert_reverse ? -1 : 1;
+                        
+                        // Work out what node that is, and what orientation
+                        auto& next_mapping = t[next_visit.first][next_visit.second];
+                        bool next_is_reverse = next_mapping.is_reverse != insert_reverse;
+                        
+                        // Find the local edge number of the edge that gets us there.
+                        size_t local_edge_number = 0;
+                        while (local_edge_number < departures.size() &&
+                               (departures[local_edge_number].next_id != next_mapping.node_id ||
+                                departures[local_edge_number].next_is_reverse != next_is_reverse)) {
+                            local_edge_number++;
+                        }
+                        if (local_edge_number == departures.size()) {
+                            throw runtime_error("[xg] error: thread " + to_string(visit.first) + " goes from node " +
+                                                to_string(node_id) + " to node " + to_string(next_mapping.node_id) +
+                                                " along an edge that does not exist");
+                        }
+                        if (local_edge_number + 2 > numeric_limits<unsigned char>::max()) {
+                            throw runtime_error("[xg] error: node " + to_string(node_id) +
+                                                " has too many edges on one side to store threads");
+                        }
+                        auto& departure = departures[local_edge_number];
+                        
+                        // Say we follow it.
+                        destinations.push_back(local_edge_number + 2);
+                        
+                        // Send the new mapping along the edge after all the
+                        // other ones we've sent along the edge
+                        arrivals_by_node_rank[id_to_rank(next_mapping.node_id)].emplace_back(departure.edge_rank, next_visit);
+                        
+                        // Say we traverse an edge going from this node in this
+                        // orientation to that node in that orientation.
+                        h_iv[departure.edge_orientation_number]++;
+                        
+                    } else {
+                        // This visit ends here
+#ifdef VERBOSE_DEBUG
+                        if(insert_reverse) {
+                            cerr << "A thread ends here because " << visit.second << " is 0 " << endl;
+                        } else {
+                            cerr << "A thread ends here because " << visit.second + 1 << " is >= " << t[visit.first].size() << endl;
+                        }
 #endif
-                    destinations.push_back(BS_NULL);
+                        destinations.push_back(BS_NULL);
+                    }
                 }
+                
+                // Emit the destinations array for the node. Store it in whatever
+                // sort of succinct storage we are using...
+                // We need to send along the side (false for left, true for right)
+                emit_destinations(node_id, node_rank, node_is_reverse, destinations);
+                
+                // We repeat through all nodes until done.
             }
-            
-            // Emit the destinations array for the node. Store it in whatever
-            // sort of succinct storage we are using...
-            // We need to send along the side (false for left, true for right)
-            emit_destinations(node_id, node_is_reverse, destinations);
-            
-            // We repeat through all nodes until done.
         }
     
         // OK now we have gone through the whole set of everything and inserted
@@ -3332,11 +3453,14 @@ void XG::insert_threads_into_dag(const vector<thread_t>& t, const vector<string>
 #endif
     insert_in_direction(true);
     
-    // Actually build the B_s arrays for rank and select.
+#if GPBWT_MODE == MODE_SDSL
+    // Actually build the B_s array for rank and select, straight from the
+    // concatenated array we filled in.
 #ifdef VERBOSE_DEBUG
     cerr << "Creating final compressed array..." << endl;
 #endif
-    bs_bake();
+    construct_im(bs_single_array, all_bs_arrays, 1);
+#endif
     
     // compress the starts for the threads
     util::assign(tin_civ, int_vector<>(tin_iv));
@@ -3973,18 +4097,110 @@ size_t XG::count_matches(const thread_t& t) const {
     return state.count();
 }
 
+XG::thread_t XG::path_to_thread(const Path& path) {
+    thread_t thread;
+    // Where on its node the last mapping left off
+    size_t last_end = 0;
+    for (size_t i = 0; i < path.mapping_size(); i++) {
+        auto& mapping = path.mapping(i);
+        ThreadMapping m = {mapping.position().node_id(), mapping.position().is_reverse()};
+        // A mapping with no edits covers its whole node, so nothing can continue it
+        bool whole_node = mapping.edit_size() == 0;
+        size_t from_length = 0;
+        for (size_t j = 0; j < mapping.edit_size(); j++) {
+            from_length += mapping.edit(j).from_length();
+        }
+        if (!thread.empty() && thread.back().node_id == m.node_id && thread.back().is_reverse == m.is_reverse
+            && !whole_node && mapping.position().offset() == last_end) {
+            // This just continues the last visit
+            last_end += from_length;
+            continue;
+        }
+        thread.push_back(m);
+        last_end = whole_node ? numeric_limits<size_t>::max() : mapping.position().offset() + from_length;
+    }
+    return thread;
+}
+
 size_t XG::count_matches(const Path& t) const {
     // We assume the path is a thread and convert.
-    thread_t thread;
-    for(size_t i = 0; i < t.mapping_size(); i++) {
-        // Convert the mapping
-        ThreadMapping m = {t.mapping(i).position().node_id(), t.mapping(i).position().is_reverse()};
+    return count_matches(path_to_thread(t));
+}
+
+vector<size_t> XG::count_matches(const vector<thread_t>& threads) const {
+    vector<size_t> counts(threads.size());
+    
+    // Visit the threads in sorted order, so that threads starting on the same
+    // side and sharing a prefix are adjacent, and we can search each shared
+    // prefix only once.
+    vector<size_t> order(threads.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](const size_t& a, const size_t& b) {
+        return threads[a] < threads[b];
+    });
+    
+    auto same_mapping = [](const ThreadMapping& a, const ThreadMapping& b) {
+        return a.node_id == b.node_id && a.is_reverse == b.is_reverse;
+    };
+    
+    // Split the sorted threads into contiguous runs that get searched in
+    // parallel. We only lose prefix sharing at the run boundaries.
+    int thread_count = omp_get_max_threads();
+    size_t run_length = max<size_t>(1, (order.size() + thread_count - 1) / thread_count);
+    size_t run_count = (order.size() + run_length - 1) / run_length;
+    
+#pragma omp parallel for schedule(static, 1)
+    for (size_t run = 0; run < run_count; run++) {
+        size_t run_start = run * run_length;
+        size_t run_end = min(order.size(), run_start + run_length);
         
-        thread.push_back(m);
+        // This holds the search state after each prefix of the last thread we
+        // searched, with the un-started state first. It acts as the path from
+        // the root of an implicit trie of all the threads in the run down to
+        // the last thread.
+        vector<ThreadSearchState> prefix_states(1);
+        const thread_t* previous = nullptr;
+        
+        for (size_t i = run_start; i < run_end; i++) {
+            const thread_t& thread = threads[order[i]];
+            
+            // How much can we reuse from the last thread?
+            size_t shared = 0;
+            if (previous != nullptr) {
+                while (shared < thread.size() && shared < previous->size() &&
+                       same_mapping(thread[shared], (*previous)[shared])) {
+                    shared++;
+                }
+            }
+            // We may not have searched the whole shared prefix if the search
+            // ran out of threads, but then it is empty for this thread too.
+            shared = min(shared, prefix_states.size() - 1);
+            prefix_states.resize(shared + 1);
+            
+            for (size_t j = shared; j < thread.size() && !prefix_states.back().is_empty(); j++) {
+                // Extend the deepest state we have with the next mapping
+                prefix_states.push_back(prefix_states.back());
+                extend_search(prefix_states.back(), thread[j]);
+            }
+            
+            counts[order[i]] = prefix_states.back().count();
+            previous = &thread;
+        }
+    }
+    
+    return counts;
+}
+
+vector<size_t> XG::count_matches(const vector<Path>& paths) const {
+    vector<thread_t> threads;
+    threads.reserve(paths.size());
+    for (auto& path : paths) {
+        threads.push_back(path_to_thread(path));
     }
     
-    // Count matches to the converted thread
-    return count_matches(thread);
+    return count_matches(threads);
 }
 
 void XG::extend_search(ThreadSearchState& state, const thread_t& t) const {
@@ -4049,8 +4265,14 @@ void XG::extend_search(ThreadSearchState& state, const thread_t& t) const {
             
         } else {
             // Else, look at where the path goes to and apply the where_to function to shrink the range down.
-            state.range_start = where_to(state.current_side, state.range_start, next_side);
-            state.range_end = where_to(state.current_side, state.range_end, next_side);
+            // Both ends of the range cross the same edge, so only look up the
+            // edges once.
+            int64_t current_id = rank_to_id(state.current_side / 2);
+            bool current_is_reverse = state.current_side % 2;
+            vector<Edge> edges_into_new = next_is_reverse ? edges_on_end(next_id) : edges_on_start(next_id);
+            vector<Edge> edges_out_of_old = current_is_reverse ? edges_on_start(current_id) : edges_on_end(current_id);
+            state.range_start = where_to(state.current_side, state.range_start, next_side, edges_into_new, edges_out_of_old);
+            state.range_end = where_to(state.current_side, state.range_end, next_side, edges_into_new, edges_out_of_old);
             
 #ifdef VERBOSE_DEBUG
             cerr << "\tFound " << state.range_start << " to " << state.range_end << " threads continuing through." << endl;
@@ -262,6 +262,9 @@ public:
 
     // Pull out the path with the given name.
     Path path(const string& name) const;
+    // Call the function with the node ID and orientation of each visit along
+    // the path with the given name, in order, without building the Path.
+    void for_each_path_visit(const string& name, const function<void(int64_t id, bool is_reverse)>& lambda) const;
     // Returns the rank of the path with the given name, or 0 if no such path
     // exists.
     size_t path_rank(const string& name) const;
@@ -381,7 +384,9 @@ public:
     /// subset traversed by the threads. (Reversing edges are fine, but the
     /// threads in a node must all run in the same direction.) This uses a
     /// special efficient batch insert algorithm for DAGs that lets us just scan
-    /// the graph and generate nodes' B_s arrays independently. This must be
+    /// the graph and generate nodes' B_s arrays independently. Edge lookups
+    /// are done in parallel ahead of the sweep, and the B_s arrays are written
+    /// directly into the final concatenated array. This must be
     /// called only once, and no threads can have been inserted previously.
     /// Otherwise the gPBWT data structures will be left in an inconsistent
     /// state.
@@ -395,9 +400,23 @@ public:
     /// Extract a particular thread, referring to it by its offset at node; step
     /// it out to a maximum of max_length
     thread_t extract_thread(xg::XG::ThreadMapping node, int64_t offset, int64_t max_length);
+    /// Convert a path to a thread. Consecutive mappings that continue along
+    /// the same node in the same orientation, as in an alignment split into
+    /// several mappings, become one visit; a mapping that starts the node
+    /// over is a separate visit.
+    static thread_t path_to_thread(const Path& path);
     /// Count matches to a subthread among embedded threads
     size_t count_matches(const thread_t& t) const;
+    /// Count matches to a path, converted as per path_to_thread()
     size_t count_matches(const Path& t) const;
+    /// Count matches to each of a batch of subthreads among embedded threads.
+    /// Subthreads starting on the same side and sharing a prefix share the
+    /// search work for that prefix, and the batch is searched in parallel.
+    /// Counts come back in the same order as the subthreads.
+    vector<size_t> count_matches(const vector<thread_t>& threads) const;
+    /// Count matches to each of a batch of paths, converted as per
+    /// path_to_thread().
+    vector<size_t> count_matches(const vector<Path>& paths) const;
     
     /**
      * Represents the search state for the graph PBWT, so that you can continue
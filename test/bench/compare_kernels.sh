@@ -0,0 +1,15 @@
+#!/bin/bash
+# Compare two kernel benchmark results from run_kernels.sh, printing the time
+# per item in each and the ratio of new to old for every benchmark.
+
+if [ ! $# -eq 2 ];
+then
+    echo "usage: " $0 " [old.tsv] [new.tsv]"
+    exit 1
+fi
+
+( echo -e "benchmark\told_ns_per_item\tnew_ns_per_item\tratio"
+  join -t $'\t' \
+       <(tail -n +2 $1 | cut -f 2,6 | sort) \
+       <(tail -n +2 $2 | cut -f 2,6 | sort) \
+      | awk -F'\t' -v OFS='\t' '{ print $1, $2, $3, ($2 > 0 ? $3 / $2 : 0) }' )
@@ -0,0 +1,266 @@
+/**
+ * kernels.cpp: microbenchmarks for vg's core kernels
+ *
+ * Times MEM finding, clustering, local and banded global alignment, XG
+ * neighborhood queries, parallel GAM parsing, graph sorting and GAM sorting on
+ * fixed inputs (see run_kernels.sh, which builds them). Writes one
+ * tab-separated line per benchmark, so results from different commits can be
+ * compared with compare_kernels.sh.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <functional>
+#include <getopt.h>
+#include <omp.h>
+
+#include "vg.hpp"
+#include "xg.hpp"
+#include "mapper.hpp"
+#include "cluster.hpp"
+#include "gssw_aligner.hpp"
+#include "gamsorter.hpp"
+#include "stream.hpp"
+#include "gcsa/gcsa.h"
+#include "gcsa/lcp.h"
+
+using namespace std;
+using namespace vg;
+
+/// Runs benchmarks and reports their timings
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(ostream& out, const string& label, double min_seconds) :
+        out(out), label(label), min_seconds(min_seconds) {
+        out << "label\tbenchmark\titerations\titems\tseconds\tns_per_item" << endl;
+    }
+
+    /// Run the untimed setup and then the timed body over and over, until
+    /// the body has taken at least min_seconds in total, and report the time
+    /// per item. The body returns how many items (reads, queries, ...) it
+    /// processed.
+    void run(const string& name, const function<void(void)>& setup, const function<size_t(void)>& body) {
+        size_t iterations = 0;
+        size_t items = 0;
+        double seconds = 0;
+        while (seconds < min_seconds || iterations == 0) {
+            setup();
+            auto start = chrono::steady_clock::now();
+            items += body();
+            seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            iterations++;
+        }
+        out << label << "\t" << name << "\t" << iterations << "\t" << items << "\t"
+            << seconds << "\t" << (items ? seconds * 1e9 / items : 0) << endl;
+    }
+
+    void run(const string& name, const function<size_t(void)>& body) {
+        run(name, [](void) {}, body);
+    }
+
+private:
+    ostream& out;
+    string label;
+    double min_seconds;
+};
+
+void help_kernels(char** argv) {
+    cerr << "usage: " << argv[0] << " [options] graph.vg graph.xg graph.gcsa reads.gam" << endl
+         << "Time vg's core kernels on the given inputs, writing TSV to stdout." << endl
+         << "The LCP array is read from graph.gcsa.lcp." << endl
+         << endl
+         << "options:" << endl
+         << "    -l, --label NAME       label each result line with NAME (e.g. a commit hash)" << endl
+         << "    -n, --max-reads N      use at most N reads per kernel (default 2000)" << endl
+         << "    -m, --min-seconds N    run each kernel for at least N seconds (default 2)" << endl
+         << "    -t, --threads N        threads for the parallel kernels (default 1)" << endl;
+}
+
+int main(int argc, char** argv) {
+
+    string label = "-";
+    size_t max_reads = 2000;
+    double min_seconds = 2;
+    int threads = 1;
+
+    int c;
+    while (true) {
+        static struct option long_options[] =
+        {
+            {"help", no_argument, 0, 'h'},
+            {"label", required_argument, 0, 'l'},
+            {"max-reads", required_argument, 0, 'n'},
+            {"min-seconds", required_argument, 0, 'm'},
+            {"threads", required_argument, 0, 't'},
+            {0, 0, 0, 0}
+        };
+
+        int option_index = 0;
+        c = getopt_long (argc, argv, "hl:n:m:t:",
+                         long_options, &option_index);
+
+        if (c == -1) break;
+
+        switch (c)
+        {
+        case 'l':
+            label = optarg;
+            break;
+        case 'n':
+            max_reads = atoll(optarg);
+            break;
+        case 'm':
+            min_seconds = atof(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'h':
+        case '?':
+        default:
+            help_kernels(argv);
+            return 1;
+        }
+    }
+
+    if (argc - optind != 4) {
+        help_kernels(argv);
+        return 1;
+    }
+    string vg_name = argv[optind];
+    string xg_name = argv[optind + 1];
+    string gcsa_name = argv[optind + 2];
+    string gam_name = argv[optind + 3];
+
+    omp_set_num_threads(threads);
+
+    // Load the inputs
+    ifstream vg_stream(vg_name);
+    VG graph(vg_stream);
+    ifstream xg_stream(xg_name);
+    xg::XG xg_index(xg_stream);
+    gcsa::GCSA gcsa_index;
+    ifstream gcsa_stream(gcsa_name);
+    gcsa_index.load(gcsa_stream);
+    gcsa::LCPArray lcp_array;
+    ifstream lcp_stream(gcsa_name + ".lcp");
+    lcp_array.load(lcp_stream);
+
+    vector<Alignment> reads;
+    {
+        ifstream gam_stream(gam_name);
+        function<void(Alignment&)> lambda = [&](Alignment& aln) {
+            if (reads.size() < max_reads) {
+                reads.push_back(aln);
+            }
+        };
+        stream::for_each(gam_stream, lambda);
+    }
+    if (reads.empty()) {
+        cerr << "error:[kernels] no reads in " << gam_name << endl;
+        return 1;
+    }
+
+    // The local graph each read was simulated from, sorted for the aligners
+    vector<Graph> read_graphs;
+    for (auto& read : reads) {
+        Graph g;
+        for (size_t i = 0; i < read.path().mapping_size(); i++) {
+            *g.add_node() = xg_index.node(read.path().mapping(i).position().node_id());
+        }
+        xg_index.expand_context(g, 2, false);
+        VG sorted;
+        sorted.extend(g);
+        sorted.sort();
+        read_graphs.push_back(sorted.graph);
+    }
+
+    // Align the reads as if they came off the forward strand
+    vector<Alignment> unaligned;
+    for (auto& read : reads) {
+        Alignment aln;
+        bool reverse = read.path().mapping_size() && read.path().mapping(0).position().is_reverse();
+        aln.set_sequence(reverse ? reverse_complement(read.sequence()) : read.sequence());
+        aln.set_name(read.name());
+        unaligned.push_back(aln);
+    }
+
+    Mapper mapper(&xg_index, &gcsa_index, &lcp_array);
+    Aligner aligner;
+    BenchmarkRunner runner(cout, label, min_seconds);
+
+    vector<vector<MaximalExactMatch>> read_mems(reads.size());
+    runner.run("find_mems_deep", [&](void) {
+        for (size_t i = 0; i < reads.size(); i++) {
+            double lcp_avg;
+            read_mems[i] = mapper.find_mems_deep(reads[i].sequence().begin(), reads[i].sequence().end(),
+                                                 lcp_avg, 0, mapper.min_mem_length, mapper.mem_reseed_length);
+        }
+        return reads.size();
+    });
+
+    runner.run("OrientedDistanceClusterer", [&](void) {
+        for (size_t i = 0; i < reads.size(); i++) {
+            OrientedDistanceClusterer clusterer(reads[i], read_mems[i], aligner, &xg_index);
+            clusterer.clusters();
+        }
+        return reads.size();
+    });
+
+    runner.run("Aligner::align", [&](void) {
+        for (size_t i = 0; i < reads.size(); i++) {
+            Alignment aln = unaligned[i];
+            aligner.align(aln, read_graphs[i], true, false);
+        }
+        return reads.size();
+    });
+
+    runner.run("BandedGlobalAligner", [&](void) {
+        for (size_t i = 0; i < reads.size(); i++) {
+            Alignment aln = unaligned[i];
+            aligner.align_global_banded(aln, read_graphs[i], 0, true);
+        }
+        return reads.size();
+    });
+
+    runner.run("XG::neighborhood", [&](void) {
+        for (auto& read : reads) {
+            if (!read.path().mapping_size()) continue;
+            Graph g;
+            xg_index.neighborhood(read.path().mapping(0).position().node_id(), 8, g);
+        }
+        return reads.size();
+    });
+
+    runner.run("stream::for_each_parallel", [&](void) {
+        vector<size_t> counts(threads, 0);
+        ifstream gam_stream(gam_name);
+        function<void(Alignment&)> lambda = [&](Alignment& aln) {
+            counts[omp_get_thread_num()]++;
+        };
+        stream::for_each_parallel(gam_stream, lambda);
+        size_t total = 0;
+        for (auto count : counts) total += count;
+        return total;
+    });
+
+    VG to_sort;
+    runner.run("VG::sort", [&](void) {
+        to_sort = graph;
+    }, [&](void) {
+        to_sort.sort();
+        return (size_t) to_sort.size();
+    });
+
+    vector<Alignment> to_gamsort;
+    GAMSorter gam_sorter;
+    runner.run("GAMSorter::sort", [&](void) {
+        to_gamsort = reads;
+    }, [&](void) {
+        gam_sorter.sort(to_gamsort);
+        return to_gamsort.size();
+    });
+
+    return 0;
+}
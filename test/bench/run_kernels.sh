@@ -0,0 +1,40 @@
+#!/bin/bash
+# Build the fixed benchmark inputs (once) and time vg's core kernels on them.
+# Results go to stdout and to results/<label>.tsv, where the label defaults to
+# the current commit, so runs from different commits can be compared with
+# compare_kernels.sh.
+
+set -e
+
+label=${1:-$(git rev-parse --short HEAD)}
+threads=${THREADS:-4}
+
+PATH=../../bin:$PATH # for vg
+
+mkdir -p data results
+
+# A 1 Mbp region with 1000 Genomes variants, and reads simulated from it with
+# a fixed seed
+if [ ! -e data/z.gcsa ]; then
+    vg construct -r ../1mb1kgp/z.fa -v ../1mb1kgp/z.vcf.gz -m 32 >data/z.vg
+    vg index -x data/z.xg -g data/z.gcsa -k 16 data/z.vg
+    vg sim -x data/z.xg -s 271828 -n 20000 -l 150 -e 0.01 -i 0.002 -a >data/z.sim.gam
+fi
+
+./kernels -l $label -t $threads data/z.vg data/z.xg data/z.gcsa data/z.sim.gam | tee results/$label.tsv
+
+# Whole runs of vg msga on the HLA-B alts, which are dominated by rebuilding
+# the indexes, with and without the GCSA2 overlay
+hla=../GRCh38_alts/FASTA/HLA/B-3106.fa
+hla_bases=$(grep -v '^>' $hla | tr -d '\n' | wc -c)
+time_msga() {
+    benchmark=$1
+    shift
+    start=$(date +%s.%N)
+    vg msga -f $hla -w 256 -E 4 -B 4 -W 64 -P 0.9 -t $threads "$@" >/dev/null
+    end=$(date +%s.%N)
+    awk -v OFS='\t' -v label=$label -v benchmark=$benchmark -v items=$hla_bases -v start=$start -v end=$end \
+        'BEGIN { print label, benchmark, 1, items, end - start, (end - start) * 1e9 / items }'
+}
+time_msga msga_hla_b | tee -a results/$label.tsv
+time_msga msga_hla_b_overlay --overlay 0.5 | tee -a results/$label.tsv
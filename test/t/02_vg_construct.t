@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="C" # force a consistent sort order 
 
-plan tests 23
+plan tests 24
 
 is $(vg construct -r small/x.fa -v small/x.vcf.gz | vg stats -z - | grep nodes | cut -f 2) 210 "construction produces the right number of nodes"
 
@@ -67,6 +67,8 @@ x3=$(for i in $(seq 100); do
 
 is $x3 1 "the number of threads and regions used in construction has no effect on the graph"
 
+is $(vg construct -r 1mb1kgp/z.fa -v 1mb1kgp/z.vcf.gz -z 10000 -t 4 | md5sum | cut -f 1 -d\ ) $(vg construct -r 1mb1kgp/z.fa -v 1mb1kgp/z.vcf.gz -z 10000 -t 1 | md5sum | cut -f 1 -d\ ) "construction with many threads emits the same chunks in the same order as with one"
+
 vg construct -r 1mb1kgp/z.fa -v 1mb1kgp/z.vcf.gz -R z:10-20 >/dev/null
 is $? 0 "construction of a graph with two head nodes succeeds"
 
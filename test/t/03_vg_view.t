@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 14
+plan tests 16
 
 is $(vg construct -r small/x.fa -v small/x.vcf.gz | vg view -d - | wc -l) 505 "view produces the expected number of lines of dot output"
 is $(vg construct -r small/x.fa -v small/x.vcf.gz | vg view -g - | wc -l) 503 "view produces the expected number of lines of GFA output"
@@ -15,6 +15,8 @@ is $(vg construct -r small/x.fa -v small/x.vcf.gz | vg view - | head | vg view -
 is $(samtools view -u minigiab/NA12878.chr22.tiny.bam | vg view -bG - | vg view -a - | wc -l) $(samtools view -u minigiab/NA12878.chr22.tiny.bam | samtools view - | wc -l) "view can convert BAM to GAM"
 
 is "$(samtools view -u minigiab/NA12878.chr22.tiny.bam | vg view -bG - | vg view -aj - | jq -c --sort-keys . | sort | md5sum)" "$(samtools view -u minigiab/NA12878.chr22.tiny.bam | vg view -bG - | vg view -aj - | vg view -JGa - | vg view -aj - | jq -c --sort-keys . | sort | md5sum)" "view can round-trip JSON and GAM"
+is "$(samtools view -u minigiab/NA12878.chr22.tiny.bam | vg view -bG - | OMP_NUM_THREADS=4 vg view -aj - | md5sum)" "$(samtools view -u minigiab/NA12878.chr22.tiny.bam | vg view -bG - | OMP_NUM_THREADS=1 vg view -aj - | md5sum)" "view converts GAM to JSON in order"
+is "$(samtools view -u minigiab/NA12878.chr22.tiny.bam | vg view -bG - | vg view -aj - | tr -d '\n' | OMP_NUM_THREADS=4 vg view -JGa - | vg view -aj - | md5sum)" "$(samtools view -u minigiab/NA12878.chr22.tiny.bam | vg view -bG - | vg view -aj - | md5sum)" "view reads concatenated JSON GAM in order"
 
 # We need to run through GFA because vg construct doesn't necessarily chunk the
 # graph the way vg view wants to.
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 33
+plan tests 43
 
 vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg -g x.gcsa -k 11 x.vg
@@ -40,11 +40,21 @@ is $(vg map -b small/x.bam -x x.xg -g x.gcsa -j | jq .quality | grep null | wc -
 
 is $(vg map -s $seq -w 30 -x x.xg -g x.gcsa -j | wc -l) 1 "chunky-banded alignment works"
 
+is $(vg map -s $seq -w 30 --long-read-chain -x x.xg -g x.gcsa -j | jq -r .sequence) $seq "chained long read alignment covers the whole read"
+is $(vg map -s $seq -w 30 --long-read-chain -x x.xg -g x.gcsa -j | jq '(.path.mapping | length) > 0 and .score > 0 and .identity > 0.95') "true" "chained long read alignment actually places the read"
+
 scores=$(vg map -s GCACCAGGACCCAGAGAGTTGGAATGCCAGGCATTTCCTCTGTTTTCTTTCACCG -x x.xg -g x.gcsa -j -M 2 | jq -r '.score' | tr '\n' ',')
 is "${scores}" $(printf ${scores} | tr ',' '\n' | sort -nr | tr '\n' ',')  "multiple alignments are returned in descending score order"
 
 is "$(vg map -s GCACCAGGACCCAGAGAGTTGGAATGCCAGGCATTTCCTCTGTTTTCTTTCACCG -x x.xg -g x.gcsa -j -M 2 | jq -c 'select(.is_secondary | not)' | wc -l)" "1" "only a single primary alignment is returned"
 
+vg sim -s 1337 -n 100 -l 100 -x x.xg >reads.txt
+vg map -t 1 --reads reads.txt -x x.xg -g x.gcsa >plain.gam
+vg map -t 1 --reads reads.txt -x x.xg -g x.gcsa --profile profile.json >profiled.gam
+is "$(md5sum <profiled.gam | cut -f 1 -d ' ')" "$(md5sum <plain.gam | cut -f 1 -d ' ')" "profiling the mapper does not change its alignments"
+is "$(jq -c '[.events.reads, (.stages | length), .stages.mems.runs > 0]' profile.json)" "[100,6,true]" "the mapping profile records every read and the stages it went through"
+rm -f reads.txt plain.gam profiled.gam profile.json
+
 rm -f x.vg x.xg x.gcsa x.gcsa.lcp
 rm -rf x.vg.index
 
@@ -122,6 +132,22 @@ rm temp_scores_full_qual.txt temp_scores_reduced_qual.txt
 
 is $(vg map -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -f reads/grch38_lrc_kir_paired.fq -i -u 4 -I 1000:300:20:0:1 -j | jq -r 'select(.name == "ERR194147.679985061/1") | .path.mapping[0].position.node_id') 8121 "paired-end reads are pulled to consistent locations at the cost of non-optimal individual alignments"
 
+is $(vg map -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -f reads/grch38_lrc_kir_paired.fq -i -u 4 -I 1000:300:20:0:1 -O 8 -j | jq -r .name | wc -l) $(vg map -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -f reads/grch38_lrc_kir_paired.fq -i -u 4 -I 1000:300:20:0:1 -j | jq -r .name | wc -l) "mate rescue keeps one alignment per read"
+
+vg map -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -f reads/grch38_lrc_kir_paired.fq -i -u 4 -I 1000:300:20:0:1 -U --frag-model-out frag.model -j > fixed.json
+is $(head -n 1 frag.model) "1000:300:20:0:1" "the fragment model is saved to a file"
+vg map -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -f reads/grch38_lrc_kir_paired.fq -i -u 4 --frag-model-in frag.model -U -j > loaded.json
+is $(diff fixed.json loaded.json | wc -l) 0 "mapping from a saved fragment model matches mapping from the same model on the command line"
+rm -f frag.model fixed.json loaded.json
+
+vg sim -x graphs/refonly-lrc_kir.vg.xg -s 2718 -n 500 -l 100 -p 500 -v 50 -a > pairs.gam
+vg map -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -G pairs.gam -i -t 2 --frag-model-out learned.model -j > /dev/null
+is $(tail -n +2 learned.model | awk -F '\t' 'NF == 3 && $1 >= 0 && ($2 == 0 || $2 == 1) && ($3 == 0 || $3 == 1)' | wc -l) $(tail -n +2 learned.model | grep -c .) "the pairs a fragment model was learned from are saved with it"
+is $(awk -F '[:\t]' 'NR == 1 { model = $2 } NR > 1 { sum += $1; n++ } END { if (n == 0) { print 0 } else { d = model - sum / n; print (d < 0.01 && d > -0.01) } }' learned.model) 1 "the saved fragment model is estimated from the pairs of every thread"
+vg map -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -G pairs.gam -i -t 2 --frag-model-in learned.model -U --frag-model-out reloaded.model -j > /dev/null
+is $(diff learned.model reloaded.model | wc -l) 0 "a loaded fragment model and its pairs are saved again unchanged"
+rm -f pairs.gam learned.model reloaded.model
+
 vg map -x graphs/refonly-lrc_kir.vg.xg -g graphs/refonly-lrc_kir.vg.gcsa -f reads/NONEXISTENT -u 4 -j
 is $? 1 "error on vg map -f <nonexistent-file> (unpaired)"
 
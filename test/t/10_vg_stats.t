@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 10
+plan tests 12
 
 vg construct -r 1mb1kgp/z.fa -v 1mb1kgp/z.vcf.gz >z.vg
 #is $? 0 "construction of a 1 megabase graph from the 1000 Genomes succeeds"
@@ -39,6 +39,8 @@ vg index -x x.xg -g x.gcsa -k 16 x.vg
 vg sim -s 1337 -n 100 -x x.xg >x.reads
 vg map -x x.xg -g x.gcsa -T x.reads >x.gam
 is "$(vg stats -a x.gam x.vg | md5sum | cut -f 1 -d\ )" "$(md5sum correct/10_vg_stats/15.txt | cut -f 1 -d\ )" "aligned read stats are computed correctly"
+is "$(OMP_NUM_THREADS=4 vg stats -a x.gam x.vg | md5sum | cut -f 1 -d\ )" "$(md5sum correct/10_vg_stats/15.txt | cut -f 1 -d\ )" "aligned read stats do not depend on the thread count"
+is "$(vg stats -a x.gam -D x.vg | grep -c 'distribution:$')" 4 "aligned read distributions are reported"
 rm -f x.vg x.xg x.gcsa x.gam x.reads
 
 is $(vg msga -f msgas/cycle.fa -b s1 -w 16 -w 8 -t 1 | vg mod -U 10 - | vg stats -O - | wc -l) 41 "a path overlap description of a cyclic graph built by msga has the expected length"
@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="C" # force a consistent sort order 
 
-plan tests 16
+plan tests 18
 
 is $(vg construct -r small/x.fa -v small/x.vcf.gz | vg kmers -k 11 - | sort | uniq | wc -l) \
     2133 \
@@ -20,6 +20,11 @@ is $(vg construct -r small/x.fa -v small/x.vcf.gz | vg kmers -n -k 11 - | sort |
 is  $(vg construct -r small/x.fa -v small/x.vcf.gz | vg kmers -k 11 -d - | sort | uniq | wc -l) \
     $(vg construct -r small/x.fa -v small/x.vcf.gz -t 4 | vg kmers -k 11 -d - | wc -l) \
     "only unique kmers are produced"
+
+vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
+is $(vg kmers -k 11 -c -M 1 x.vg | wc -l) $(vg kmers -k 11 x.vg | cut -f 1 | sort | uniq | wc -l) "counting reports each distinct kmer once"
+is $(vg kmers -k 11 -c -M 1 x.vg | awk '{ s += $2 } END { print s }') $(vg kmers -k 11 x.vg | wc -l) "counting counts every kmer occurrence"
+rm -f x.vg
     
 is $(vg kmers -k 15 reversing/reversing_edge.vg | grep "CAAATAAGTGTAATC" | wc -l) 1 "to_end edges are handled correctly"
 
@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="C" # force a consistent sort order 
 
-plan tests 41
+plan tests 42
 
 is $(vg construct -r small/x.fa -v small/x.vcf.gz | vg mod -k x - | vg view - | grep "^P" | cut -f 3 | grep -o "[0-9]\+" |  wc -l) \
     $(vg construct -r small/x.fa -v small/x.vcf.gz | vg mod -k x - | vg view - | grep "^S" | wc -l) \
@@ -127,6 +127,7 @@ vg sim -s 420 -l 30 -x 2snp.xg -n 30 -a >2snp.sim
 vg index -x flat.xg -g flat.gcsa -k 16 flat.vg
 vg map -g flat.gcsa -x flat.xg -G 2snp.sim >2snp.gam
 is $(vg mod -i 2snp.gam flat.vg | vg mod -D - | vg mod -n - | vg view - | grep ^S | wc -l) 7 "editing the graph with many SNP-containing alignments does not introduce duplicate identical nodes"
+is $(vg mod -t 4 -Y -i 2snp.gam flat.vg | vg view - | grep ^S | md5sum | cut -f 1 -d\ ) $(cat 2snp.gam | vg mod -Y -i - flat.vg | vg view - | grep ^S | md5sum | cut -f 1 -d\ ) "editing the graph by streaming alignments from a file matches editing with them in memory"
 rm -f flat.vg 2snp.vg 2snp.xg 2snp.sim 2snp.gam
 
 # Note the math (and subsetting) only works out on a flat alleles graph
@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 12
+plan tests 15
 
 is $(vg msga -f GRCh38_alts/FASTA/HLA/V-352962.fa -t 4 -k 16 | vg mod -U 10 - | vg mod -c - | vg view - | grep ^S | cut -f 3 | sort | md5sum | cut -f 1 -d\ ) $(vg msga -f GRCh38_alts/FASTA/HLA/V-352962.fa -t 1 -k 16 | vg mod -U 10 - | vg mod -c - | vg view - | grep ^S | cut -f 3 | sort | md5sum | cut -f 1 -d\ ) "graph for GRCh38 HLA-V is unaffected by the number of alignment threads"
 
@@ -42,3 +42,12 @@ is $? 0 "edges in cycles with two nodes are correctly included"
 
 vg msga -f GRCh38_alts/FASTA/HLA/B-3106.fa -w 256 -E 4 -B 4 -W 64 -P 0.9 | vg validate -
 is $? 0 "HLA B-3106 is assembled into a valid graph"
+
+vg msga -f msgas/w.fa -b x -K 16 >w.vg
+is $(vg view w.vg | md5sum | cut -f 1 -d\ ) $(vg ids -s w.vg | vg view - | md5sum | cut -f 1 -d\ ) "msga output is already sorted"
+rm -f w.vg
+
+is $((for seq in $(vg msga -f msgas/w.fa -b x -K 16 --overlay 1 | vg paths -x - | vg view -a - | jq .sequence | sed s/\"//g ); do grep $seq msgas/w.fa ; done) | wc -l) 2 "the paths of the graph encode the original sequences when mapping through the index overlay"
+
+vg msga -f GRCh38_alts/FASTA/HLA/B-3106.fa -w 256 -E 4 -B 4 -W 64 -P 0.9 --overlay 0.5 | vg validate -
+is $? 0 "HLA B-3106 is assembled into a valid graph when mapping through the index overlay"
@@ -5,7 +5,26 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 0
+plan tests 6
+
+vg construct -r tiny/tiny.fa -v tiny/tiny.vcf.gz > tiny.vg
+vg index -x tiny.xg tiny.vg
+vg sim -s 1337 -n 20 -l 20 -a -x tiny.xg | vg view -a - | jq -c '.name = "r\(input_line_number)"' | vg view -JGa - > named.gam
+vg view -a named.gam | jq -r .name > names.txt
+
+is "$(vg vectorize -f -x tiny.xg named.gam | cut -f 1)" "$(cat names.txt)" "vectorized rows come out in input order"
+
+vg vectorize -C -x tiny.xg named.gam > named.csr
+columns=$(vg stats -z tiny.vg | awk '{ total += $2 } END { print total }')
+nonzeros=$(od -An -tu8 -j 24 -N 8 named.csr | tr -d ' ')
+
+is "$(head -c 8 named.csr)" "vgcsr001" "CSR output starts with its magic string"
+is "$(od -An -tu8 -j 8 -N 16 named.csr | tr -s ' ' | sed 's/^ //')" "20 ${columns}" "CSR header gives a row per read and a column per node and edge"
+is $(od -An -tu8 -j 32 -N 8 named.csr | tr -d ' ') 0 "CSR row pointers start at 0"
+is $(od -An -tu8 -j $((32 + 8 * 20)) -N 8 named.csr | tr -d ' ') ${nonzeros} "CSR row pointers end at the number of nonzeros"
+is "$(tail -c +$((32 + 8 * 21 + 8 * nonzeros + 1)) named.csr | tr -d '\000-\003')" "$(cat names.txt | tr -d '\n')" "CSR row names come out in input order"
+
+rm -f tiny.vg tiny.xg named.gam names.txt named.csr
 
 #vg construct -r ../tiny/tiny.fa -v ../tiny/tiny.vcf.gz > tiny.vg
 #vg index -x tiny.xg -g tiny.gcsa -k 16 tiny.vg
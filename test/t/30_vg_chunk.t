@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 10
+plan tests 11
 
 vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg -v small/x.vcf.gz  x.vg 2> /dev/null
@@ -35,6 +35,23 @@ is $(ls -l _chunk_test*.vg | wc -l) 2 "gam chunker produces correct number of gr
 is $(ls -l _chunk_test*.gam | wc -l) 2 "gam chunker produces correct number of gams"
 is $(grep x _chunk_test_out.bed | wc -l) 2 "gam chunker prodcues bed with correct number of chunks"
 
+#check that streaming a gam sends each read to exactly the chunks it touches, and that a rerun overwrites
+rm -f _chunk_test*
+printf "x\t2\t200\nx\t500\t600\n" > _chunk_test_bed.bed
+cat x.gam | vg chunk -x x.xg -A - -g -b _chunk_test -e _chunk_test_bed.bed -t 2
+cat x.gam | vg chunk -x x.xg -A - -g -b _chunk_test -e _chunk_test_bed.bed -t 2
+routed=0
+for graph in _chunk_test*.vg; do
+    ids=$(vg view -j ${graph} | jq -c '[.node[].id | {(tostring): true}] | add')
+    jq -c --argjson ids "${ids}" 'select(any(.path.mapping[].position.node_id; $ids[tostring] == true))' x.gam.json | sort > _chunk_test_expected.json
+    vg view -a ${graph%.vg}.gam | jq -c . | sort > _chunk_test_routed.json
+    if [ -s _chunk_test_expected.json ] && diff -q _chunk_test_expected.json _chunk_test_routed.json > /dev/null; then
+        routed=$((routed + 1))
+    fi
+done
+is ${routed} 2 "streaming gam chunker routes each read to exactly the chunks it touches"
+rm -f _chunk_test*
+
 #check that id ranges work
 is $(vg chunk -x x.xg -r 1:3 | vg view - -j | jq .node | grep id |  wc -l) 3 "id chunker produces correct chunk size"
 is $(vg chunk -x x.xg -r 1 | vg view - -j | jq .node | grep id | wc -l) 1 "id chunker produces correct single chunk"
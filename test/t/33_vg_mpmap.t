@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+
+BASH_TAP_ROOT=../deps/bash-tap
+. ../deps/bash-tap/bash-tap-bootstrap
+
+PATH=../bin:$PATH # for vg
+
+plan tests 2
+
+vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
+vg index -x x.xg -g x.gcsa -k 16 x.vg
+
+vg sim -s 1337 -n 100 -l 100 -a -x x.xg >reads.gam
+vg mpmap -t 1 -S -G reads.gam -x x.xg -g x.gcsa >plain.gam
+vg mpmap -t 1 -S -G reads.gam -x x.xg -g x.gcsa --profile profile.json >profiled.gam
+is "$(md5sum <profiled.gam | cut -f 1 -d ' ')" "$(md5sum <plain.gam | cut -f 1 -d ' ')" "profiling the multipath mapper does not change its alignments"
+is "$(jq -c '[.events.reads, (.stages | length), .stages.mems.runs > 0]' profile.json)" "[100,6,true]" "the multipath mapping profile records every read and the stages it went through"
+
+rm -f x.vg x.xg x.gcsa x.gcsa.lcp reads.gam plain.gam profiled.gam profile.json